@@ -0,0 +1,37 @@
+#ifndef YU_BENCH_H
+#define YU_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64* generator, `state` must not be zero */
+static uint64_t bench_rand(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t bench_arg(int argc, char **argv, int idx, size_t fallback) {
+  if (argc > idx) {
+    return (size_t)strtoull(argv[idx], NULL, 10);
+  }
+  return fallback;
+}
+
+static void bench_report(const char *name, size_t ops, double seconds) {
+  printf("%-40s %12.0f ops/s %10.3f s\n", name, (double)ops / seconds,
+         seconds);
+}
+
+#endif /* !YU_BENCH_H */
@@ -0,0 +1,114 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/cache.h"
+#include "datastructs/functions.h"
+
+#include "bench.h"
+
+struct item {
+  uint64_t key;
+
+  struct cache_entry ce;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(cache_hash_item(entry, struct item, ce)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return cache_hash_item(a, struct item, ce)->key ==
+         cache_hash_item(b, struct item, ce)->key;
+}
+
+/* Keys of the trace follow Zipf distribution with exponent `s`:
+ * key of rank `k` is requested with probability proportional to 1/k^s */
+static uint64_t *make_trace(size_t num_keys, size_t length, double s) {
+  double *cdf = malloc(num_keys * sizeof(*cdf));
+  double sum = 0;
+  for (size_t i = 0; i < num_keys; ++i) {
+    sum += 1.0 / pow((double)(i + 1), s);
+    cdf[i] = sum;
+  }
+
+  uint64_t *trace = malloc(length * sizeof(*trace));
+  uint64_t state = 42;
+  for (size_t i = 0; i < length; ++i) {
+    double u = (double)(bench_rand(&state) >> 11) / (double)(1ULL << 53) * sum;
+
+    size_t lo = 0, hi = num_keys - 1;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (cdf[mid] < u) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    trace[i] = lo;
+  }
+
+  free(cdf);
+  return trace;
+}
+
+static void bench_policy(const char *name, enum cache_policy policy,
+                         size_t capacity, struct item *items,
+                         const uint64_t *trace, size_t length) {
+  /* Entries are owned by `items`, so nothing is freed on eviction */
+  cache *cache =
+    cache_create(capacity, policy, hash_item, equal_item, NULL, NULL);
+  size_t hits = 0;
+
+  double start = bench_now();
+  for (size_t i = 0; i < length; ++i) {
+    struct item *item = &items[trace[i]];
+
+    if (cache_get(cache, &item->ce)) {
+      hits++;
+    } else {
+      cache_put(cache, &item->ce, 1);
+    }
+  }
+  double seconds = bench_now() - start;
+
+  char label[64];
+  snprintf(label, sizeof(label), "%s hit rate %.2f%%", name,
+           100.0 * (double)hits / (double)length);
+  bench_report(label, length, seconds);
+
+  cache_destroy(cache);
+}
+
+/* Usage: cache_bench [keys] [trace length] [zipf exponent * 100]
+ *
+ * Every policy replays the same trace with capacity of 1% and 10%
+ * of the keys. Miss is followed by put of the missed key */
+int main(int argc, char **argv) {
+  size_t num_keys = bench_arg(argc, argv, 1, 1000000);
+  size_t length = bench_arg(argc, argv, 2, 10000000);
+  double s = (double)bench_arg(argc, argv, 3, 99) / 100.0;
+
+  uint64_t *trace = make_trace(num_keys, length, s);
+  struct item *items = malloc(num_keys * sizeof(*items));
+  for (size_t i = 0; i < num_keys; ++i) {
+    items[i].key = i;
+  }
+
+  size_t capacities[] = {num_keys / 100, num_keys / 10};
+  for (size_t i = 0; i < sizeof(capacities) / sizeof(*capacities); ++i) {
+    printf("capacity %zu\n", capacities[i]);
+
+    bench_policy("  lru", CACHE_LRU, capacities[i], items, trace, length);
+    bench_policy("  clock", CACHE_CLOCK, capacities[i], items, trace, length);
+    bench_policy("  tinylfu", CACHE_TINYLFU, capacities[i], items, trace,
+                 length);
+  }
+
+  free(items);
+  free(trace);
+
+  return 0;
+}
@@ -0,0 +1,204 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "datastructs/concurrent_hash_table.h"
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+/* Mixed workload: 80% lookups, 10% inserts, 10% removes */
+#define LOOKUP_PERCENT 80
+#define INSERT_PERCENT 10
+
+#define NUM_STRIPES 256
+
+struct item {
+  uint64_t key;
+  bool present;
+
+  struct hash_entry hh;
+};
+
+enum engine { GLOBAL_MUTEX, STRIPED, STRIPED_ORDERED };
+
+struct bench_ctx {
+  enum engine engine;
+
+  hash_table *htable;
+  pthread_mutex_t htable_lock;
+  concurrent_hash_table *chtable;
+
+  struct item *items;
+  size_t num_items;
+  size_t num_threads;
+  size_t ops_per_thread;
+};
+
+struct bench_thread {
+  struct bench_ctx *ctx;
+  size_t id;
+  pthread_t thread;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+static void do_insert(struct bench_ctx *ctx, struct item *item) {
+  if (ctx->engine == GLOBAL_MUTEX) {
+    pthread_mutex_lock(&ctx->htable_lock);
+    htable_insert(ctx->htable, &item->hh);
+    pthread_mutex_unlock(&ctx->htable_lock);
+  } else {
+    chtable_insert(ctx->chtable, &item->hh);
+  }
+}
+
+static void do_remove(struct bench_ctx *ctx, struct item *item) {
+  if (ctx->engine == GLOBAL_MUTEX) {
+    pthread_mutex_lock(&ctx->htable_lock);
+    htable_erase(ctx->htable, &item->hh);
+    pthread_mutex_unlock(&ctx->htable_lock);
+  } else {
+    chtable_erase(ctx->chtable, &item->hh);
+  }
+}
+
+static bool do_lookup(struct bench_ctx *ctx, uint64_t key) {
+  struct item query;
+  struct hash_entry *found;
+
+  query.key = key;
+
+  if (ctx->engine == GLOBAL_MUTEX) {
+    pthread_mutex_lock(&ctx->htable_lock);
+    found = htable_lookup(ctx->htable, &query.hh);
+    pthread_mutex_unlock(&ctx->htable_lock);
+  } else {
+    found = chtable_lookup(ctx->chtable, &query.hh);
+  }
+
+  return found != NULL;
+}
+
+static void *bench_worker(void *arg) {
+  struct bench_thread *self = arg;
+  struct bench_ctx *ctx = self->ctx;
+
+  uint64_t state = 0x9E3779B97F4A7C15ULL * (self->id + 1);
+  size_t hits = 0;
+
+  for (size_t i = 0; i < ctx->ops_per_thread; ++i) {
+    uint64_t rnd = bench_rand(&state);
+    size_t op = rnd % 100;
+    size_t key = (rnd >> 8) % ctx->num_items;
+
+    if (op < LOOKUP_PERCENT) {
+      hits += do_lookup(ctx, key);
+      continue;
+    }
+
+    /* Every thread modifies only keys it owns */
+    key = key - key % ctx->num_threads + self->id;
+    if (key >= ctx->num_items) {
+      continue;
+    }
+
+    struct item *item = &ctx->items[key];
+    if (op < LOOKUP_PERCENT + INSERT_PERCENT) {
+      if (!item->present) {
+        do_insert(ctx, item);
+        item->present = true;
+      }
+    } else if (item->present) {
+      do_remove(ctx, item);
+      item->present = false;
+    }
+  }
+
+  return (void *)(uintptr_t)hits;
+}
+
+static void bench_run(enum engine engine, struct item *items, size_t num_items,
+                      size_t num_threads, size_t ops_per_thread) {
+  static const char *names[] = {"global mutex", "striped", "striped ordered"};
+
+  struct bench_ctx ctx;
+  ctx.engine = engine;
+  ctx.items = items;
+  ctx.num_items = num_items;
+  ctx.num_threads = num_threads;
+  ctx.ops_per_thread = ops_per_thread;
+
+  if (engine == GLOBAL_MUTEX) {
+    ctx.htable = htable_create(1, hash_item, equal_item);
+    pthread_mutex_init(&ctx.htable_lock, NULL);
+  } else {
+    ctx.chtable = chtable_create(NUM_STRIPES, NUM_STRIPES, hash_item,
+                                 equal_item, engine == STRIPED_ORDERED);
+  }
+
+  /* Prefill half of the key space */
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = i;
+    items[i].present = i % 2 == 0;
+    if (items[i].present) {
+      do_insert(&ctx, &items[i]);
+    }
+  }
+
+  struct bench_thread *threads = malloc(num_threads * sizeof(*threads));
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads[i].ctx = &ctx;
+    threads[i].id = i;
+    pthread_create(&threads[i].thread, NULL, bench_worker, &threads[i]);
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    pthread_join(threads[i].thread, NULL);
+  }
+  double elapsed = bench_now() - start;
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s, %zu threads", names[engine], num_threads);
+  bench_report(name, num_threads * ops_per_thread, elapsed);
+
+  free(threads);
+  if (engine == GLOBAL_MUTEX) {
+    htable_destroy(ctx.htable, NULL);
+    pthread_mutex_destroy(&ctx.htable_lock);
+  } else {
+    chtable_destroy(ctx.chtable, NULL);
+  }
+}
+
+/* Usage: concurrent_hashtable_bench [max threads] [keys] [ops per thread] */
+int main(int argc, char **argv) {
+  size_t max_threads = bench_arg(argc, argv, 1, sysconf(_SC_NPROCESSORS_ONLN));
+  size_t num_items = bench_arg(argc, argv, 2, 1000000);
+  size_t ops_per_thread = bench_arg(argc, argv, 3, 2000000);
+
+  struct item *items = malloc(num_items * sizeof(*items));
+  if (!items) {
+    return 1;
+  }
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    bench_run(GLOBAL_MUTEX, items, num_items, threads, ops_per_thread);
+    bench_run(STRIPED, items, num_items, threads, ops_per_thread);
+    bench_run(STRIPED_ORDERED, items, num_items, threads, ops_per_thread);
+  }
+
+  free(items);
+  return 0;
+}
@@ -0,0 +1,273 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/uio.h>
+
+  #define BENCH_IOV
+#endif
+
+#include "datastructs/functions.h"
+
+#include "bench.h"
+
+typedef size_t (*hash_fun)(const void *key, size_t size);
+
+/* Keeps hash values alive so that the loops are not optimized out */
+static volatile size_t sink;
+
+static const size_t key_sizes[] = {4, 8, 16, 32, 64, 256, 1024, 65536};
+
+static void bench_throughput(const char *name, hash_fun hash,
+                             const unsigned char *buffer, size_t total) {
+  char label[96];
+
+  for (size_t i = 0; i < sizeof(key_sizes) / sizeof(key_sizes[0]); ++i) {
+    size_t size = key_sizes[i];
+    size_t num_keys = total / size;
+    double start = bench_now();
+    for (size_t j = 0; j < num_keys; ++j) {
+      sink = hash(buffer + j * size, size);
+    }
+    double seconds = bench_now() - start;
+
+    snprintf(label, sizeof(label), "%s %zu bytes (%.2f GB/s)", name, size,
+             num_keys * size / seconds / 1e9);
+    bench_report(label, num_keys, seconds);
+  }
+}
+
+/* Hashes sequential integers stored in `size` byte keys into 2^16 buckets
+ * and reports the chi-square of bucket counts over low and high bits. For a
+ * good hash it stays close to the number of buckets */
+static void bench_distribution(const char *name, hash_fun hash, size_t size,
+                               size_t num_keys) {
+  enum { BUCKET_BITS = 16, NUM_BUCKETS = 1 << BUCKET_BITS };
+  unsigned char key[64] = {0};
+  size_t *low = calloc(NUM_BUCKETS, sizeof(*low));
+  size_t *high = calloc(NUM_BUCKETS, sizeof(*high));
+
+  for (size_t i = 0; i < num_keys; ++i) {
+    memcpy(key, &i, size < sizeof(i) ? size : sizeof(i));
+    size_t hashv = hash(key, size);
+    low[hashv & (NUM_BUCKETS - 1)]++;
+    high[hashv >> (sizeof(hashv) * 8 - BUCKET_BITS)]++;
+  }
+
+  double expected = (double)num_keys / NUM_BUCKETS;
+  double low_chi = 0;
+  double high_chi = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+    low_chi += (low[i] - expected) * (low[i] - expected) / expected;
+    high_chi += (high[i] - expected) * (high[i] - expected) / expected;
+  }
+
+  printf("%s %zu bytes: chi-square low %.0f high %.0f (expected ~%d)\n", name,
+         size, low_chi, high_chi, NUM_BUCKETS);
+
+  free(high);
+  free(low);
+}
+
+static size_t hash_str(const void *key, size_t size) {
+  (void)size;
+  return yu_hash_str(key);
+}
+
+static size_t hash_wy_str(const void *key, size_t size) {
+  (void)size;
+  return yu_hash_wy_str(key);
+}
+
+static void bench_strings(const char *name, hash_fun hash, size_t length,
+                          size_t num_strings) {
+  char *strings = malloc(num_strings * (length + 1));
+  uint64_t state = 42;
+  char label[96];
+
+  for (size_t i = 0; i < num_strings; ++i) {
+    char *str = strings + i * (length + 1);
+    for (size_t j = 0; j < length; ++j) {
+      str[j] = 'a' + bench_rand(&state) % 26;
+    }
+    str[length] = '\0';
+  }
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_strings; ++i) {
+    sink = hash(strings + i * (length + 1), length);
+  }
+  double seconds = bench_now() - start;
+
+  snprintf(label, sizeof(label), "%s %zu chars", name, length);
+  bench_report(label, num_strings, seconds);
+
+  free(strings);
+}
+
+static const char *simd_names[] = {"scalar", "sse4.2", "avx2", "avx512"};
+
+/* Keys of one block stay in L1 cache, so hashing and not memory is timed */
+#define BATCH_BLOCK 4096
+
+/* Hashes the same keys one by one and by batches of every vector level */
+static void bench_u64_batches(size_t num_keys) {
+  uint64_t keys[BATCH_BLOCK];
+  size_t out[BATCH_BLOCK];
+  size_t num_blocks = num_keys / BATCH_BLOCK + 1;
+  uint64_t state = 42;
+  char label[96];
+
+  for (size_t i = 0; i < BATCH_BLOCK; ++i) {
+    keys[i] = bench_rand(&state);
+  }
+
+  double start = bench_now();
+  for (size_t block = 0; block < num_blocks; ++block) {
+    keys[block % BATCH_BLOCK]++;
+    for (size_t i = 0; i < BATCH_BLOCK; ++i) {
+      out[i] = yu_hash_u64(keys[i]);
+    }
+    sink = out[block % BATCH_BLOCK];
+  }
+  bench_report("yu_hash_u64 one by one", num_blocks * BATCH_BLOCK,
+               bench_now() - start);
+
+  for (enum yu_simd level = YU_SIMD_NONE; level <= YU_SIMD_AVX512; ++level) {
+    if (yu_hash_simd(level) != level) {
+      continue;
+    }
+
+    start = bench_now();
+    for (size_t block = 0; block < num_blocks; ++block) {
+      keys[block % BATCH_BLOCK]++;
+      yu_hash_u64_batch(keys, out, BATCH_BLOCK);
+      sink = out[block % BATCH_BLOCK];
+    }
+    snprintf(label, sizeof(label), "yu_hash_u64_batch %s", simd_names[level]);
+    bench_report(label, num_blocks * BATCH_BLOCK, bench_now() - start);
+  }
+  yu_hash_simd(YU_SIMD_AVX512);
+}
+
+/* Strings are allocated one by one and hashed in shuffled order, like
+ * keys of a bulk load that are scattered over the heap */
+static void bench_str_batches(size_t num_strings) {
+  char **strs = malloc(num_strings * sizeof(*strs));
+  size_t *out = malloc(num_strings * sizeof(*out));
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < num_strings; ++i) {
+    size_t length = 8 + bench_rand(&state) % 24;
+    strs[i] = malloc(length + 1);
+    for (size_t j = 0; j < length; ++j) {
+      strs[i][j] = 'a' + bench_rand(&state) % 26;
+    }
+    strs[i][length] = '\0';
+  }
+  for (size_t i = num_strings - 1; i > 0; --i) {
+    size_t j = bench_rand(&state) % (i + 1);
+    char *tmp = strs[i];
+    strs[i] = strs[j];
+    strs[j] = tmp;
+  }
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_strings; ++i) {
+    out[i] = yu_hash_wy_str(strs[i]);
+  }
+  bench_report("yu_hash_wy_str one by one", num_strings, bench_now() - start);
+
+  start = bench_now();
+  yu_hash_wy_str_batch((const char *const *)strs, out, num_strings);
+  bench_report("yu_hash_wy_str_batch", num_strings, bench_now() - start);
+
+  for (size_t i = 0; i < num_strings; ++i) {
+    free(strs[i]);
+  }
+  free(out);
+  free(strs);
+}
+
+#ifdef BENCH_IOV
+/* Hashes keys that arrive as a prefix and a payload: copied into a
+ * scratch buffer first or hashed in place as fragments */
+static void bench_fragments(size_t num_keys) {
+  static const char prefix[] = "tenant:42:";
+  char payload[256];
+  char scratch[sizeof(prefix) + sizeof(payload)];
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < sizeof(payload); ++i) {
+    payload[i] = 'a' + bench_rand(&state) % 26;
+  }
+
+  for (size_t size = 16; size <= sizeof(payload); size *= 4) {
+    char label[96];
+
+    double start = bench_now();
+    for (size_t i = 0; i < num_keys; ++i) {
+      payload[0] = (char)i;
+      memcpy(scratch, prefix, sizeof(prefix) - 1);
+      memcpy(scratch + sizeof(prefix) - 1, payload, size);
+      sink = yu_hash_fnv1a(scratch, sizeof(prefix) - 1 + size);
+    }
+    snprintf(label, sizeof(label), "fnv1a copy %zu bytes", size);
+    bench_report(label, num_keys, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < num_keys; ++i) {
+      struct iovec iov[] = {
+        {(void *)prefix, sizeof(prefix) - 1},
+        {payload, size},
+      };
+      payload[0] = (char)i;
+      sink = yu_hash_fnv1a_iov(iov, 2);
+    }
+    snprintf(label, sizeof(label), "fnv1a iovec %zu bytes", size);
+    bench_report(label, num_keys, bench_now() - start);
+  }
+}
+#endif
+
+/* Usage: hash_bench [bytes per run] [keys per distribution check] */
+int main(int argc, char **argv) {
+  size_t total = bench_arg(argc, argv, 1, 64 << 20);
+  size_t num_keys = bench_arg(argc, argv, 2, 1 << 22);
+
+  unsigned char *buffer = malloc(total);
+  uint64_t state = 42;
+  for (size_t i = 0; i < total; ++i) {
+    buffer[i] = bench_rand(&state);
+  }
+
+  bench_throughput("fnv1a", yu_hash_fnv1a, buffer, total);
+  bench_throughput("bern", yu_hash_bern, buffer, total);
+  bench_throughput("wy", yu_hash_wy, buffer, total);
+  bench_throughput("crc32c", yu_hash_crc32c, buffer, total);
+
+  static const size_t lengths[] = {8, 24, 100};
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+    bench_strings("yu_hash_str", hash_str, lengths[i], 1 << 20);
+    bench_strings("yu_hash_wy_str", hash_wy_str, lengths[i], 1 << 20);
+  }
+
+  static const size_t sizes[] = {4, 8, 16, 64};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    bench_distribution("fnv1a", yu_hash_fnv1a, sizes[i], num_keys);
+    bench_distribution("bern", yu_hash_bern, sizes[i], num_keys);
+    bench_distribution("wy", yu_hash_wy, sizes[i], num_keys);
+    bench_distribution("crc32c", yu_hash_crc32c, sizes[i], num_keys);
+  }
+
+  bench_u64_batches(num_keys * 16);
+  bench_str_batches(num_keys);
+#ifdef BENCH_IOV
+  bench_fragments(num_keys);
+#endif
+
+  free(buffer);
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+#define QUERY_BATCH 64
+
+struct item {
+  uint64_t key;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+static struct item *make_items(size_t num_items) {
+  struct item *items = malloc(num_items * sizeof(*items));
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = bench_rand(&state);
+  }
+
+  /* Shuffle, so entries are not visited in allocation order */
+  for (size_t i = num_items - 1; i > 0; --i) {
+    size_t j = bench_rand(&state) % (i + 1);
+    struct item tmp = items[i];
+    items[i] = items[j];
+    items[j] = tmp;
+  }
+
+  return items;
+}
+
+static void bench_lookup(hash_table *htable, struct item *items,
+                         size_t num_items, size_t num_queries) {
+  struct item *queries = malloc(num_queries * sizeof(*queries));
+  uint64_t state = 7;
+
+  for (size_t i = 0; i < num_queries; ++i) {
+    queries[i].key = items[bench_rand(&state) % num_items].key;
+  }
+
+  size_t found = 0;
+  double start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_lookup(htable, &queries[i].hh) != NULL;
+  }
+  bench_report("lookup loop", num_queries, bench_now() - start);
+
+  struct hash_entry *group[QUERY_BATCH];
+  struct hash_entry *results[QUERY_BATCH];
+
+  start = bench_now();
+  for (size_t i = 0; i < num_queries; i += QUERY_BATCH) {
+    size_t count =
+      num_queries - i < QUERY_BATCH ? num_queries - i : QUERY_BATCH;
+
+    for (size_t j = 0; j < count; ++j) {
+      group[j] = &queries[i + j].hh;
+    }
+
+    htable_lookup_batch(htable, group, results, count);
+    for (size_t j = 0; j < count; ++j) {
+      found += results[j] != NULL;
+    }
+  }
+  bench_report("lookup batch", num_queries, bench_now() - start);
+
+  if (found != num_queries * 2) {
+    printf("unexpected number of hits: %zu\n", found);
+  }
+
+  free(queries);
+}
+
+/* Usage: hashtable_bench [entries] [queries] */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 4000000);
+  size_t num_queries = bench_arg(argc, argv, 2, 10000000);
+
+  struct item *items = make_items(num_items);
+  if (!items) {
+    return 1;
+  }
+
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_insert(htable, &items[i].hh);
+  }
+  bench_report("insert loop", num_items, bench_now() - start);
+
+  bench_lookup(htable, items, num_items, num_queries);
+
+  htable_destroy(htable, NULL);
+  free(items);
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+struct item {
+  uint64_t key;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+static void bench_insert(struct item *items, size_t num_items) {
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_insert(htable, &items[i].hh);
+  }
+  bench_report("htable_insert loop", num_items, bench_now() - start);
+
+  htable_destroy(htable, NULL);
+}
+
+static void bench_build(struct item *items, struct hash_entry **entries,
+                        size_t num_items, size_t num_threads) {
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+
+  char name[64];
+  snprintf(name, sizeof(name), "htable_build_parallel %zu threads",
+           num_threads);
+
+  double start = bench_now();
+  htable_build_parallel(htable, entries, num_items, num_threads);
+  bench_report(name, num_items, bench_now() - start);
+
+  size_t found = 0;
+  for (size_t i = 0; i < num_items; i += 97) {
+    found += htable_lookup(htable, &items[i].hh) == &items[i].hh;
+  }
+  if (found != (num_items + 96) / 97) {
+    printf("%s: lost entries\n", name);
+  }
+
+  htable_destroy(htable, NULL);
+}
+
+/* Usage: hashtable_build_bench [entries] [max threads]
+ *
+ * Parallel build runs with 1, 2, 4, ... threads up to `max threads` */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 10000000);
+  size_t max_threads = bench_arg(argc, argv, 2, 8);
+
+  struct item *items = malloc(num_items * sizeof(*items));
+  struct hash_entry **entries = malloc(num_items * sizeof(*entries));
+  uint64_t state = 42;
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = bench_rand(&state);
+    entries[i] = &items[i].hh;
+  }
+
+  bench_insert(items, num_items);
+  for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    bench_build(items, entries, num_items, num_threads);
+  }
+
+  free(entries);
+  free(items);
+
+  return 0;
+}
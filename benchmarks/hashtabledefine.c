@@ -0,0 +1,124 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+struct item {
+  int64_t key;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_i64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+#define ITEM_HASH(item) yu_hash_i64((item)->key)
+#define ITEM_EQUAL(a, b) ((a)->key == (b)->key)
+
+YU_HTABLE_DEFINE(item_table, struct item, hh, ITEM_HASH, ITEM_EQUAL)
+
+static struct item *make_items(size_t num_items) {
+  struct item *items = malloc(num_items * sizeof(*items));
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = (int64_t)bench_rand(&state);
+  }
+
+  return items;
+}
+
+/* Every second query misses */
+static struct item *make_queries(struct item *items, size_t num_items,
+                                 size_t num_queries) {
+  struct item *queries = malloc(num_queries * sizeof(*queries));
+  uint64_t state = 7;
+
+  for (size_t i = 0; i < num_queries; ++i) {
+    int64_t key = items[bench_rand(&state) % num_items].key;
+    queries[i].key = i % 2 ? ~key : key;
+  }
+
+  return queries;
+}
+
+static void bench_generic(struct item *items, size_t num_items,
+                          struct item *queries, size_t num_queries) {
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_insert(htable, &items[i].hh);
+  }
+  bench_report("generic insert", num_items, bench_now() - start);
+
+  size_t found = 0;
+  start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_lookup(htable, &queries[i].hh) != NULL;
+  }
+  bench_report("generic lookup", num_queries, bench_now() - start);
+
+  start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_remove(htable, &items[i].hh);
+  }
+  bench_report("generic remove", num_items, bench_now() - start);
+
+  printf("generic hits: %zu\n", found);
+  htable_destroy(htable, NULL);
+}
+
+static void bench_defined(struct item *items, size_t num_items,
+                          struct item *queries, size_t num_queries) {
+  hash_table *htable = item_table_create(1);
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    item_table_insert(htable, &items[i]);
+  }
+  bench_report("YU_HTABLE_DEFINE insert", num_items, bench_now() - start);
+
+  size_t found = 0;
+  start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += item_table_lookup(htable, &queries[i]) != NULL;
+  }
+  bench_report("YU_HTABLE_DEFINE lookup", num_queries, bench_now() - start);
+
+  start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    item_table_remove(htable, &items[i]);
+  }
+  bench_report("YU_HTABLE_DEFINE remove", num_items, bench_now() - start);
+
+  printf("YU_HTABLE_DEFINE hits: %zu\n", found);
+  htable_destroy(htable, NULL);
+}
+
+/* Usage: hashtable_define_bench [entries] [queries] */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 1000000);
+  size_t num_queries = bench_arg(argc, argv, 2, 10000000);
+
+  struct item *items = make_items(num_items);
+  struct item *queries = make_queries(items, num_items, num_queries);
+
+  bench_generic(items, num_items, queries, num_queries);
+  bench_defined(items, num_items, queries, num_queries);
+
+  free(queries);
+  free(items);
+
+  return 0;
+}
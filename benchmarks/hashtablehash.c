@@ -0,0 +1,130 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+#define KEY_SIZE 32
+
+struct item {
+  char key[KEY_SIZE];
+
+  struct hash_entry hh;
+};
+
+#define HASH_ITEM_DEF(name, fun)                                               \
+  static size_t name(const struct hash_entry *entry) {                         \
+    return fun(htable_entry(entry, struct item, hh)->key, KEY_SIZE);           \
+  }
+
+HASH_ITEM_DEF(hash_item_fnv1a, yu_hash_fnv1a)
+HASH_ITEM_DEF(hash_item_bern, yu_hash_bern)
+HASH_ITEM_DEF(hash_item_wy, yu_hash_wy)
+HASH_ITEM_DEF(hash_item_crc32c, yu_hash_crc32c)
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return memcmp(htable_entry(a, struct item, hh)->key,
+                htable_entry(b, struct item, hh)->key, KEY_SIZE) == 0;
+}
+
+/* Chain length seen by a successful lookup of every entry and the longest
+ * chain. Uniform hash gives about `1 + load / 2` on average */
+static void report_chains(const char *name, hash_table *htable,
+                          struct item *items, size_t num_items,
+                          ht_hash_fun hash) {
+  size_t total = 0;
+  size_t longest = 0;
+
+  for (size_t i = 0; i < num_items; ++i) {
+    struct hash_bucket *bucket = htable_bucket_for(htable, hash(&items[i].hh));
+    size_t length = 0;
+    for (struct hash_entry *entry = bucket->entry; entry;
+         entry = entry->next) {
+      ++length;
+    }
+    total += length;
+    longest = length > longest ? length : longest;
+  }
+
+  printf("%s: load %.2f, mean chain %.3f, longest chain %zu\n", name,
+         (double)num_items / htable_num_buckets(htable),
+         (double)total / num_items, longest);
+}
+
+static void bench_hash(const char *name, ht_hash_fun hash, struct item *items,
+                       size_t num_items, const size_t *queries,
+                       size_t num_queries) {
+  hash_table *htable = htable_create(1, hash, equal_item);
+  char label[96];
+
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_insert(htable, &items[i].hh);
+  }
+  report_chains(name, htable, items, num_items, hash);
+
+  size_t found = 0;
+  double start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_lookup(htable, &items[queries[i]].hh) != NULL;
+  }
+  snprintf(label, sizeof(label), "%s lookup", name);
+  bench_report(label, num_queries, bench_now() - start);
+
+  if (found != num_queries) {
+    printf("%s: lost entries\n", name);
+  }
+  htable_destroy(htable, NULL);
+}
+
+static void bench_hashes(const char *keys, struct item *items,
+                         size_t num_items, const size_t *queries,
+                         size_t num_queries) {
+  char name[64];
+
+  snprintf(name, sizeof(name), "fnv1a %s", keys);
+  bench_hash(name, hash_item_fnv1a, items, num_items, queries, num_queries);
+  snprintf(name, sizeof(name), "bern %s", keys);
+  bench_hash(name, hash_item_bern, items, num_items, queries, num_queries);
+  snprintf(name, sizeof(name), "wy %s", keys);
+  bench_hash(name, hash_item_wy, items, num_items, queries, num_queries);
+  snprintf(name, sizeof(name), "crc32c %s", keys);
+  bench_hash(name, hash_item_crc32c, items, num_items, queries, num_queries);
+}
+
+/* Usage: hashtable_hash_bench [entries] [queries]
+ *
+ * Compares hash functions on Hash Table of 32 byte keys, random ones and
+ * formatted numbers that differ in a few bytes */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 1000000);
+  size_t num_queries = bench_arg(argc, argv, 2, 10000000);
+
+  struct item *items = calloc(num_items, sizeof(*items));
+  size_t *queries = malloc(num_queries * sizeof(*queries));
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < num_queries; ++i) {
+    queries[i] = bench_rand(&state) % num_items;
+  }
+
+  for (size_t i = 0; i < num_items; ++i) {
+    for (size_t j = 0; j < KEY_SIZE; ++j) {
+      items[i].key[j] = (char)bench_rand(&state);
+    }
+  }
+  bench_hashes("random", items, num_items, queries, num_queries);
+
+  for (size_t i = 0; i < num_items; ++i) {
+    memset(items[i].key, 0, KEY_SIZE);
+    snprintf(items[i].key, KEY_SIZE, "user:%020zu", i);
+  }
+  bench_hashes("formatted", items, num_items, queries, num_queries);
+
+  free(queries);
+  free(items);
+  return 0;
+}
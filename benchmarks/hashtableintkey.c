@@ -0,0 +1,71 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+struct item {
+  int64_t key;
+
+  struct hash_entry hh;
+};
+
+/* Scalar hash as it was before inline mixers: byte-wise FNV-1a */
+#define ITEM_HASH_FNV(item) yu_hash_fnv1a(&(item)->key, sizeof((item)->key))
+#define ITEM_HASH_MIX(item) yu_hash_i64((item)->key)
+#define ITEM_EQUAL(a, b) ((a)->key == (b)->key)
+
+YU_HTABLE_DEFINE(fnv_table, struct item, hh, ITEM_HASH_FNV, ITEM_EQUAL)
+YU_HTABLE_DEFINE(mix_table, struct item, hh, ITEM_HASH_MIX, ITEM_EQUAL)
+
+#define BENCH_TABLE(name, label, items, num_items)                             \
+  do {                                                                         \
+    hash_table *htable = name##_create(1);                                     \
+    size_t found = 0;                                                          \
+                                                                               \
+    double start = bench_now();                                                \
+    for (size_t i = 0; i < (num_items); ++i) {                                 \
+      name##_insert(htable, &(items)[i]);                                      \
+    }                                                                          \
+    bench_report(label " insert", num_items, bench_now() - start);             \
+                                                                               \
+    start = bench_now();                                                       \
+    for (size_t i = 0; i < (num_items); ++i) {                                 \
+      found += name##_lookup(htable, &(items)[i]) != NULL;                     \
+    }                                                                          \
+    bench_report(label " lookup", num_items, bench_now() - start);             \
+                                                                               \
+    if (found != (num_items)) {                                                \
+      printf(label ": lost entries\n");                                        \
+    }                                                                          \
+    htable_destroy(htable, NULL);                                              \
+  } while (0)
+
+/* Usage: hashtable_int_key_bench [entries]
+ *
+ * Inserts and looks up `int64_t` keys hashed with byte-wise FNV-1a and
+ * with the inline `yu_hash_i64` mixer, for random and sequential keys */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 4000000);
+
+  struct item *random = malloc(num_items * sizeof(*random));
+  struct item *sequential = malloc(num_items * sizeof(*sequential));
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < num_items; ++i) {
+    random[i].key = (int64_t)bench_rand(&state);
+    sequential[i].key = (int64_t)i;
+  }
+
+  BENCH_TABLE(fnv_table, "fnv1a random", random, num_items);
+  BENCH_TABLE(mix_table, "yu_hash_i64 random", random, num_items);
+  BENCH_TABLE(fnv_table, "fnv1a sequential", sequential, num_items);
+  BENCH_TABLE(mix_table, "yu_hash_i64 sequential", sequential, num_items);
+
+  free(sequential);
+  free(random);
+  return 0;
+}
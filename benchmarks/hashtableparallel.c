@@ -0,0 +1,83 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+struct item {
+  uint64_t key;
+  uint64_t value;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+static void fold_item(void *acc, const struct hash_entry *entry, void *arg) {
+  YU_UNUSED(arg);
+  *(uint64_t *)acc += htable_entry(entry, struct item, hh)->value;
+}
+
+static void combine_sums(void *acc, const void *other, void *arg) {
+  YU_UNUSED(arg);
+  *(uint64_t *)acc += *(const uint64_t *)other;
+}
+
+/* Usage: hashtable_parallel_bench [entries] [max threads]
+ *
+ * Sums values of every entry sequentially and with parallel reduce
+ * running 1, 2, 4, ... threads up to `max threads` */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 10000000);
+  size_t max_threads = bench_arg(argc, argv, 2, 8);
+
+  struct item *items = malloc(num_items * sizeof(*items));
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = bench_rand(&state);
+    items[i].value = i;
+    htable_insert(htable, &items[i].hh);
+  }
+
+  uint64_t expected = 0;
+  struct item *cur;
+
+  double start = bench_now();
+  htable_for_each(htable, cur, hh) {
+    expected += cur->value;
+  }
+  bench_report("htable_for_each", num_items, bench_now() - start);
+
+  for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    char name[64];
+    snprintf(name, sizeof(name), "htable_parallel_reduce %zu threads",
+             num_threads);
+
+    uint64_t sum = 0;
+    start = bench_now();
+    htable_parallel_reduce(htable, &sum, sizeof(sum), fold_item, combine_sums,
+                           NULL, num_threads);
+    bench_report(name, num_items, bench_now() - start);
+
+    if (sum != expected) {
+      printf("%s: wrong sum\n", name);
+    }
+  }
+
+  htable_destroy(htable, NULL);
+  free(items);
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+struct item {
+  uint64_t key;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+static void bench_policy(const char *name, const struct htable_policy *policy,
+                         struct item *items, size_t num_items,
+                         const size_t *queries, size_t num_queries) {
+  hash_table *htable = htable_create_ex(1, hash_item, equal_item, policy);
+  char label[96];
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_insert(htable, &items[i].hh);
+  }
+  double seconds = bench_now() - start;
+
+  struct htable_policy tuned;
+  htable_get_policy(htable, &tuned);
+  snprintf(label, sizeof(label), "%s insert (%zu buckets, lf %.2f)", name,
+           htable_num_buckets(htable), tuned.load_factor);
+  bench_report(label, num_items, seconds);
+
+  size_t found = 0;
+  start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_lookup(htable, &items[queries[i]].hh) != NULL;
+  }
+  seconds = bench_now() - start;
+
+  snprintf(label, sizeof(label), "%s lookup", name);
+  bench_report(label, num_queries, seconds);
+
+  if (found != num_queries) {
+    printf("%s: lost entries\n", name);
+  }
+
+  htable_destroy(htable, NULL);
+}
+
+/* Usage: hashtable_policy_bench [entries] [queries] */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 4000000);
+  size_t num_queries = bench_arg(argc, argv, 2, 10000000);
+
+  struct item *items = malloc(num_items * sizeof(*items));
+  size_t *queries = malloc(num_queries * sizeof(*queries));
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = bench_rand(&state);
+  }
+  for (size_t i = 0; i < num_queries; ++i) {
+    queries[i] = bench_rand(&state) % num_items;
+  }
+
+  struct htable_policy policy;
+
+  htable_policy_init(&policy);
+  bench_policy("default", &policy, items, num_items, queries, num_queries);
+
+  policy.load_factor = 0.5;
+  policy.bucket_count = HTABLE_BUCKETS_POW2;
+  bench_policy("pow2 lf 0.5", &policy, items, num_items, queries,
+               num_queries);
+
+  htable_policy_init(&policy);
+  policy.load_factor = 1.5;
+  bench_policy("lf 1.5", &policy, items, num_items, queries, num_queries);
+
+  htable_policy_init(&policy);
+  policy.bucket_count = HTABLE_BUCKETS_PRIME;
+  policy.growth_factor = 1.5;
+  bench_policy("prime x1.5", &policy, items, num_items, queries,
+               num_queries);
+
+  htable_policy_init(&policy);
+  policy.target_chain_length = 2;
+  bench_policy("tuned chain 2", &policy, items, num_items, queries,
+               num_queries);
+
+  free(queries);
+  free(items);
+  return 0;
+}
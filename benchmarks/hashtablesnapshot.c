@@ -0,0 +1,142 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+#include "datastructs/hash_table_snapshot.h"
+
+#include "bench.h"
+
+#define RECORDS_PATH "hashtable_snapshot_bench.records"
+#define SNAPSHOT_PATH "hashtable_snapshot_bench.snapshot"
+
+struct item {
+  uint64_t key;
+  uint64_t val;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+static bool write_records(const char *path, size_t num_items) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+
+  uint64_t state = 42;
+  bool ok = true;
+  for (size_t i = 0; ok && i < num_items; ++i) {
+    struct item item = {bench_rand(&state), i, {0}};
+    ok = fwrite(&item, sizeof(item), 1, file) == 1;
+  }
+
+  return fclose(file) == 0 && ok;
+}
+
+/* Restart without a snapshot: read records and insert them one by one */
+static hash_table *rebuild(const char *path, size_t num_items,
+                           struct item **items) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return NULL;
+  }
+
+  *items = malloc(num_items * sizeof(**items));
+  size_t num_read = fread(*items, sizeof(**items), num_items, file);
+  fclose(file);
+
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+  for (size_t i = 0; i < num_read; ++i) {
+    htable_insert(htable, &(*items)[i].hh);
+  }
+
+  return htable;
+}
+
+static size_t lookup_table(hash_table *htable, struct item *queries,
+                           size_t num_queries) {
+  size_t found = 0;
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_lookup(htable, &queries[i].hh) != NULL;
+  }
+  return found;
+}
+
+static size_t lookup_snapshot(htable_snapshot *snapshot, struct item *queries,
+                              size_t num_queries) {
+  size_t found = 0;
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_snapshot_lookup(snapshot, &queries[i].hh) != NULL;
+  }
+  return found;
+}
+
+/* Usage: hashtable_snapshot_bench [entries] [queries]
+ *
+ * Both files are read right after they are written, so they are
+ * served from the page cache: the benchmark measures CPU cost of
+ * loading, not the disk */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 4000000);
+  size_t num_queries = bench_arg(argc, argv, 2, 10000000);
+
+  if (num_items == 0 || !write_records(RECORDS_PATH, num_items)) {
+    return 1;
+  }
+
+  struct item *items;
+  double start = bench_now();
+  hash_table *htable = rebuild(RECORDS_PATH, num_items, &items);
+  bench_report("rebuild with htable_insert", num_items, bench_now() - start);
+
+  if (!htable ||
+      !htable_snapshot_write(htable, SNAPSHOT_PATH, struct item, hh)) {
+    return 1;
+  }
+
+  start = bench_now();
+  htable_snapshot *snapshot =
+    htable_snapshot_open(SNAPSHOT_PATH, hash_item, equal_item);
+  bench_report("snapshot open", num_items, bench_now() - start);
+
+  if (!snapshot) {
+    return 1;
+  }
+
+  struct item *queries = malloc(num_queries * sizeof(*queries));
+  uint64_t state = 7;
+  for (size_t i = 0; i < num_queries; ++i) {
+    queries[i].key = items[bench_rand(&state) % num_items].key;
+  }
+
+  start = bench_now();
+  size_t found = lookup_table(htable, queries, num_queries);
+  bench_report("lookup table", num_queries, bench_now() - start);
+
+  start = bench_now();
+  found += lookup_snapshot(snapshot, queries, num_queries);
+  bench_report("lookup snapshot", num_queries, bench_now() - start);
+
+  if (found != num_queries * 2) {
+    printf("unexpected number of hits: %zu\n", found);
+  }
+
+  free(queries);
+  htable_snapshot_close(snapshot);
+  htable_destroy(htable, NULL);
+  free(items);
+
+  remove(RECORDS_PATH);
+  remove(SNAPSHOT_PATH);
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+
+#include "bench.h"
+
+struct item {
+  uint64_t key;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+static bool less_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key <
+         htable_entry(b, struct item, hh)->key;
+}
+
+static uint64_t key_item(const struct hash_entry *entry) {
+  return htable_entry(entry, struct item, hh)->key;
+}
+
+enum sort_kind { SORT_LIST, SORT_ARRAY, SORT_KEY };
+
+static hash_table *fill_table(struct item *items, size_t num_items) {
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+  htable_reserve(htable, num_items);
+
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_insert(htable, &items[i].hh);
+  }
+
+  return htable;
+}
+
+static bool is_sorted(hash_table *htable) {
+  struct item *prev = NULL, *cur;
+
+  htable_for_each(htable, cur, hh) {
+    if (prev && cur->key < prev->key) {
+      return false;
+    }
+    prev = cur;
+  }
+
+  return true;
+}
+
+static void bench_sort(const char *name, struct item *items, size_t num_items,
+                       enum sort_kind kind, size_t num_threads) {
+  hash_table *htable = fill_table(items, num_items);
+
+  double start = bench_now();
+  switch (kind) {
+  case SORT_LIST:
+    htable_sort(htable, less_item);
+    break;
+  case SORT_ARRAY:
+    htable_sort_array(htable, less_item, num_threads);
+    break;
+  case SORT_KEY:
+    htable_sort_by_key(htable, key_item);
+    break;
+  }
+  bench_report(name, num_items, bench_now() - start);
+
+  if (!is_sorted(htable)) {
+    printf("%s: table is not sorted\n", name);
+  }
+
+  htable_destroy(htable, NULL);
+}
+
+/* Usage: hashtable_sort_bench [entries] [threads] */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 4000000);
+  size_t num_threads = bench_arg(argc, argv, 2, 4);
+
+  struct item *items = malloc(num_items * sizeof(*items));
+  uint64_t state = 42;
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = bench_rand(&state);
+  }
+
+  bench_sort("htable_sort", items, num_items, SORT_LIST, 1);
+  bench_sort("htable_sort_array 1 thread", items, num_items, SORT_ARRAY, 1);
+  bench_sort("htable_sort_array", items, num_items, SORT_ARRAY, num_threads);
+  bench_sort("htable_sort_by_key", items, num_items, SORT_KEY, 1);
+
+  free(items);
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+#include "datastructs/hash_table_snapshot.h"
+#include "datastructs/perfect_hash_table.h"
+
+#include "bench.h"
+
+#define SNAPSHOT_PATH "perfect_hash_table_bench.snapshot"
+#define TABLE_PATH "perfect_hash_table_bench.table"
+
+struct item {
+  uint64_t key;
+  uint64_t val;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+static void report_lookups(const char *name, size_t found, size_t num_queries,
+                           double seconds) {
+  bench_report(name, num_queries, seconds);
+  if (found != num_queries) {
+    printf("%s: lost entries\n", name);
+  }
+}
+
+/* Usage: perfect_hash_table_bench [entries] [queries]
+ *
+ * Compares lookups of the same read-only key set in Hash Table, opened
+ * Hash Table Snapshot and built and opened Perfect Hash Table */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, 4000000);
+  size_t num_queries = bench_arg(argc, argv, 2, 10000000);
+
+  struct item *items = malloc(num_items * sizeof(*items));
+  struct item *queries = malloc(num_queries * sizeof(*queries));
+  uint64_t state = 42;
+
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = bench_rand(&state);
+    items[i].val = i;
+    htable_insert(htable, &items[i].hh);
+  }
+  for (size_t i = 0; i < num_queries; ++i) {
+    queries[i].key = items[bench_rand(&state) % num_items].key;
+  }
+
+  double start = bench_now();
+  perfect_htable *built = phtable_build(htable, hash_item, equal_item);
+  double seconds = bench_now() - start;
+  if (!built) {
+    printf("failed to build perfect hash table\n");
+    return 1;
+  }
+
+  char label[96];
+  snprintf(label, sizeof(label), "phtable_build (%.2f bits per key)",
+           phtable_index_size(built) * 8.0 / num_items);
+  bench_report(label, num_items, seconds);
+
+  htable_snapshot_write(htable, SNAPSHOT_PATH, struct item, hh);
+  phtable_write(built, TABLE_PATH, struct item, hh);
+
+  htable_snapshot *snapshot =
+    htable_snapshot_open(SNAPSHOT_PATH, hash_item, equal_item);
+  perfect_htable *opened = phtable_open(TABLE_PATH, hash_item, equal_item);
+
+  size_t found = 0;
+  start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_lookup(htable, &queries[i].hh) != NULL;
+  }
+  report_lookups("htable_lookup", found, num_queries, bench_now() - start);
+
+  found = 0;
+  start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_snapshot_lookup(snapshot, &queries[i].hh) != NULL;
+  }
+  report_lookups("htable_snapshot_lookup", found, num_queries,
+                 bench_now() - start);
+
+  found = 0;
+  start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += phtable_lookup(built, &queries[i].hh) != NULL;
+  }
+  report_lookups("phtable_lookup built", found, num_queries,
+                 bench_now() - start);
+
+  found = 0;
+  start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += phtable_lookup(opened, &queries[i].hh) != NULL;
+  }
+  report_lookups("phtable_lookup opened", found, num_queries,
+                 bench_now() - start);
+
+  phtable_destroy(opened);
+  phtable_destroy(built);
+  htable_snapshot_close(snapshot);
+  htable_destroy(htable, NULL);
+  remove(SNAPSHOT_PATH);
+  remove(TABLE_PATH);
+
+  free(queries);
+  free(items);
+  return 0;
+}
@@ -0,0 +1,159 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+#include "datastructs/robin_hood_table.h"
+
+#include "bench.h"
+
+/* Default number of entries fills Robin Hood table up to 90% */
+#define DEFAULT_ENTRIES (((size_t)1 << 22) / 10 * 9)
+
+struct item {
+  uint64_t key;
+
+  struct hash_entry hh;
+};
+
+static size_t hash_item(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct item, hh)->key);
+}
+
+static bool equal_item(const struct hash_entry *a, const struct hash_entry *b) {
+  return htable_entry(a, struct item, hh)->key ==
+         htable_entry(b, struct item, hh)->key;
+}
+
+/* Skewed keys differ only in high bits */
+static struct item *make_items(size_t num_items, bool skewed) {
+  struct item *items = malloc(num_items * sizeof(*items));
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < num_items; ++i) {
+    items[i].key = skewed ? (uint64_t)i << 32 : bench_rand(&state);
+  }
+
+  return items;
+}
+
+/* Queries for existing keys or, if `miss` is set, for missing ones */
+static struct item *make_queries(struct item *items, size_t num_items,
+                                 size_t num_queries, bool miss) {
+  struct item *queries = malloc(num_queries * sizeof(*queries));
+  uint64_t state = 7;
+
+  for (size_t i = 0; i < num_queries; ++i) {
+    uint64_t key = items[bench_rand(&state) % num_items].key;
+    queries[i].key = miss ? ~key : key;
+  }
+
+  return queries;
+}
+
+static size_t lookup_chained(hash_table *htable, const char *name,
+                             struct item *queries, size_t num_queries) {
+  size_t found = 0;
+  double start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += htable_lookup(htable, &queries[i].hh) != NULL;
+  }
+  bench_report(name, num_queries, bench_now() - start);
+
+  return found;
+}
+
+static size_t lookup_robin_hood(robin_hood_table *table, const char *name,
+                                struct item *queries, size_t num_queries) {
+  size_t found = 0;
+  double start = bench_now();
+  for (size_t i = 0; i < num_queries; ++i) {
+    found += rhtable_lookup(table, &queries[i].hh) != NULL;
+  }
+  bench_report(name, num_queries, bench_now() - start);
+
+  return found;
+}
+
+static void bench_chained(struct item *items, size_t num_items,
+                          struct item **queries, size_t num_queries) {
+  hash_table *htable = htable_create(1, hash_item, equal_item);
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_insert(htable, &items[i].hh);
+  }
+  bench_report("  chained insert", num_items, bench_now() - start);
+
+  size_t found =
+    lookup_chained(htable, "  chained lookup hit", queries[0], num_queries) +
+    lookup_chained(htable, "  chained lookup miss", queries[1], num_queries);
+
+  start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    htable_erase(htable, &items[i].hh);
+  }
+  bench_report("  chained erase", num_items, bench_now() - start);
+
+  printf("  chained hits: %zu\n", found);
+  htable_destroy(htable, NULL);
+}
+
+static void bench_robin_hood(struct item *items, size_t num_items,
+                             struct item **queries, size_t num_queries) {
+  /* Presize, so the load factor is close to the maximum one */
+  robin_hood_table *table =
+    rhtable_create(num_items + num_items / 9, hash_item, equal_item);
+
+  double start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    rhtable_insert(table, &items[i].hh);
+  }
+  bench_report("  robin hood insert", num_items, bench_now() - start);
+
+  printf("  robin hood load factor: %.2f\n",
+         (double)rhtable_size(table) / (double)rhtable_capacity(table));
+
+  size_t found =
+    lookup_robin_hood(table, "  robin hood lookup hit", queries[0],
+                      num_queries) +
+    lookup_robin_hood(table, "  robin hood lookup miss", queries[1],
+                      num_queries);
+
+  start = bench_now();
+  for (size_t i = 0; i < num_items; ++i) {
+    rhtable_erase(table, &items[i].hh);
+  }
+  bench_report("  robin hood erase", num_items, bench_now() - start);
+
+  printf("  robin hood hits: %zu\n", found);
+  rhtable_destroy(table, NULL);
+}
+
+/* Usage: robin_hood_table_bench [entries] [queries]
+ *
+ * Hits and misses are measured separately, `queries` lookups each */
+int main(int argc, char **argv) {
+  size_t num_items = bench_arg(argc, argv, 1, DEFAULT_ENTRIES);
+  size_t num_queries = bench_arg(argc, argv, 2, 10000000);
+
+  for (int skewed = 0; skewed <= 1; ++skewed) {
+    printf("%s keys\n", skewed ? "skewed" : "random");
+
+    struct item *items = make_items(num_items, skewed);
+    struct item *queries[2] = {
+      make_queries(items, num_items, num_queries, false),
+      make_queries(items, num_items, num_queries, true),
+    };
+
+    bench_chained(items, num_items, queries, num_queries);
+    bench_robin_hood(items, num_items, queries, num_queries);
+
+    free(queries[0]);
+    free(queries[1]);
+    free(items);
+  }
+
+  return 0;
+}
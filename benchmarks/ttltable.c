@@ -0,0 +1,155 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+#include "datastructs/ttl_table.h"
+
+#include "bench.h"
+
+/* Session lives `TTL` ticks after the last access */
+#define TTL 1000
+/* Full scan purge of the plain table runs every `SCAN_INTERVAL` ticks */
+#define SCAN_INTERVAL 100
+
+struct session {
+  uint64_t key;
+  uint64_t deadline;
+
+  struct hash_entry hh;
+  struct ttl_entry te;
+};
+
+static size_t hash_session(const struct hash_entry *entry) {
+  return yu_hash_u64(htable_entry(entry, struct session, hh)->key);
+}
+
+static bool equal_session(const struct hash_entry *a,
+                          const struct hash_entry *b) {
+  return htable_entry(a, struct session, hh)->key ==
+         htable_entry(b, struct session, hh)->key;
+}
+
+static size_t hash_ttl_session(const struct hash_entry *entry) {
+  return yu_hash_u64(ttltable_hash_item(entry, struct session, te)->key);
+}
+
+static bool equal_ttl_session(const struct hash_entry *a,
+                              const struct hash_entry *b) {
+  return ttltable_hash_item(a, struct session, te)->key ==
+         ttltable_hash_item(b, struct session, te)->key;
+}
+
+static void report_ticks(const char *name, size_t ops, double seconds,
+                         double max_tick, size_t size) {
+  char label[96];
+  snprintf(label, sizeof(label), "%s (max tick %.3f ms, %zu live)", name,
+           max_tick * 1e3, size);
+  bench_report(label, ops, seconds);
+}
+
+static void bench_scan(struct session *sessions, size_t num_keys,
+                       size_t num_ticks, size_t ops_per_tick) {
+  hash_table *htable = htable_create(1, hash_session, equal_session);
+  uint64_t state = 42;
+  double max_tick = 0;
+
+  double start = bench_now();
+  for (uint64_t now = 0; now < num_ticks; ++now) {
+    double tick_start = bench_now();
+
+    for (size_t i = 0; i < ops_per_tick; ++i) {
+      struct session *session = &sessions[bench_rand(&state) % num_keys];
+      struct hash_entry *found = htable_lookup(htable, &session->hh);
+
+      if (!found) {
+        htable_insert(htable, &session->hh);
+      }
+      session->deadline = now + TTL;
+    }
+
+    if (now % SCAN_INTERVAL == 0) {
+      struct session *cur, *n;
+
+      htable_for_each_temp(htable, cur, n, hh) {
+        if (cur->deadline <= now) {
+          htable_erase(htable, &cur->hh);
+        }
+      }
+    }
+
+    double tick = bench_now() - tick_start;
+    if (tick > max_tick) {
+      max_tick = tick;
+    }
+  }
+  double seconds = bench_now() - start;
+
+  report_ticks("full scan purge", num_ticks * ops_per_tick, seconds, max_tick,
+               htable_size(htable));
+  htable_destroy(htable, NULL);
+}
+
+static void bench_ttl(struct session *sessions, size_t num_keys,
+                      size_t num_ticks, size_t ops_per_tick, size_t budget) {
+  ttl_table *table =
+    ttltable_create(0, hash_ttl_session, equal_ttl_session, NULL, NULL);
+  uint64_t state = 42;
+  double max_tick = 0;
+
+  double start = bench_now();
+  for (uint64_t now = 0; now < num_ticks; ++now) {
+    double tick_start = bench_now();
+
+    for (size_t i = 0; i < ops_per_tick; ++i) {
+      struct session *session = &sessions[bench_rand(&state) % num_keys];
+      struct ttl_entry *found = ttltable_lookup(table, &session->te, now);
+
+      if (found) {
+        ttltable_set_deadline(table, found, now + TTL);
+      } else {
+        ttltable_insert(table, &session->te, now + TTL);
+      }
+    }
+
+    ttltable_expire(table, now, budget);
+
+    double tick = bench_now() - tick_start;
+    if (tick > max_tick) {
+      max_tick = tick;
+    }
+  }
+  double seconds = bench_now() - start;
+
+  char name[64];
+  snprintf(name, sizeof(name), "ttltable budget %zu", budget);
+  report_ticks(name, num_ticks * ops_per_tick, seconds, max_tick,
+               ttltable_size(table));
+  ttltable_destroy(table);
+}
+
+/* Usage: ttl_table_bench [keys] [ticks] [accesses per tick]
+ *
+ * Every tick random sessions are accessed: missing ones are created and
+ * found ones are extended by `TTL` ticks. Plain table lazily checks
+ * deadlines and purges expired sessions by a periodic full scan */
+int main(int argc, char **argv) {
+  size_t num_keys = bench_arg(argc, argv, 1, 1000000);
+  size_t num_ticks = bench_arg(argc, argv, 2, 5000);
+  size_t ops_per_tick = bench_arg(argc, argv, 3, 1000);
+
+  struct session *sessions = calloc(num_keys, sizeof(*sessions));
+  for (size_t i = 0; i < num_keys; ++i) {
+    sessions[i].key = i;
+  }
+
+  bench_scan(sessions, num_keys, num_ticks, ops_per_tick);
+  /* Sessions are cascaded once from the second level before they expire */
+  bench_ttl(sessions, num_keys, num_ticks, ops_per_tick, 2 * ops_per_tick);
+  bench_ttl(sessions, num_keys, num_ticks, ops_per_tick, SIZE_MAX);
+
+  free(sessions);
+
+  return 0;
+}
@@ -15,36 +15,33 @@ struct user_info {
 };
 
 void add_user(hash_table *htable, int id, char *name) {
-  struct user_info query;
-  query.id = id;
+  struct user_info *user = malloc(sizeof(*user));
+  user->id = id;
+  strcpy(user->name, name);
 
-  struct user_info *user = htable_find(htable, &query, hh);
-  if (user != NULL) {
+  struct hash_entry *existing;
+  htable_find_or_insert(htable, &user->hh, &existing);
+  if (existing != NULL) {
     /* User found */
-    strcpy(user->name, name);
-    return;
+    strcpy(htable_entry(existing, struct user_info, hh)->name, name);
+    free(user);
   }
+}
 
-  /* User not found */
-  user = malloc(sizeof(*user));
-  user->id = id;
-  strcpy(user->name, name);
-
-  htable_add(htable, user, hh);
+bool equal_user_id(const struct hash_entry *entry, const void *key) {
+  struct user_info *user = htable_entry(entry, struct user_info, hh);
+  /* Compare against raw key, no query entry is needed */
+  return user->id == *(const int *)key;
 }
 
 struct user_info *find_user(hash_table *htable, int id) {
-  struct user_info query;
-  query.id = id;
-
-  return htable_find(htable, &query, hh);
+  return htable_find_hashed(htable, yu_hash_i32(id), &id, equal_user_id,
+                            struct user_info, hh);
 }
 
 void delete_user(hash_table *htable, int id) {
-  struct user_info query;
-  query.id = id;
-
-  struct user_info *user = htable_delete(htable, &query, hh);
+  struct user_info *user = htable_delete_hashed(
+    htable, yu_hash_i32(id), &id, equal_user_id, struct user_info, hh);
   free(user);
 }
 
@@ -0,0 +1,143 @@
+/**
+ * @file
+ * @brief Cache
+ *
+ * Bounded cache on top of Hash Table. Entries are kept on the list of all
+ * entries of the table in eviction order, so no extra links are needed:
+ *  - `CACHE_LRU` moves every hit entry to the end of the list;
+ *  - `CACHE_CLOCK` only marks hit entries, eviction gives marked entries
+ *    a second chance by moving them to the end. Hits never relink;
+ *  - `CACHE_TINYLFU` evicts in LRU order, but a new entry is admitted
+ *    only if it was accessed more often than the entry it would evict.
+ *    Frequencies are estimated by an aging count-min sketch.
+ *
+ * Capacity is measured in charges of the entries: use charge `1` to bound
+ * number of entries or entry size to bound memory.
+ *
+ * Cache is not available in compact mode (`YU_HTABLE_COMPACT`).
+ */
+
+#ifndef YU_CACHE_H
+#define YU_CACHE_H
+
+#include "hash_table.h"
+#include "macros.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cache cache;
+
+struct cache_entry {
+  struct hash_entry hh;
+
+  size_t charge;   /* Part of the capacity used by the entry */
+  bool referenced; /* Entry was hit since the last eviction pass */
+};
+
+enum cache_policy { CACHE_LRU, CACHE_CLOCK, CACHE_TINYLFU };
+
+typedef void (*cache_evict_fun)(struct cache_entry *, void *);
+
+/**
+ * @brief Create Cache
+ *
+ * @param capacity Maximum sum of charges of the entries
+ * @param policy Eviction policy
+ * @param hash Function to hash your entry, receives `hh` of the
+ * `struct cache_entry`
+ * @param equal Function to compare two entries
+ * @param evict Function called for every evicted entry, could be `NULL`
+ * @param evict_arg Argument passed to `evict`
+ * @return Cache on success, `NULL` otherwise
+ */
+cache *cache_create(size_t capacity, enum cache_policy policy,
+                    ht_hash_fun hash, ht_equal_fun equal,
+                    cache_evict_fun evict, void *evict_arg);
+
+/**
+ * @brief Destroy Cache
+ *
+ * Every entry left in the cache is passed to the evict function.
+ *
+ * @param cache Cache
+ */
+void cache_destroy(cache *cache);
+
+/**
+ * @brief Lookup entry and mark it as recently used
+ *
+ * @param cache Cache
+ * @param query Query to lookup against
+ * @return Found entry, `NULL` otherwise
+ */
+struct cache_entry *cache_get(cache *cache, struct cache_entry *query);
+
+/**
+ * @brief Insert entry, evicting others if cache is full
+ *
+ * Cache takes ownership of the entry: it stays in the cache or, sooner
+ * or later, is passed to the evict function. Entry equal to the new one
+ * is replaced and evicted. Entry larger than capacity and entry rejected
+ * by `CACHE_TINYLFU` admission are evicted right away.
+ *
+ * @param cache Cache
+ * @param entry Entry to insert
+ * @param charge Part of the capacity used by the entry
+ * @return True on success, false on memory failure. Entry is not taken
+ * on failure
+ */
+bool cache_put(cache *cache, struct cache_entry *entry, size_t charge);
+
+/**
+ * @brief Lookup entry and remove it from the cache
+ *
+ * Removed entry is not passed to the evict function.
+ *
+ * @param cache Cache
+ * @param query Query to lookup against
+ * @return Removed entry, `NULL` if not found
+ */
+struct cache_entry *cache_remove(cache *cache, struct cache_entry *query);
+
+/**
+ * @brief Number of entries in the cache
+ *
+ * @param cache Cache
+ * @return Number of entries
+ */
+size_t cache_size(cache *cache);
+
+/**
+ * @brief Sum of charges of the entries in the cache
+ *
+ * @param cache Cache
+ * @return Used capacity
+ */
+size_t cache_used(cache *cache);
+
+/* Your entry by `struct hash_entry` passed to hash and equal functions */
+#define cache_hash_item(ptr, type, member)                                     \
+  YU_CONTAINER_OF(ptr, type, member.hh)
+
+#define cache_item(ptr, type, member) YU_CONTAINER_OF(ptr, type, member)
+
+#define cache_item_safe(ptr, type, member)                                     \
+  YU_CONTAINER_OF_SAFE(ptr, type, member)
+
+#define cache_find(cache, query, member)                                       \
+  cache_item_safe(cache_get(cache, &(query)->member), yu_typeof(*query),       \
+                  member)
+
+#define cache_add(cache, entry, member, charge)                                \
+  cache_put(cache, &(entry)->member, charge)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !YU_CACHE_H
@@ -0,0 +1,165 @@
+/**
+ * @file
+ * @brief Concurrent Hash Table
+ *
+ * Thread-safe Hash Table. Buckets are split between lock stripes, so
+ * writers that touch different stripes do not contend with each other.
+ * Entries are the same intrusive `struct hash_entry` as in Hash Table.
+ *
+ * Entries returned by lookup stay valid until they are removed,
+ * so it is up to the user to not free entries other threads could use.
+ */
+
+#ifndef YU_CONCURRENT_HASH_TABLE_H
+#define YU_CONCURRENT_HASH_TABLE_H
+
+#include "hash_table.h"
+#include "macros.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct concurrent_hash_table concurrent_hash_table;
+
+typedef void (*ch_destroy_fun)(concurrent_hash_table *);
+typedef void (*ch_visit_fun)(struct hash_entry *, void *);
+
+/**
+ * @brief Create Concurrent Hash Table
+ *
+ * Number of buckets is rounded up to a multiple of number of stripes.
+ *
+ * @param initial_num_buckets Initial number of buckets
+ * @param num_stripes Number of locks buckets are split between
+ * @param hash Function to hash your entry
+ * @param equal Function to compare two entries
+ * @param ordered Maintain insertion order list of entries. Every write
+ * takes an additional lock to update it, pass false to opt out
+ * @return Concurrent Hash Table on success, `NULL` otherwise
+ */
+concurrent_hash_table *chtable_create(size_t initial_num_buckets,
+                                      size_t num_stripes, ht_hash_fun hash,
+                                      ht_equal_fun equal, bool ordered);
+
+/**
+ * @brief Destroy Concurrent Hash Table
+ *
+ * Must not be called while other threads use the table.
+ *
+ * @param htable Concurrent Hash Table
+ * @param destroy Function to destroy your entries, could be `NULL`
+ */
+void chtable_destroy(concurrent_hash_table *htable, ch_destroy_fun destroy);
+
+/**
+ * @brief Rehash Concurrent Hash Table
+ *
+ * Waits for every stripe to be released.
+ *
+ * @param htable Concurrent Hash Table
+ * @param new_num_buckets New number of buckets
+ * @return True on success, false on memory failure
+ */
+bool chtable_rehash(concurrent_hash_table *htable, size_t new_num_buckets);
+
+/**
+ * @brief Insert entry into Concurrent Hash Table
+ *
+ * @param htable Concurrent Hash Table
+ * @param entry Entry to insert
+ * @return True on success, false on memory failure
+ */
+bool chtable_insert(concurrent_hash_table *htable, struct hash_entry *entry);
+
+/**
+ * @brief Replace entry in the Concurrent Hash Table
+ *
+ * @param htable Concurrent Hash Table
+ * @param entry Entry to replace with
+ * @param replaced Replaced entry
+ * @return True on success, false on memory failure
+ */
+bool chtable_replace(concurrent_hash_table *htable, struct hash_entry *entry,
+                     struct hash_entry **replaced);
+
+/**
+ * @brief Lookup entry in the Concurrent Hash Table
+ *
+ * @param htable Concurrent Hash Table
+ * @param query Query to lookup against
+ */
+struct hash_entry *chtable_lookup(concurrent_hash_table *htable,
+                                  struct hash_entry *query);
+
+/**
+ * @brief Lookup entry and remove it from the Concurrent Hash Table
+ *
+ * @param htable Concurrent Hash Table
+ * @param query Query to lookup against
+ */
+struct hash_entry *chtable_remove(concurrent_hash_table *htable,
+                                  struct hash_entry *query);
+
+/**
+ * @brief Remove entry
+ *
+ * Use this function when you want to remove
+ * entry without lookup
+ *
+ * @param htable Concurrent Hash Table
+ * @param entry Entry to remove
+ */
+void chtable_erase(concurrent_hash_table *htable, struct hash_entry *entry);
+
+/**
+ * @brief Visit every entry
+ *
+ * Ordered table visits entries in insertion order. Writers are blocked
+ * while visiting, so `visit` must not call functions of this table.
+ * It is safe to free visited entry inside of `visit`.
+ *
+ * @param htable Concurrent Hash Table
+ * @param visit Function to call for every entry
+ * @param arg Argument passed to `visit`
+ */
+void chtable_for_each(concurrent_hash_table *htable, ch_visit_fun visit,
+                      void *arg);
+
+/**
+ * @brief Number of entries in the Concurrent Hash Table
+ *
+ * Result is approximate while other threads modify the table.
+ *
+ * @param htable Concurrent Hash Table
+ * @return Number of entries
+ */
+size_t chtable_size(concurrent_hash_table *htable);
+
+/**
+ * @brief Number of buckets in the Concurrent Hash Table
+ *
+ * @param htable Concurrent Hash Table
+ * @return Number of buckets
+ */
+size_t chtable_num_buckets(concurrent_hash_table *htable);
+
+#define chtable_find(htable, query, field)                                     \
+  htable_entry_safe(chtable_lookup(htable, &(query)->field),                   \
+                    yu_typeof(*query), field)
+
+#define chtable_delete(htable, query, field)                                   \
+  htable_entry_safe(chtable_remove(htable, &(query)->field),                   \
+                    yu_typeof(*query), field)
+
+#define chtable_add(htable, entry, field)                                      \
+  chtable_insert(htable, &(entry)->field)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !YU_CONCURRENT_HASH_TABLE_H
@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,8 +12,76 @@ extern "C" {
 size_t yu_hash_bern(const void *key, size_t size);
 size_t yu_hash_fnv1a(const void *key, size_t size);
 
+/* Incremental FNV-1a: `init`, any number of `update` and `final` give
+ * the same hash value as `yu_hash_fnv1a` of the concatenated data */
+struct yu_fnv1a_state {
+  size_t hashv;
+};
+
+void yu_hash_fnv1a_init(struct yu_fnv1a_state *state);
+void yu_hash_fnv1a_update(struct yu_fnv1a_state *state, const void *data,
+                          size_t size);
+size_t yu_hash_fnv1a_final(const struct yu_fnv1a_state *state);
+
+#if defined(__unix__) || defined(__APPLE__)
+struct iovec;
+
+/* `yu_hash_fnv1a` of the concatenation of `iovcnt` fragments */
+size_t yu_hash_fnv1a_iov(const struct iovec *iov, size_t iovcnt);
+#endif
+
+/* Hash of the wyhash family: reads up to 48 bytes per step, keys up to
+ * 16 bytes are read by a few overlapping loads without a loop.
+ * Not cryptographic */
+size_t yu_hash_wy(const void *key, size_t size);
+uint64_t yu_hash_wy_seed(const void *key, size_t size, uint64_t seed);
+/* Same as `yu_hash_wy(str, strlen(str))`, NUL is found word by word */
+size_t yu_hash_wy_str(const char *str);
+
+/* Instruction sets used by hashing, from the weakest one */
+enum yu_simd {
+  YU_SIMD_NONE,
+  YU_SIMD_SSE42,
+  YU_SIMD_AVX2,
+  YU_SIMD_AVX512,
+};
+
+/* Batch hashing writes into `out[i]` the same hash value as the scalar
+ * function of `i`-th key. `yu_hash_u64_batch` picks a vector kernel at
+ * runtime by the features of the CPU */
+void yu_hash_u64_batch(const uint64_t *keys, size_t *out, size_t n);
+/* `n` keys of `key_size` bytes each, one after another, `yu_hash_wy` */
+void yu_hash_wy_batch(const void *keys, size_t key_size, size_t *out,
+                      size_t n);
+/* `yu_hash_wy_str`, strings are prefetched ahead */
+void yu_hash_wy_str_batch(const char *const *strs, size_t *out, size_t n);
+
+/* CRC32C of two interleaved lanes mixed into 64 bits. Runs the SSE4.2
+ * `crc32` instruction when the CPU has it and a table otherwise, both give
+ * the same hash value */
+size_t yu_hash_crc32c(const void *key, size_t size);
+
+/* Limits hashing to `max_level` and returns the level in use, which
+ * is lower if the CPU lacks `max_level`. Not thread safe, meant for tests
+ * and benchmarks */
+enum yu_simd yu_hash_simd(enum yu_simd max_level);
+
+/* Finalizer of splitmix64. It is a bijection, so distinct keys never
+ * collide before reduction, and every input bit affects every output bit */
+static inline uint64_t yu_hash_mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= UINT64_C(0xbf58476d1ce4e5b9);
+  x ^= x >> 27;
+  x *= UINT64_C(0x94d049bb133111eb);
+  x ^= x >> 31;
+  return x;
+}
+
+/* Scalar hashes are inline, so a compiler folds them into the caller */
 #define FUNCTION_DECL(type, postfix)                                           \
-  size_t yu_hash_##postfix(type key);                                          \
+  static inline size_t yu_hash_##postfix(type key) {                           \
+    return (size_t)yu_hash_mix64((uint64_t)key);                               \
+  }                                                                            \
   int yu_cmp_##postfix(const void *a, const void *b);
 
 FUNCTION_DECL(int64_t, i64)
@@ -23,9 +92,30 @@ FUNCTION_DECL(uint64_t, u64)
 FUNCTION_DECL(uint32_t, u32)
 FUNCTION_DECL(uint16_t, u16)
 FUNCTION_DECL(uint8_t, u8)
-FUNCTION_DECL(double, double)
-FUNCTION_DECL(float, float)
-FUNCTION_DECL(void *, ptr)
+
+/* Floating point keys are hashed by their bits, zero and negative zero
+ * are equal keys and get the same hash */
+static inline size_t yu_hash_double(double key) {
+  uint64_t bits = 0;
+  key = key == 0 ? 0 : key;
+  memcpy(&bits, &key, sizeof(key));
+  return (size_t)yu_hash_mix64(bits);
+}
+
+static inline size_t yu_hash_float(float key) {
+  uint32_t bits = 0;
+  key = key == 0 ? 0 : key;
+  memcpy(&bits, &key, sizeof(key));
+  return (size_t)yu_hash_mix64(bits);
+}
+
+static inline size_t yu_hash_ptr(void *key) {
+  return (size_t)yu_hash_mix64((uintptr_t)key);
+}
+
+int yu_cmp_double(const void *a, const void *b);
+int yu_cmp_float(const void *a, const void *b);
+int yu_cmp_ptr(const void *a, const void *b);
 
 char *yu_dup_str(const char *str);
 size_t yu_hash_str(const char *str);
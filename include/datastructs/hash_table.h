@@ -10,6 +10,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,10 +23,24 @@ extern "C" {
 
 typedef struct hash_table hash_table;
 
+/*
+ * When `YU_HTABLE_COMPACT` is defined (CMake option
+ * `DATASTRUCTS_HTABLE_COMPACT`), entries are not linked into the list
+ * of all entries and `struct hash_entry` is half of its usual size.
+ * Compact tables:
+ *  - are iterated bucket by bucket, not in insertion order,
+ *    iteration finishes incremental rehash;
+ *  - have no `htable_sort`, `htable_next` and `htable_prev`,
+ *    use `htable_next_in` and `htable_prev_in` instead;
+ *  - are not shrunk by `htable_remove` and `htable_erase`,
+ *    use `htable_shrink_to_fit` instead.
+ */
 struct hash_entry {
+#ifndef YU_HTABLE_COMPACT
   /* List of all entries */
   struct hash_entry *ht_next;
   struct hash_entry *ht_prev;
+#endif
 
   struct hash_entry *next; /* Pointer to next entry in current bucket */
 
@@ -42,6 +57,51 @@ typedef bool (*ht_equal_fun)(const struct hash_entry *,
 typedef bool (*ht_less_fun)(const struct hash_entry *,
                             const struct hash_entry *);
 typedef size_t (*ht_hash_fun)(const struct hash_entry *);
+typedef uint64_t (*ht_key_fun)(const struct hash_entry *);
+typedef bool (*ht_key_equal_fun)(const struct hash_entry *, const void *);
+typedef void (*ht_scan_fun)(struct hash_entry *, void *);
+typedef void (*ht_visit_fun)(struct hash_entry *, void *);
+typedef void (*ht_fold_fun)(void *, const struct hash_entry *, void *);
+typedef void (*ht_combine_fun)(void *, const void *, void *);
+
+/* Numbers of buckets a table could have */
+enum htable_bucket_count {
+  /* Initial count multiplied by the growth factor, bucket is found by `%` */
+  HTABLE_BUCKETS_ANY,
+  /* Powers of two, bucket is found by a mask of the low bits of hash
+   * value, so the hash function must mix them well. Growth factor is
+   * rounded up to a power of two */
+  HTABLE_BUCKETS_POW2,
+  /* Primes, bucket is found by `%`. Tolerates weak hash functions */
+  HTABLE_BUCKETS_PRIME,
+};
+
+/* Sizing policy of the Hash Table */
+struct htable_policy {
+  /* Table grows when it has more entries per bucket than this */
+  double load_factor;
+  /* Number of buckets is multiplied by this on growth, greater than 1 */
+  double growth_factor;
+  /* Table shrinks when it has fewer entries per bucket than this,
+   * `0` disables automatic shrinking */
+  double shrink_load_factor;
+  enum htable_bucket_count bucket_count;
+  /* Auto-tuning: when positive, buckets are sampled before every growth
+   * and load factor is moved so that average length of non-empty chains
+   * gets close to this value. Uniform hash gives about 1.4 at load
+   * factor 0.7 and 2 at load factor 1.5 */
+  double target_chain_length;
+};
+
+/**
+ * @brief Fill policy with defaults of `htable_create`
+ *
+ * Load factor is 0.7, the table doubles on growth, halves below load
+ * factor 0.175 and is not auto-tuned.
+ *
+ * @param policy Policy to fill
+ */
+void htable_policy_init(struct htable_policy *policy);
 
 /**
  * @brief Create Hash Table
@@ -54,6 +114,33 @@ typedef size_t (*ht_hash_fun)(const struct hash_entry *);
 hash_table *htable_create(size_t initial_num_buckets, ht_hash_fun hash,
                           ht_equal_fun equal);
 
+/**
+ * @brief Create Hash Table with sizing policy
+ *
+ * Initial number of buckets, as well as the one passed to `htable_rehash`,
+ * is rounded up to the closest count allowed by the policy.
+ *
+ * @param initial_num_buckets Initial number of buckets
+ * @param hash Function to hash your entry
+ * @param equal Function to compare two entries
+ * @param policy Sizing policy, `NULL` for defaults
+ * @return Hash Table on success, `NULL` otherwise
+ */
+hash_table *htable_create_ex(size_t initial_num_buckets, ht_hash_fun hash,
+                             ht_equal_fun equal,
+                             const struct htable_policy *policy);
+
+/**
+ * @brief Get current sizing policy
+ *
+ * Load factors differ from the ones passed to `htable_create_ex` once
+ * auto-tuning has changed them.
+ *
+ * @param htable Hash Table
+ * @param policy Policy to fill
+ */
+void htable_get_policy(hash_table *htable, struct htable_policy *policy);
+
 /**
  * @brief Destroy Hash Table
  *
@@ -71,6 +158,58 @@ void htable_destroy(hash_table *htable, ht_destroy_fun destroy);
  */
 bool htable_rehash(hash_table *htable, size_t new_num_buckets);
 
+/**
+ * @brief Reserve space for entries
+ *
+ * Grows the table once, so that `num_items` entries could be inserted
+ * without another rehash. Table does not shrink automatically below
+ * reserved size until `htable_shrink_to_fit` is called.
+ *
+ * Table is also shrunk automatically by `htable_remove` and `htable_erase`
+ * when it becomes sparse, but never below its initial number of buckets.
+ *
+ * @param htable Hash Table
+ * @param num_items Number of entries
+ * @return True on success, false on memory failure
+ */
+bool htable_reserve(hash_table *htable, size_t num_items);
+
+/**
+ * @brief Shrink table to fit its entries
+ *
+ * Steps number of buckets back by the growth factor while current
+ * entries still fit. Also drops the limit set by `htable_reserve` and
+ * initial number of buckets, so that automatic shrinking never goes
+ * below the new size.
+ *
+ * @param htable Hash Table
+ * @return True on success, false on memory failure
+ */
+bool htable_shrink_to_fit(hash_table *htable);
+
+/**
+ * @brief Enable or disable incremental rehash
+ *
+ * When enabled, growing the table keeps old and new buckets
+ * alive together and every insert, lookup or remove migrates
+ * a bounded number of old buckets. That removes latency spikes
+ * caused by relinking every entry inside one insert.
+ *
+ * Explicit `htable_rehash` is never incremental.
+ *
+ * @param htable Hash Table
+ * @param incremental True to enable, false to disable
+ */
+void htable_set_incremental(hash_table *htable, bool incremental);
+
+/**
+ * @brief Checks if incremental rehash is in progress
+ *
+ * @param htable Hash Table
+ * @return True if old buckets are still being migrated, false otherwise
+ */
+bool htable_rehashing(hash_table *htable);
+
 /**
  * @brief Insert entry into Hash Table
  *
@@ -91,6 +230,20 @@ bool htable_insert(hash_table *htable, struct hash_entry *entry);
 bool htable_replace(hash_table *htable, struct hash_entry *entry,
                     struct hash_entry **replaced);
 
+/**
+ * @brief Lookup entry and insert it if it is not in the Hash Table
+ *
+ * Hashes the entry and walks its bucket once, unlike `htable_lookup`
+ * followed by `htable_insert`.
+ *
+ * @param htable Hash Table
+ * @param entry Entry to insert if equal one is not found
+ * @param existing Found entry, `NULL` if `entry` was inserted
+ * @return True on success, false on memory failure
+ */
+bool htable_find_or_insert(hash_table *htable, struct hash_entry *entry,
+                           struct hash_entry **existing);
+
 /**
  * @brief Lookup entry in the Hash Table
  *
@@ -107,6 +260,36 @@ struct hash_entry *htable_lookup(hash_table *htable, struct hash_entry *query);
  */
 struct hash_entry *htable_remove(hash_table *htable, struct hash_entry *query);
 
+/**
+ * @brief Lookup entry by precomputed hash value and raw key
+ *
+ * No query entry is needed and hash function of the table is not
+ * called, so hash value computed once could be used for several tables.
+ *
+ * @param htable Hash Table
+ * @param hashv Hash value of the key, must be equal to what hash function
+ * of the table returns for entries with this key
+ * @param key Key to lookup, passed to `key_equal` as is
+ * @param key_equal Function to compare entry against the key
+ * @return Found entry, `NULL` otherwise
+ */
+struct hash_entry *htable_lookup_hashed(hash_table *htable, size_t hashv,
+                                        const void *key,
+                                        ht_key_equal_fun key_equal);
+
+/**
+ * @brief Lookup entry by precomputed hash value and raw key and remove it
+ *
+ * @param htable Hash Table
+ * @param hashv Hash value of the key
+ * @param key Key to lookup, passed to `key_equal` as is
+ * @param key_equal Function to compare entry against the key
+ * @return Removed entry, `NULL` if not found
+ */
+struct hash_entry *htable_remove_hashed(hash_table *htable, size_t hashv,
+                                        const void *key,
+                                        ht_key_equal_fun key_equal);
+
 /**
  * @brief Remove entry
  *
@@ -118,6 +301,108 @@ struct hash_entry *htable_remove(hash_table *htable, struct hash_entry *query);
  */
 void htable_erase(hash_table *htable, struct hash_entry *entry);
 
+/**
+ * @brief Lookup multiple entries in the Hash Table
+ *
+ * Queries are processed in groups: every query of a group is hashed
+ * and its bucket is prefetched, then first entries of the chains are
+ * prefetched and only then entries are compared. That overlaps
+ * memory misses of different queries.
+ *
+ * @param htable Hash Table
+ * @param queries Queries to lookup against
+ * @param results Found entries, `NULL` for missing ones
+ * @param n Number of queries
+ */
+void htable_lookup_batch(hash_table *htable, struct hash_entry **queries,
+                         struct hash_entry **results, size_t n);
+
+/**
+ * @brief Lookup multiple entries and remove them from the Hash Table
+ *
+ * Uses the same pipeline as `htable_lookup_batch`.
+ *
+ * @param htable Hash Table
+ * @param queries Queries to lookup against
+ * @param results Removed entries, `NULL` for missing ones
+ * @param n Number of queries
+ */
+void htable_remove_batch(hash_table *htable, struct hash_entry **queries,
+                         struct hash_entry **results, size_t n);
+
+/**
+ * @brief Insert multiple entries into Hash Table
+ *
+ * Table grows at most once before anything is inserted. Uses
+ * the same pipeline as `htable_lookup_batch`.
+ *
+ * @param htable Hash Table
+ * @param entries Entries to insert
+ * @param n Number of entries
+ * @return True on success, false on memory failure. Nothing is inserted
+ * on failure
+ */
+bool htable_insert_batch(hash_table *htable, struct hash_entry **entries,
+                         size_t n);
+
+/**
+ * @brief Build Hash Table from an array of entries in parallel
+ *
+ * Table is grown once, then every one of `num_threads` threads hashes its
+ * part of the array and pushes entries into buckets with atomic
+ * compare-and-swap. Entries are appended to the insertion order list in
+ * the order of the array. Like `htable_insert_batch`, duplicates are not
+ * checked. Threads are used only if the library is built with pthreads.
+ *
+ * @param htable Hash Table, must not be used by other threads meanwhile
+ * @param entries Entries to insert
+ * @param n Number of entries
+ * @param num_threads Maximum number of threads, `1` builds in calling thread
+ * @return True on success, false on memory failure. Nothing is inserted
+ * on failure
+ */
+bool htable_build_parallel(hash_table *htable, struct hash_entry **entries,
+                           size_t n, size_t num_threads);
+
+/**
+ * @brief Insert entry with precomputed hash value
+ *
+ * Insert counterpart of `htable_lookup_hashed`, also used by
+ * `YU_HTABLE_DEFINE`. `hashv` must be equal to what the hash function
+ * of the table returns for this entry.
+ *
+ * @param htable Hash Table
+ * @param entry Entry to insert
+ * @param hashv Hash value of the entry
+ * @return True on success, false on memory failure
+ */
+bool htable_insert_hashed(hash_table *htable, struct hash_entry *entry,
+                          size_t hashv);
+
+/**
+ * @brief Bucket that holds entries with given hash value
+ *
+ * Building block of `YU_HTABLE_DEFINE`. Bucket is valid until
+ * the table is modified.
+ *
+ * @param htable Hash Table
+ * @param hashv Hash value
+ * @return Bucket, entries are chained through `next`
+ */
+struct hash_bucket *htable_bucket_for(hash_table *htable, size_t hashv);
+
+/**
+ * @brief Remove entry by link to it
+ *
+ * Building block of `YU_HTABLE_DEFINE`.
+ *
+ * @param htable Hash Table
+ * @param link Pointer to the entry: `entry` field of the bucket returned
+ * by `htable_bucket_for` or `next` field of the previous entry
+ */
+void htable_unlink(hash_table *htable, struct hash_entry **link);
+
+#ifndef YU_HTABLE_COMPACT
 /**
  * @brief Sort table
  *
@@ -132,6 +417,105 @@ void htable_erase(hash_table *htable, struct hash_entry *entry);
  */
 void htable_sort(hash_table *htable, ht_less_fun less);
 
+/**
+ * @brief Sort table through an array of entry pointers
+ *
+ * Time Complexity: O(n * log(n)).
+ * Space Complexity: O(n)
+ *
+ * Copies pointers to entries into an array, merge sorts it and relinks
+ * the list in one pass, so it does not chase list pointers on every pass
+ * like `htable_sort` does. Large tables are split between `num_threads`
+ * threads, sorted runs are then merged pairwise in parallel. Threads are
+ * used only if the library is built with pthreads. Sort is stable.
+ *
+ * @param htable Hash Table
+ * @param less Function to compare two entries, must be thread-safe
+ * @param num_threads Maximum number of threads, `1` sorts in calling thread
+ * @return True on success, false on memory failure. Table is not changed
+ * on failure
+ */
+bool htable_sort_array(hash_table *htable, ht_less_fun less,
+                       size_t num_threads);
+
+/**
+ * @brief Sort table by integer key
+ *
+ * Time Complexity: O(n).
+ * Space Complexity: O(n)
+ *
+ * LSD radix sort of keys extracted once per entry. Keys are compared
+ * as unsigned, flip the sign bit of signed keys. Sort is stable.
+ *
+ * @param htable Hash Table
+ * @param key Function to extract key of the entry
+ * @return True on success, false on memory failure. Table is not changed
+ * on failure
+ */
+bool htable_sort_by_key(hash_table *htable, ht_key_fun key);
+#endif
+
+/**
+ * @brief Call function for every entry using multiple threads
+ *
+ * Buckets are split into `num_threads` ranges, each range is visited
+ * by its own thread. Entries are visited in no particular order.
+ * Threads are used only if the library is built with pthreads.
+ *
+ * @param htable Hash Table, must not be modified until the call returns
+ * @param fn Function called for every entry, must be thread-safe and
+ * must not modify the table
+ * @param arg Argument passed to `fn`
+ * @param num_threads Maximum number of threads, `1` visits in calling thread
+ */
+void htable_parallel_for_each(hash_table *htable, ht_visit_fun fn, void *arg,
+                              size_t num_threads);
+
+/**
+ * @brief Fold every entry into accumulator using multiple threads
+ *
+ * Every thread gets a copy of `acc` and folds its range of buckets into
+ * it with `fold(thread_acc, entry, arg)`. Then accumulators of the threads
+ * are merged into `acc` with `combine(acc, thread_acc, arg)`. Initial
+ * value of `acc` must be identity of `combine`.
+ *
+ * @param htable Hash Table, must not be modified until the call returns
+ * @param acc Initial value of accumulator and the result
+ * @param acc_size Size of accumulator, it is copied byte by byte
+ * @param fold Function to fold entry into accumulator, must be thread-safe
+ * @param combine Function to merge two accumulators
+ * @param arg Argument passed to `fold` and `combine`
+ * @param num_threads Maximum number of threads, `1` folds in calling thread
+ * @return True on success, false on memory failure
+ */
+bool htable_parallel_reduce(hash_table *htable, void *acc, size_t acc_size,
+                            ht_fold_fun fold, ht_combine_fun combine,
+                            void *arg, size_t num_threads);
+
+/**
+ * @brief Visit a few buckets of the Hash Table
+ *
+ * Start with cursor `0` and pass returned cursor to the next call until
+ * it returns `0`. Table could be modified and resized between calls:
+ * every entry that is in the table for the whole scan is visited at
+ * least once, though some entries could be visited more than once.
+ * Buckets split by resizes are visited in reverse-binary order of their
+ * index, as Redis SCAN does. The guarantee does not hold if
+ * `htable_rehash` or growth factor other than 2 changes the odd factor
+ * of the number of buckets.
+ *
+ * `fn` may erase the entry it receives with `htable_erase`, but must not
+ * insert or remove anything else.
+ *
+ * @param htable Hash Table
+ * @param cursor Cursor returned by the previous call, `0` to start
+ * @param fn Function called for every visited entry
+ * @param arg Argument passed to `fn`
+ * @return Cursor for the next call, `0` when the scan is finished
+ */
+size_t htable_scan(hash_table *htable, size_t cursor, ht_scan_fun fn,
+                   void *arg);
+
 /**
  * @brief Number of entries in the Hash Table
  *
@@ -162,6 +546,7 @@ struct hash_entry *htable_first(hash_table *htable);
  */
 struct hash_entry *htable_last(hash_table *htable);
 
+#ifndef YU_HTABLE_COMPACT
 /**
  * @brief Next entry in the Hash Table
  *
@@ -176,6 +561,41 @@ struct hash_entry *htable_next(const struct hash_entry *entry);
  */
 struct hash_entry *htable_prev(const struct hash_entry *entry);
 
+/**
+ * @brief Move entry to the end of the Hash Table
+ *
+ * Only the list of all entries is relinked, so it is O(1) and could
+ * be used to keep entries in least recently used order.
+ *
+ * @param htable Hash Table
+ * @param entry Entry of the table
+ */
+void htable_move_last(hash_table *htable, struct hash_entry *entry);
+#endif
+
+/**
+ * @brief Next entry in the Hash Table
+ *
+ * Works in both regular and compact modes.
+ *
+ * @param htable Hash Table
+ * @param entry Current entry
+ */
+struct hash_entry *htable_next_in(hash_table *htable,
+                                  const struct hash_entry *entry);
+
+/**
+ * @brief Previous entry in the Hash Table
+ *
+ * Works in both regular and compact modes. In compact mode it walks
+ * the bucket chain of the entry from the beginning.
+ *
+ * @param htable Hash Table
+ * @param entry Current entry
+ */
+struct hash_entry *htable_prev_in(hash_table *htable,
+                                  const struct hash_entry *entry);
+
 #define htable_find(htable, query, field)                                      \
   htable_entry_safe(htable_lookup(htable, &(query)->field), yu_typeof(*query), \
                     field)
@@ -186,18 +606,92 @@ struct hash_entry *htable_prev(const struct hash_entry *entry);
 
 #define htable_add(htable, entry, field) htable_insert(htable, &(entry)->field)
 
+#define htable_find_hashed(htable, hashv, key, key_equal, type, field)         \
+  htable_entry_safe(htable_lookup_hashed(htable, hashv, key, key_equal), type, \
+                    field)
+
+#define htable_delete_hashed(htable, hashv, key, key_equal, type, field)       \
+  htable_entry_safe(htable_remove_hashed(htable, hashv, key, key_equal), type, \
+                    field)
+
 #define htable_for_each(htable, cur, field)                                    \
   for (cur = htable_entry_safe(htable_first(htable), yu_typeof(*cur), field);  \
-       cur; cur = htable_entry_safe(htable_next(&cur->field), yu_typeof(*cur), \
-                                    field))
+       cur; cur = htable_entry_safe(htable_next_in(htable, &cur->field),       \
+                                    yu_typeof(*cur), field))
 
 #define htable_for_each_temp(htable, cur, n, field)                            \
   for (cur = htable_entry_safe(htable_first(htable), yu_typeof(*cur), field);  \
-       cur && ((n = htable_entry_safe(htable_next(&cur->field),                \
+       cur && ((n = htable_entry_safe(htable_next_in(htable, &cur->field),     \
                                       yu_typeof(*cur), field)) ||              \
                1);                                                             \
        cur = n)
 
+/*
+ * Defines functions specialized for one entry type:
+ *
+ *   name_create(initial_num_buckets)
+ *   name_insert(htable, entry)
+ *   name_lookup(htable, query)
+ *   name_remove(htable, query)
+ *
+ * `hash_expr(ptr)` and `eq_expr(a, b)` are functions or macros that take
+ * `const type *`. Lookup and remove call them directly, so they could be
+ * inlined, instead of going through function pointers of the table.
+ * Tables created by `name_create` could also be used with every other
+ * `htable_*` function.
+ */
+#define YU_HTABLE_DEFINE(name, type, field, hash_expr, eq_expr)                \
+  static inline size_t name##_hash_entry__(const struct hash_entry *entry) {   \
+    const type *item = htable_entry(entry, type, field);                       \
+    return hash_expr(item);                                                    \
+  }                                                                            \
+                                                                               \
+  static inline bool name##_equal_entry__(const struct hash_entry *a,          \
+                                          const struct hash_entry *b) {        \
+    const type *item_a = htable_entry(a, type, field);                         \
+    const type *item_b = htable_entry(b, type, field);                         \
+    return eq_expr(item_a, item_b);                                            \
+  }                                                                            \
+                                                                               \
+  static inline hash_table *name##_create(size_t initial_num_buckets) {        \
+    return htable_create(initial_num_buckets, name##_hash_entry__,             \
+                         name##_equal_entry__);                                \
+  }                                                                            \
+                                                                               \
+  static inline bool name##_insert(hash_table *htable, type *entry) {          \
+    const type *item = entry;                                                  \
+    return htable_insert_hashed(htable, &entry->field, hash_expr(item));       \
+  }                                                                            \
+                                                                               \
+  static inline type *name##_lookup(hash_table *htable, const type *query) {   \
+    size_t hashv = hash_expr(query);                                           \
+    struct hash_entry *cur = htable_bucket_for(htable, hashv)->entry;          \
+    for (; cur; cur = cur->next) {                                             \
+      if (cur->hashv == hashv) {                                               \
+        type *item = htable_entry(cur, type, field);                           \
+        if (eq_expr((const type *)item, query)) {                              \
+          return item;                                                         \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+    return NULL;                                                               \
+  }                                                                            \
+                                                                               \
+  static inline type *name##_remove(hash_table *htable, const type *query) {   \
+    size_t hashv = hash_expr(query);                                           \
+    struct hash_entry **link = &htable_bucket_for(htable, hashv)->entry;       \
+    for (; *link; link = &(*link)->next) {                                     \
+      if ((*link)->hashv == hashv) {                                           \
+        type *item = htable_entry(*link, type, field);                         \
+        if (eq_expr((const type *)item, query)) {                              \
+          htable_unlink(htable, link);                                         \
+          return item;                                                         \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+    return NULL;                                                               \
+  }
+
 #ifdef __cplusplus
 }
 #endif
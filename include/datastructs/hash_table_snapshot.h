@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @brief Hash Table Snapshot
+ *
+ * Read-only image of a Hash Table stored in a file. Image uses offsets
+ * instead of pointers: bucket offsets, then hash values, then copies of
+ * entries grouped by bucket. Opened image is memory mapped and queried
+ * in place, so loading does not allocate or rehash anything per entry.
+ *
+ * Entries are copied byte by byte, so they must be flat: any pointer
+ * stored in an entry is meaningless after loading. Image could be loaded
+ * only on a platform with the same `size_t` width and byte order.
+ */
+
+#ifndef YU_HASH_TABLE_SNAPSHOT_H
+#define YU_HASH_TABLE_SNAPSHOT_H
+
+#include "hash_table.h"
+#include "macros.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct htable_snapshot htable_snapshot;
+
+/**
+ * @brief Write snapshot of Hash Table into file
+ *
+ * Use `htable_snapshot_write` macro instead of calling it directly.
+ *
+ * @param htable Hash Table
+ * @param path Path to the file, existing file is overwritten
+ * @param entry_size Size of your entry
+ * @param member_offset Offset of `struct hash_entry` inside of your entry
+ * @return True on success, false on memory or I/O failure
+ */
+bool htable_snapshot_save(hash_table *htable, const char *path,
+                          size_t entry_size, size_t member_offset);
+
+/**
+ * @brief Open snapshot
+ *
+ * @param path Path to the file written by `htable_snapshot_save`
+ * @param hash Function that was used to hash entries of the table
+ * @param equal Function to compare two entries
+ * @return Snapshot on success, `NULL` on memory or I/O failure
+ * or if the file is not a valid snapshot
+ */
+htable_snapshot *htable_snapshot_open(const char *path, ht_hash_fun hash,
+                                      ht_equal_fun equal);
+
+/**
+ * @brief Close snapshot
+ *
+ * Entries found in the snapshot become invalid.
+ *
+ * @param snapshot Snapshot
+ */
+void htable_snapshot_close(htable_snapshot *snapshot);
+
+/**
+ * @brief Lookup entry in the snapshot
+ *
+ * @param snapshot Snapshot
+ * @param query Query to lookup against
+ * @return Entry inside of the image, `NULL` if not found. Image is
+ * mapped read-only, found entries must not be modified
+ */
+struct hash_entry *htable_snapshot_lookup(htable_snapshot *snapshot,
+                                          struct hash_entry *query);
+
+/**
+ * @brief Number of entries in the snapshot
+ *
+ * @param snapshot Snapshot
+ * @return Number of entries
+ */
+size_t htable_snapshot_size(htable_snapshot *snapshot);
+
+/**
+ * @brief Entry of the snapshot by its index
+ *
+ * Entries are ordered by buckets, not by insertion order.
+ * Found entries must not be modified.
+ *
+ * @param snapshot Snapshot
+ * @param idx Index less than `htable_snapshot_size`
+ */
+struct hash_entry *htable_snapshot_at(htable_snapshot *snapshot, size_t idx);
+
+#define htable_snapshot_write(htable, path, type, member)                      \
+  htable_snapshot_save(htable, path, sizeof(type), offsetof(type, member))
+
+#define htable_snapshot_find(snapshot, query, field)                           \
+  htable_entry_safe(htable_snapshot_lookup(snapshot, &(query)->field),         \
+                    yu_typeof(*query), field)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !YU_HASH_TABLE_SNAPSHOT_H
@@ -25,6 +25,12 @@
 
 #define YU_UNUSED(param) ((void)(param))
 
+#if defined(__GNUC__) || defined(__clang__)
+  #define YU_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+  #define YU_PREFETCH(addr) ((void)(addr))
+#endif
+
 static inline void *yu_container_of_safe(void *ptr, size_t offset) {
   return ptr ? (char *)ptr - offset : NULL;
 }
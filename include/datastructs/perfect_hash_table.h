@@ -0,0 +1,153 @@
+/**
+ * @file
+ * @brief Perfect Hash Table
+ *
+ * Immutable index over a fixed set of entries built with a minimal perfect
+ * hash function in the style of PTHash. Keys are split into small buckets,
+ * and every bucket stores a 16-bit pilot chosen so that the keys of all
+ * buckets land on distinct positions. Lookup hashes the query, reads the
+ * pilot of its bucket and compares the query with the single entry at the
+ * computed position: there are no chains and no probing. Index takes about
+ * 3 bits per entry.
+ *
+ * Table could be saved into a file and opened later. Like Hash Table
+ * Snapshot, opened file is memory mapped and queried in place, entries
+ * must be flat and the file is only valid on a platform with the same
+ * `size_t` width and byte order.
+ *
+ * Every entry must have its own hash value: building fails if two entries
+ * have equal hash values, e.g. if the same key is passed twice.
+ */
+
+#ifndef YU_PERFECT_HASH_TABLE_H
+#define YU_PERFECT_HASH_TABLE_H
+
+#include "hash_table.h"
+#include "macros.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct perfect_htable perfect_htable;
+
+/**
+ * @brief Build Perfect Hash Table from entries of Hash Table
+ *
+ * Built table refers to the entries, they must outlive it and must not
+ * be modified. Hash Table itself could be destroyed.
+ *
+ * @param htable Hash Table
+ * @param hash Function that was used to hash entries of the table
+ * @param equal Function to compare two entries
+ * @return Perfect Hash Table on success, `NULL` on memory failure or
+ * if two entries have equal hash values
+ */
+perfect_htable *phtable_build(hash_table *htable, ht_hash_fun hash,
+                              ht_equal_fun equal);
+
+/**
+ * @brief Build Perfect Hash Table from array of entries
+ *
+ * Same as `phtable_build`, hash values of the entries are computed.
+ *
+ * @param entries Entries
+ * @param num_items Number of entries, less than 2^32
+ * @param hash Function to hash your entry
+ * @param equal Function to compare two entries
+ * @return Perfect Hash Table on success, `NULL` on memory failure or
+ * if two entries have equal hash values
+ */
+perfect_htable *phtable_build_array(struct hash_entry **entries,
+                                    size_t num_items, ht_hash_fun hash,
+                                    ht_equal_fun equal);
+
+/**
+ * @brief Write Perfect Hash Table into file
+ *
+ * Use `phtable_write` macro instead of calling it directly.
+ *
+ * @param table Perfect Hash Table
+ * @param path Path to the file, existing file is overwritten
+ * @param entry_size Size of your entry
+ * @param member_offset Offset of `struct hash_entry` inside of your entry
+ * @return True on success, false on memory or I/O failure
+ */
+bool phtable_save(perfect_htable *table, const char *path, size_t entry_size,
+                  size_t member_offset);
+
+/**
+ * @brief Open Perfect Hash Table written by `phtable_save`
+ *
+ * @param path Path to the file
+ * @param hash Function that was used to hash entries of the table
+ * @param equal Function to compare two entries
+ * @return Perfect Hash Table on success, `NULL` on memory or I/O failure
+ * or if the file is not a valid table
+ */
+perfect_htable *phtable_open(const char *path, ht_hash_fun hash,
+                             ht_equal_fun equal);
+
+/**
+ * @brief Destroy built or opened Perfect Hash Table
+ *
+ * Entries found in an opened table become invalid.
+ *
+ * @param table Perfect Hash Table
+ */
+void phtable_destroy(perfect_htable *table);
+
+/**
+ * @brief Lookup entry in the Perfect Hash Table
+ *
+ * @param table Perfect Hash Table
+ * @param query Query to lookup against
+ * @return Found entry, `NULL` otherwise. Found entries must not be modified
+ */
+struct hash_entry *phtable_lookup(perfect_htable *table,
+                                  struct hash_entry *query);
+
+/**
+ * @brief Number of entries in the Perfect Hash Table
+ *
+ * @param table Perfect Hash Table
+ * @return Number of entries
+ */
+size_t phtable_size(perfect_htable *table);
+
+/**
+ * @brief Size of the index in bytes
+ *
+ * Index is everything a lookup reads besides entries and their
+ * positions: pilots of the buckets and remapped positions.
+ *
+ * @param table Perfect Hash Table
+ * @return Size of the index
+ */
+size_t phtable_index_size(perfect_htable *table);
+
+/**
+ * @brief Entry of the Perfect Hash Table by its position
+ *
+ * Found entries must not be modified.
+ *
+ * @param table Perfect Hash Table
+ * @param idx Index less than `phtable_size`
+ */
+struct hash_entry *phtable_at(perfect_htable *table, size_t idx);
+
+#define phtable_write(table, path, type, member)                               \
+  phtable_save(table, path, sizeof(type), offsetof(type, member))
+
+#define phtable_find(table, query, field)                                      \
+  htable_entry_safe(phtable_lookup(table, &(query)->field), yu_typeof(*query), \
+                    field)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !YU_PERFECT_HASH_TABLE_H
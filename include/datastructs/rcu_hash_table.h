@@ -0,0 +1,191 @@
+/**
+ * @file
+ * @brief RCU Hash Table
+ *
+ * Hash Table with lock-free lookups. Readers never take a lock: bucket
+ * chains and bucket array are published with atomic stores. Writers are
+ * serialized among themselves. Removed and replaced entries are retired
+ * and passed to the free function only after every reader that could
+ * still see them has left its read-side critical section (epoch based
+ * reclamation).
+ *
+ * Rehash relinks entries in place, so a lookup that misses while it runs
+ * can not tell a missing entry from a moved one and retries until the
+ * rehash is done. Growing the table therefore stalls such lookups for
+ * time proportional to the number of entries. Create the table with
+ * enough buckets or call `rcu_htable_rehash` up front where that matters.
+ *
+ * Entries are the same intrusive `struct hash_entry` as in Hash Table,
+ * but insertion order is not maintained.
+ */
+
+#ifndef YU_RCU_HASH_TABLE_H
+#define YU_RCU_HASH_TABLE_H
+
+#include "hash_table.h"
+#include "macros.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rcu_hash_table rcu_hash_table;
+typedef struct rcu_reader rcu_reader;
+
+typedef void (*rcu_free_fun)(struct hash_entry *);
+
+/**
+ * @brief Create RCU Hash Table
+ *
+ * @param initial_num_buckets Initial number of buckets
+ * @param hash Function to hash your entry
+ * @param equal Function to compare two entries
+ * @param free_entry Function to free entries once no reader can see them.
+ * It is called while writers are blocked and must not use the table
+ * @return RCU Hash Table on success, `NULL` otherwise
+ */
+rcu_hash_table *rcu_htable_create(size_t initial_num_buckets, ht_hash_fun hash,
+                                  ht_equal_fun equal, rcu_free_fun free_entry);
+
+/**
+ * @brief Destroy RCU Hash Table
+ *
+ * Frees every entry that is left in the table or is waiting for
+ * reclamation. Every reader must be unregistered beforehand.
+ *
+ * @param htable RCU Hash Table
+ */
+void rcu_htable_destroy(rcu_hash_table *htable);
+
+/**
+ * @brief Register reader
+ *
+ * Every thread that calls `rcu_htable_lookup` needs its own reader.
+ *
+ * @param htable RCU Hash Table
+ * @return Reader on success, `NULL` otherwise
+ */
+rcu_reader *rcu_htable_reader_register(rcu_hash_table *htable);
+
+/**
+ * @brief Unregister reader
+ *
+ * @param reader Reader outside of read-side critical section
+ */
+void rcu_htable_reader_unregister(rcu_reader *reader);
+
+/**
+ * @brief Enter read-side critical section
+ *
+ * Entries found inside of the critical section stay valid until
+ * `rcu_htable_read_unlock` is called.
+ *
+ * @param reader Reader
+ */
+void rcu_htable_read_lock(rcu_reader *reader);
+
+/**
+ * @brief Leave read-side critical section
+ *
+ * @param reader Reader
+ */
+void rcu_htable_read_unlock(rcu_reader *reader);
+
+/**
+ * @brief Lookup entry in the RCU Hash Table
+ *
+ * Must be called inside of read-side critical section.
+ * Takes no lock. Lookup that misses while a rehash relinks the entries
+ * yields and retries until the rehash is done.
+ *
+ * @param htable RCU Hash Table
+ * @param query Query to lookup against
+ */
+struct hash_entry *rcu_htable_lookup(rcu_hash_table *htable,
+                                     struct hash_entry *query);
+
+/**
+ * @brief Rehash RCU Hash Table
+ *
+ * New bucket array is published atomically, old one is retired.
+ * Lookups that miss while entries are relinked wait for the rehash,
+ * the same holds for the automatic growth on insert.
+ *
+ * @param htable RCU Hash Table
+ * @param new_num_buckets New number of buckets
+ * @return True on success, false on memory failure
+ */
+bool rcu_htable_rehash(rcu_hash_table *htable, size_t new_num_buckets);
+
+/**
+ * @brief Insert entry into RCU Hash Table
+ *
+ * @param htable RCU Hash Table
+ * @param entry Entry to insert
+ * @return True on success, false on memory failure
+ */
+bool rcu_htable_insert(rcu_hash_table *htable, struct hash_entry *entry);
+
+/**
+ * @brief Replace entry in the RCU Hash Table
+ *
+ * Replaced entry is retired.
+ *
+ * @param htable RCU Hash Table
+ * @param entry Entry to replace with
+ * @return True on success, false on memory failure
+ */
+bool rcu_htable_replace(rcu_hash_table *htable, struct hash_entry *entry);
+
+/**
+ * @brief Lookup entry and remove it from the RCU Hash Table
+ *
+ * Removed entry is retired.
+ *
+ * @param htable RCU Hash Table
+ * @param query Query to lookup against
+ * @return True if entry was removed, false otherwise
+ */
+bool rcu_htable_remove(rcu_hash_table *htable, struct hash_entry *query);
+
+/**
+ * @brief Wait for retired entries
+ *
+ * Blocks until every entry retired before this call is freed.
+ * Must not be called inside of read-side critical section.
+ *
+ * @param htable RCU Hash Table
+ */
+void rcu_htable_synchronize(rcu_hash_table *htable);
+
+/**
+ * @brief Number of entries in the RCU Hash Table
+ *
+ * @param htable RCU Hash Table
+ * @return Number of entries
+ */
+size_t rcu_htable_size(rcu_hash_table *htable);
+
+/**
+ * @brief Number of buckets in the RCU Hash Table
+ *
+ * @param htable RCU Hash Table
+ * @return Number of buckets
+ */
+size_t rcu_htable_num_buckets(rcu_hash_table *htable);
+
+#define rcu_htable_find(htable, query, field)                                  \
+  htable_entry_safe(rcu_htable_lookup(htable, &(query)->field),                \
+                    yu_typeof(*query), field)
+
+#define rcu_htable_add(htable, entry, field)                                   \
+  rcu_htable_insert(htable, &(entry)->field)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !YU_RCU_HASH_TABLE_H
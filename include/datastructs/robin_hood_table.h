@@ -0,0 +1,162 @@
+/**
+ * @file
+ * @brief Robin Hood Table
+ *
+ * Open addressing hash table with linear probing. Slots store hash value
+ * and pointer to the entry inline. Insertion moves entries that are
+ * closer to their home slot out of the way, so probe sequence lengths
+ * stay short and even at high load, lookups stop as soon as they meet
+ * an entry closer to its home than the query would be, and removal
+ * shifts following entries back instead of leaving tombstones.
+ *
+ * It stores pointers to the same intrusive `struct hash_entry` as
+ * Hash Table, so entries and callbacks could be shared between engines.
+ */
+
+#ifndef YU_ROBIN_HOOD_TABLE_H
+#define YU_ROBIN_HOOD_TABLE_H
+
+#include "hash_table.h"
+#include "macros.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct robin_hood_table robin_hood_table;
+
+typedef void (*rh_destroy_fun)(robin_hood_table *);
+
+/**
+ * @brief Create Robin Hood Table
+ *
+ * @param initial_capacity Initial number of slots
+ * @param hash Function to hash your entry
+ * @param equal Function to compare two entries
+ * @return Robin Hood Table on success, `NULL` otherwise
+ */
+robin_hood_table *rhtable_create(size_t initial_capacity, ht_hash_fun hash,
+                                 ht_equal_fun equal);
+
+/**
+ * @brief Destroy Robin Hood Table
+ *
+ * @param table Robin Hood Table
+ * @param destroy Function to destroy your entries, could be `NULL`
+ */
+void rhtable_destroy(robin_hood_table *table, rh_destroy_fun destroy);
+
+/**
+ * @brief Rehash Robin Hood Table
+ *
+ * Capacity is rounded up to the power of two.
+ *
+ * @param table Robin Hood Table
+ * @param new_capacity New number of slots
+ * @return True on success, false on memory failure
+ */
+bool rhtable_rehash(robin_hood_table *table, size_t new_capacity);
+
+/**
+ * @brief Insert entry into Robin Hood Table
+ *
+ * @param table Robin Hood Table
+ * @param entry Entry to insert
+ * @return True on success, false on memory failure
+ */
+bool rhtable_insert(robin_hood_table *table, struct hash_entry *entry);
+
+/**
+ * @brief Replace entry in the Robin Hood Table
+ *
+ * @param table Robin Hood Table
+ * @param entry Entry to replace with
+ * @param replaced Replaced entry
+ * @return True on success, false on memory failure
+ */
+bool rhtable_replace(robin_hood_table *table, struct hash_entry *entry,
+                     struct hash_entry **replaced);
+
+/**
+ * @brief Lookup entry in the Robin Hood Table
+ *
+ * @param table Robin Hood Table
+ * @param query Query to lookup against
+ */
+struct hash_entry *rhtable_lookup(robin_hood_table *table,
+                                  struct hash_entry *query);
+
+/**
+ * @brief Lookup entry and remove it from the Robin Hood Table
+ *
+ * @param table Robin Hood Table
+ * @param query Query to lookup against
+ */
+struct hash_entry *rhtable_remove(robin_hood_table *table,
+                                  struct hash_entry *query);
+
+/**
+ * @brief Remove entry
+ *
+ * Use this function when you want to remove
+ * entry without lookup
+ *
+ * @param table Robin Hood Table
+ * @param entry Entry to remove
+ */
+void rhtable_erase(robin_hood_table *table, struct hash_entry *entry);
+
+/**
+ * @brief Number of entries in the Robin Hood Table
+ *
+ * @param table Robin Hood Table
+ * @return Number of entries
+ */
+size_t rhtable_size(robin_hood_table *table);
+
+/**
+ * @brief Number of slots in the Robin Hood Table
+ *
+ * @param table Robin Hood Table
+ * @return Number of slots
+ */
+size_t rhtable_capacity(robin_hood_table *table);
+
+/**
+ * @brief Iterate over the Robin Hood Table
+ *
+ * Finds first occupied slot starting from `*pos` and
+ * moves `*pos` past it. Start iteration with `*pos` equal to 0.
+ * It is safe to free returned entry before the next call, but entries
+ * must not be removed from the table during iteration: removal shifts
+ * following entries back, so some of them would be skipped.
+ *
+ * @param table Robin Hood Table
+ * @param pos Iteration position
+ * @return Entry or `NULL` if there are no more entries
+ */
+struct hash_entry *rhtable_iter(robin_hood_table *table, size_t *pos);
+
+#define rhtable_find(table, query, field)                                      \
+  htable_entry_safe(rhtable_lookup(table, &(query)->field),                    \
+                    yu_typeof(*query), field)
+
+#define rhtable_delete(table, query, field)                                    \
+  htable_entry_safe(rhtable_remove(table, &(query)->field),                    \
+                    yu_typeof(*query), field)
+
+#define rhtable_add(table, entry, field) rhtable_insert(table, &(entry)->field)
+
+#define rhtable_for_each(table, cur, field)                                    \
+  for (size_t yu_rh_pos__ = 0;                                                 \
+       (cur = htable_entry_safe(rhtable_iter(table, &yu_rh_pos__),             \
+                                yu_typeof(*cur), field)) != NULL;)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !YU_ROBIN_HOOD_TABLE_H
@@ -0,0 +1,155 @@
+/**
+ * @file
+ * @brief Swiss Table
+ *
+ * Open addressing hash table with a flat array of 1-byte control bytes
+ * that are probed 16 at a time. It stores pointers to the same intrusive
+ * `struct hash_entry` as Hash Table, so entries and callbacks could be
+ * shared between both engines.
+ */
+
+#ifndef YU_SWISS_TABLE_H
+#define YU_SWISS_TABLE_H
+
+#include "hash_table.h"
+#include "macros.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct swiss_table swiss_table;
+
+typedef void (*sw_destroy_fun)(swiss_table *);
+
+/**
+ * @brief Create Swiss Table
+ *
+ * @param initial_capacity Initial number of slots
+ * @param hash Function to hash your entry
+ * @param equal Function to compare two entries
+ * @return Swiss Table on success, `NULL` otherwise
+ */
+swiss_table *swtable_create(size_t initial_capacity, ht_hash_fun hash,
+                            ht_equal_fun equal);
+
+/**
+ * @brief Destroy Swiss Table
+ *
+ * @param table Swiss Table
+ * @param destroy Function to destroy your entries, could be `NULL`
+ */
+void swtable_destroy(swiss_table *table, sw_destroy_fun destroy);
+
+/**
+ * @brief Rehash Swiss Table
+ *
+ * Capacity is rounded up to the power of two.
+ *
+ * @param table Swiss Table
+ * @param new_capacity New number of slots
+ * @return True on success, false on memory failure
+ */
+bool swtable_rehash(swiss_table *table, size_t new_capacity);
+
+/**
+ * @brief Insert entry into Swiss Table
+ *
+ * @param table Swiss Table
+ * @param entry Entry to insert
+ * @return True on success, false on memory failure
+ */
+bool swtable_insert(swiss_table *table, struct hash_entry *entry);
+
+/**
+ * @brief Replace entry in the Swiss Table
+ *
+ * @param table Swiss Table
+ * @param entry Entry to replace with
+ * @param replaced Replaced entry
+ * @return True on success, false on memory failure
+ */
+bool swtable_replace(swiss_table *table, struct hash_entry *entry,
+                     struct hash_entry **replaced);
+
+/**
+ * @brief Lookup entry in the Swiss Table
+ *
+ * @param table Swiss Table
+ * @param query Query to lookup against
+ */
+struct hash_entry *swtable_lookup(swiss_table *table,
+                                  struct hash_entry *query);
+
+/**
+ * @brief Lookup entry and remove it from the Swiss Table
+ *
+ * @param table Swiss Table
+ * @param query Query to lookup against
+ */
+struct hash_entry *swtable_remove(swiss_table *table,
+                                  struct hash_entry *query);
+
+/**
+ * @brief Remove entry
+ *
+ * Use this function when you want to remove
+ * entry without lookup
+ *
+ * @param table Swiss Table
+ * @param entry Entry to remove
+ */
+void swtable_erase(swiss_table *table, struct hash_entry *entry);
+
+/**
+ * @brief Number of entries in the Swiss Table
+ *
+ * @param table Swiss Table
+ * @return Number of entries
+ */
+size_t swtable_size(swiss_table *table);
+
+/**
+ * @brief Number of slots in the Swiss Table
+ *
+ * @param table Swiss Table
+ * @return Number of slots
+ */
+size_t swtable_capacity(swiss_table *table);
+
+/**
+ * @brief Iterate over the Swiss Table
+ *
+ * Finds first occupied slot starting from `*pos` and
+ * moves `*pos` past it. Start iteration with `*pos` equal to 0.
+ * It is safe to free returned entry before the next call.
+ *
+ * @param table Swiss Table
+ * @param pos Iteration position
+ * @return Entry or `NULL` if there are no more entries
+ */
+struct hash_entry *swtable_iter(swiss_table *table, size_t *pos);
+
+#define swtable_find(table, query, field)                                      \
+  htable_entry_safe(swtable_lookup(table, &(query)->field),                    \
+                    yu_typeof(*query), field)
+
+#define swtable_delete(table, query, field)                                    \
+  htable_entry_safe(swtable_remove(table, &(query)->field),                    \
+                    yu_typeof(*query), field)
+
+#define swtable_add(table, entry, field) swtable_insert(table, &(entry)->field)
+
+#define swtable_for_each(table, cur, field)                                    \
+  for (size_t yu_sw_pos__ = 0;                                                 \
+       (cur = htable_entry_safe(swtable_iter(table, &yu_sw_pos__),             \
+                                yu_typeof(*cur), field)) != NULL;)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !YU_SWISS_TABLE_H
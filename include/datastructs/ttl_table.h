@@ -0,0 +1,167 @@
+/**
+ * @file
+ * @brief TTL Table
+ *
+ * Hash Table whose entries expire at their deadlines. Expired entry is
+ * dropped lazily when lookup finds it, and actively by `ttltable_expire`.
+ * Deadlines are kept in a hierarchical timing wheel: 4 levels of 64 slots,
+ * every level is 64 times coarser than the previous one. Entries of a
+ * coarse slot are cascaded into finer levels when the wheel reaches it.
+ * Setting, changing and removing a deadline is O(1) and expiry never
+ * scans the whole table.
+ *
+ * Time is measured in ticks of any unit chosen by the caller, e.g.
+ * milliseconds. Time passed to the functions must never go back.
+ */
+
+#ifndef YU_TTL_TABLE_H
+#define YU_TTL_TABLE_H
+
+#include "hash_table.h"
+#include "macros.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Deadline of entries that never expire */
+#define TTL_NO_DEADLINE UINT64_MAX
+
+typedef struct ttl_table ttl_table;
+
+struct ttl_entry {
+  struct hash_entry hh;
+
+  /* Slot list of the timing wheel */
+  struct ttl_entry *wheel_next;
+  struct ttl_entry **wheel_pprev; /* `NULL` if entry is not on the wheel */
+
+  uint64_t deadline;
+};
+
+typedef void (*ttl_expire_fun)(struct ttl_entry *, void *);
+
+/**
+ * @brief Create TTL Table
+ *
+ * @param now Current time
+ * @param hash Function to hash your entry, receives `hh` of the
+ * `struct ttl_entry`
+ * @param equal Function to compare two entries
+ * @param expire Function called for every expired entry and for every
+ * entry left on destroy, could be `NULL`
+ * @param expire_arg Argument passed to `expire`
+ * @return TTL Table on success, `NULL` otherwise
+ */
+ttl_table *ttltable_create(uint64_t now, ht_hash_fun hash, ht_equal_fun equal,
+                           ttl_expire_fun expire, void *expire_arg);
+
+/**
+ * @brief Destroy TTL Table
+ *
+ * Every entry left in the table is passed to the expire function.
+ *
+ * @param table TTL Table
+ */
+void ttltable_destroy(ttl_table *table);
+
+/**
+ * @brief Insert entry into TTL Table
+ *
+ * Like `htable_insert`, duplicates are not checked.
+ *
+ * @param table TTL Table
+ * @param entry Entry to insert
+ * @param deadline Time when entry expires, `TTL_NO_DEADLINE` if never
+ * @return True on success, false on memory failure
+ */
+bool ttltable_insert(ttl_table *table, struct ttl_entry *entry,
+                     uint64_t deadline);
+
+/**
+ * @brief Change deadline of the entry
+ *
+ * @param table TTL Table
+ * @param entry Entry of the table
+ * @param deadline New deadline, `TTL_NO_DEADLINE` if never
+ */
+void ttltable_set_deadline(ttl_table *table, struct ttl_entry *entry,
+                           uint64_t deadline);
+
+/**
+ * @brief Lookup entry that has not expired yet
+ *
+ * Found entry that has expired by `now` is removed and passed to
+ * the expire function.
+ *
+ * @param table TTL Table
+ * @param query Query to lookup against
+ * @param now Current time
+ * @return Found entry, `NULL` otherwise
+ */
+struct ttl_entry *ttltable_lookup(ttl_table *table, struct ttl_entry *query,
+                                  uint64_t now);
+
+/**
+ * @brief Lookup entry and remove it from the TTL Table
+ *
+ * Entry is removed whether it has expired or not and it is not passed
+ * to the expire function.
+ *
+ * @param table TTL Table
+ * @param query Query to lookup against
+ * @return Removed entry, `NULL` if not found
+ */
+struct ttl_entry *ttltable_remove(ttl_table *table, struct ttl_entry *query);
+
+/**
+ * @brief Expire entries whose deadlines have passed
+ *
+ * Advances the wheel up to `now` and passes expired entries to the
+ * expire function. Entries cascaded from a coarse slot into finer levels
+ * count against `budget` as well, so a call does bounded work even when
+ * many entries share a deadline. If the budget runs out, the rest is
+ * done by the next calls. Call it periodically, e.g. every tick.
+ *
+ * @param table TTL Table
+ * @param now Current time
+ * @param budget Maximum number of entries to expire or cascade
+ * @return Number of expired entries
+ */
+size_t ttltable_expire(ttl_table *table, uint64_t now, size_t budget);
+
+/**
+ * @brief Number of entries in the TTL Table
+ *
+ * Expired entries are counted until they are dropped.
+ *
+ * @param table TTL Table
+ * @return Number of entries
+ */
+size_t ttltable_size(ttl_table *table);
+
+/* Your entry by `struct hash_entry` passed to hash and equal functions */
+#define ttltable_hash_item(ptr, type, member)                                  \
+  YU_CONTAINER_OF(ptr, type, member.hh)
+
+#define ttltable_item(ptr, type, member) YU_CONTAINER_OF(ptr, type, member)
+
+#define ttltable_item_safe(ptr, type, member)                                  \
+  YU_CONTAINER_OF_SAFE(ptr, type, member)
+
+#define ttltable_find(table, query, member, now)                               \
+  ttltable_item_safe(ttltable_lookup(table, &(query)->member, now),            \
+                     yu_typeof(*query), member)
+
+#define ttltable_add(table, entry, member, deadline)                           \
+  ttltable_insert(table, &(entry)->member, deadline)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !YU_TTL_TABLE_H
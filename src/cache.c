@@ -0,0 +1,311 @@
+#include "datastructs/cache.h"
+#include "datastructs/memory.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+
+/* Count-min sketch of TinyLFU: `SKETCH_DEPTH` rows of small counters */
+#define SKETCH_DEPTH 4
+#define SKETCH_MAX_COUNT 15
+#define SKETCH_MIN_WIDTH 16
+#define SKETCH_MAX_WIDTH ((size_t)1 << 24)
+/* Counters are halved after `width * SKETCH_SAMPLE_FACTOR` increments,
+ * so old popularity fades away */
+#define SKETCH_SAMPLE_FACTOR 10
+
+struct cache {
+  hash_table *htable;
+
+  enum cache_policy policy;
+  cache_evict_fun evict;
+  void *evict_arg;
+
+  size_t capacity; /* Maximum sum of charges */
+  size_t used;     /* Current sum of charges */
+
+  unsigned char *sketch; /* `SKETCH_DEPTH` rows of `sketch_width` counters */
+  size_t sketch_width;   /* Power of two */
+  size_t sketch_shift;   /* Shift of the product to get column */
+  size_t samples;        /* Increments since the last halving */
+};
+
+static const uint64_t sketch_seeds[SKETCH_DEPTH] = {
+  0x9E3779B97F4A7C15ULL,
+  0xC2B2AE3D27D4EB4FULL,
+  0x165667B19E3779F9ULL,
+  0xD6E8FEB86659FD93ULL,
+};
+
+/* Allocates sketch of `width` columns. Counters of the current sketch are
+ * carried over, so widening keeps frequency history */
+static bool cache_sketch_alloc(cache *cache, size_t width) {
+  unsigned char *sketch = yu_calloc(SKETCH_DEPTH * width, sizeof(*sketch));
+  if (!sketch) {
+    return false;
+  }
+
+  if (cache->sketch) {
+    /* Column is taken from the top bits of the product, so column `j` of
+     * the narrower sketch splits into columns `j * factor` and up */
+    size_t factor = width / cache->sketch_width;
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+      for (size_t column = 0; column < width; ++column) {
+        sketch[row * width + column] =
+          cache->sketch[row * cache->sketch_width + column / factor];
+      }
+    }
+    yu_free(cache->sketch);
+  } else {
+    cache->samples = 0;
+  }
+  cache->sketch = sketch;
+  cache->sketch_width = width;
+
+  cache->sketch_shift = sizeof(size_t) * CHAR_BIT;
+  for (; width > 1; width >>= 1) {
+    cache->sketch_shift--;
+  }
+
+  return true;
+}
+
+static inline unsigned char *cache_sketch_counter(cache *cache, size_t row,
+                                                  size_t hashv) {
+  size_t column = (hashv * (size_t)sketch_seeds[row]) >> cache->sketch_shift;
+  return &cache->sketch[row * cache->sketch_width + column];
+}
+
+static size_t cache_sketch_estimate(cache *cache, size_t hashv) {
+  size_t estimate = SKETCH_MAX_COUNT;
+
+  for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+    unsigned char count = *cache_sketch_counter(cache, row, hashv);
+    if (count < estimate) {
+      estimate = count;
+    }
+  }
+
+  return estimate;
+}
+
+static void cache_sketch_increment(cache *cache, size_t hashv) {
+  /* Sketch is widened when it gets too narrow for the number of entries.
+   * On memory failure the narrow one keeps counting and widening is
+   * retried on the next increment */
+  if (htable_size(cache->htable) > cache->sketch_width &&
+      cache->sketch_width < SKETCH_MAX_WIDTH) {
+    (void)cache_sketch_alloc(cache, cache->sketch_width * 2);
+  }
+
+  for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+    unsigned char *count = cache_sketch_counter(cache, row, hashv);
+    if (*count < SKETCH_MAX_COUNT) {
+      (*count)++;
+    }
+  }
+
+  if (++cache->samples >= cache->sketch_width * SKETCH_SAMPLE_FACTOR) {
+    for (size_t i = 0; i < SKETCH_DEPTH * cache->sketch_width; ++i) {
+      cache->sketch[i] >>= 1;
+    }
+    cache->samples /= 2;
+  }
+}
+
+cache *cache_create(size_t capacity, enum cache_policy policy,
+                    ht_hash_fun hash, ht_equal_fun equal,
+                    cache_evict_fun evict, void *evict_arg) {
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  cache *cache = yu_malloc(sizeof(*cache));
+  if (!cache) {
+    return NULL;
+  }
+
+  cache->htable = htable_create(1, hash, equal);
+  if (!cache->htable) {
+    yu_free(cache);
+    return NULL;
+  }
+
+  cache->sketch = NULL;
+  if (policy == CACHE_TINYLFU && !cache_sketch_alloc(cache, SKETCH_MIN_WIDTH)) {
+    htable_destroy(cache->htable, NULL);
+    yu_free(cache);
+    return NULL;
+  }
+
+  cache->policy = policy;
+  cache->evict = evict;
+  cache->evict_arg = evict_arg;
+  cache->capacity = capacity;
+  cache->used = 0;
+
+  return cache;
+}
+
+static void cache_evict_entry(cache *cache, struct cache_entry *entry) {
+  if (cache->evict) {
+    cache->evict(entry, cache->evict_arg);
+  }
+}
+
+void cache_destroy(cache *cache) {
+  if (!cache) {
+    return;
+  }
+
+  struct cache_entry *cur, *n;
+  htable_for_each_temp(cache->htable, cur, n, hh) {
+    cache_evict_entry(cache, cur);
+  }
+
+  htable_destroy(cache->htable, NULL);
+  if (cache->sketch) {
+    yu_free(cache->sketch);
+  }
+  yu_free(cache);
+}
+
+/* Entry to evict next, never `skip`. There must be another entry */
+static struct cache_entry *cache_victim(cache *cache,
+                                        struct cache_entry *skip) {
+  for (;;) {
+    struct cache_entry *entry =
+      htable_entry(htable_first(cache->htable), struct cache_entry, hh);
+
+    if (entry == skip) {
+      htable_move_last(cache->htable, &entry->hh);
+      continue;
+    }
+
+    if (cache->policy == CACHE_CLOCK && entry->referenced) {
+      /* Second chance: clear the mark and move the hand past the entry */
+      entry->referenced = false;
+      htable_move_last(cache->htable, &entry->hh);
+      continue;
+    }
+
+    return entry;
+  }
+}
+
+static void cache_drop(cache *cache, struct cache_entry *entry) {
+  htable_erase(cache->htable, &entry->hh);
+  cache->used -= entry->charge;
+  cache_evict_entry(cache, entry);
+}
+
+struct cache_entry *cache_get(cache *cache, struct cache_entry *query) {
+  assert(cache != NULL);
+  assert(query != NULL);
+
+  struct hash_entry *found = htable_lookup(cache->htable, &query->hh);
+
+  if (cache->policy == CACHE_TINYLFU) {
+    /* Lookup stores hash value of the query */
+    cache_sketch_increment(cache, query->hh.hashv);
+  }
+
+  if (!found) {
+    return NULL;
+  }
+
+  struct cache_entry *entry = htable_entry(found, struct cache_entry, hh);
+  if (cache->policy == CACHE_CLOCK) {
+    entry->referenced = true;
+  } else {
+    htable_move_last(cache->htable, found);
+  }
+
+  return entry;
+}
+
+bool cache_put(cache *cache, struct cache_entry *entry, size_t charge) {
+  assert(cache != NULL);
+  assert(entry != NULL);
+
+  struct hash_entry *replaced;
+
+  entry->charge = charge;
+  entry->referenced = false;
+
+  if (!htable_replace(cache->htable, &entry->hh, &replaced)) {
+    return false;
+  }
+
+  if (cache->policy == CACHE_TINYLFU) {
+    cache_sketch_increment(cache, entry->hh.hashv);
+  }
+
+  if (replaced) {
+    struct cache_entry *old = htable_entry(replaced, struct cache_entry, hh);
+
+    cache->used -= old->charge;
+    cache_evict_entry(cache, old);
+
+    /* Update counts as an access */
+    if (cache->policy == CACHE_CLOCK) {
+      entry->referenced = true;
+    } else {
+      htable_move_last(cache->htable, &entry->hh);
+    }
+  }
+
+  if (charge > cache->capacity) {
+    htable_erase(cache->htable, &entry->hh);
+    cache_evict_entry(cache, entry);
+    return true;
+  }
+
+  if (!replaced && cache->policy == CACHE_TINYLFU &&
+      cache->used + charge > cache->capacity) {
+    struct cache_entry *victim = cache_victim(cache, entry);
+
+    if (cache_sketch_estimate(cache, entry->hh.hashv) <=
+        cache_sketch_estimate(cache, victim->hh.hashv)) {
+      htable_erase(cache->htable, &entry->hh);
+      cache_evict_entry(cache, entry);
+      return true;
+    }
+  }
+
+  while (cache->used + charge > cache->capacity) {
+    cache_drop(cache, cache_victim(cache, entry));
+  }
+  cache->used += charge;
+
+  /* Eviction could move entries past the new one, it must be the last */
+  if (!replaced) {
+    htable_move_last(cache->htable, &entry->hh);
+  }
+
+  return true;
+}
+
+struct cache_entry *cache_remove(cache *cache, struct cache_entry *query) {
+  assert(cache != NULL);
+  assert(query != NULL);
+
+  struct hash_entry *removed = htable_remove(cache->htable, &query->hh);
+  if (!removed) {
+    return NULL;
+  }
+
+  struct cache_entry *entry = htable_entry(removed, struct cache_entry, hh);
+  cache->used -= entry->charge;
+
+  return entry;
+}
+
+size_t cache_size(cache *cache) {
+  assert(cache != NULL);
+  return htable_size(cache->htable);
+}
+
+size_t cache_used(cache *cache) {
+  assert(cache != NULL);
+  return cache->used;
+}
@@ -0,0 +1,483 @@
+#include "datastructs/concurrent_hash_table.h"
+#include "datastructs/memory.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Should be arranged from 0.5 to 0.8 */
+#define IDEAL_LOAD_FACTOR 0.7
+
+#define CACHE_LINE_SIZE 64
+
+#define chtable_head(htable) (htable->dummy_head.ht_next)
+#define chtable_tail(htable) (htable->dummy_head.ht_prev)
+
+struct chtable_stripe {
+  pthread_mutex_t lock;
+  size_t num_items; /* Number of items in buckets of this stripe */
+
+  /* Keep stripes on separate cache lines */
+  char padding[CACHE_LINE_SIZE -
+               (sizeof(pthread_mutex_t) + sizeof(size_t)) % CACHE_LINE_SIZE];
+};
+
+struct concurrent_hash_table {
+  /* Bucket `i` is protected by stripe `i % num_stripes`. Number of
+   * buckets is always a multiple of number of stripes, so stripe
+   * of an entry could be found from its hash without any lock */
+  struct hash_bucket *buckets;
+  struct chtable_stripe *stripes; /* Aligned to `CACHE_LINE_SIZE` */
+  void *stripes_block;            /* Allocation `stripes` points into */
+
+  /* Dummy head of `global` linked list, protected by `list_lock` */
+  struct hash_entry dummy_head;
+  pthread_mutex_t list_lock;
+  bool ordered;
+
+  ht_hash_fun hash;
+  ht_equal_fun equal;
+
+  /* Number of items in a single stripe should not be
+   * greater than this value */
+  size_t stripe_ideal_num_items;
+
+  size_t num_buckets; /* Number of buckets in the table */
+  size_t num_stripes; /* Number of stripes in the table */
+};
+
+static inline struct chtable_stripe *chtable_stripe(concurrent_hash_table *ht,
+                                                    size_t hashv) {
+  return &ht->stripes[hashv % ht->num_stripes];
+}
+
+/* Must be called with stripe of `hashv` locked */
+static inline struct hash_bucket *chtable_bucket(concurrent_hash_table *ht,
+                                                 size_t hashv) {
+  return &ht->buckets[hashv % ht->num_buckets];
+}
+
+static inline size_t chtable_round_buckets(concurrent_hash_table *ht,
+                                           size_t num_buckets) {
+  size_t num_stripes = ht->num_stripes;
+  return (num_buckets + num_stripes - 1) / num_stripes * num_stripes;
+}
+
+static void chtable_lock_all(concurrent_hash_table *htable) {
+  for (size_t i = 0; i < htable->num_stripes; ++i) {
+    pthread_mutex_lock(&htable->stripes[i].lock);
+  }
+}
+
+static void chtable_unlock_all(concurrent_hash_table *htable) {
+  for (size_t i = htable->num_stripes; i > 0; --i) {
+    pthread_mutex_unlock(&htable->stripes[i - 1].lock);
+  }
+}
+
+static struct hash_entry **chtable_lookup_in_bucket(concurrent_hash_table *ht,
+                                                    struct hash_bucket *bucket,
+                                                    struct hash_entry *query) {
+  struct hash_entry **link = &bucket->entry;
+
+  while (*link) {
+    struct hash_entry *entry = *link;
+    if (entry->hashv == query->hashv && ht->equal(entry, query)) {
+      break;
+    }
+
+    link = &entry->next;
+  }
+
+  return link;
+}
+
+static void chtable_list_append(concurrent_hash_table *htable,
+                                struct hash_entry *entry) {
+  if (!htable->ordered) {
+    return;
+  }
+
+  pthread_mutex_lock(&htable->list_lock);
+
+  struct hash_entry *tail = chtable_tail(htable);
+  entry->ht_prev = tail;
+  entry->ht_next = tail->ht_next;
+  tail->ht_next->ht_prev = entry;
+  tail->ht_next = entry;
+
+  pthread_mutex_unlock(&htable->list_lock);
+}
+
+static void chtable_list_unlink(concurrent_hash_table *htable,
+                                struct hash_entry *entry) {
+  if (!htable->ordered) {
+    return;
+  }
+
+  pthread_mutex_lock(&htable->list_lock);
+
+  entry->ht_prev->ht_next = entry->ht_next;
+  entry->ht_next->ht_prev = entry->ht_prev;
+
+  pthread_mutex_unlock(&htable->list_lock);
+}
+
+static void chtable_list_replace(concurrent_hash_table *htable,
+                                 struct hash_entry *victim,
+                                 struct hash_entry *new) {
+  if (!htable->ordered) {
+    return;
+  }
+
+  pthread_mutex_lock(&htable->list_lock);
+
+  new->ht_prev = victim->ht_prev;
+  new->ht_next = victim->ht_next;
+  new->ht_prev->ht_next = new;
+  new->ht_next->ht_prev = new;
+
+  pthread_mutex_unlock(&htable->list_lock);
+}
+
+/* Must be called with every stripe locked */
+static bool chtable_resize(concurrent_hash_table *htable,
+                           size_t new_num_buckets) {
+  new_num_buckets = chtable_round_buckets(htable, new_num_buckets);
+
+  struct hash_bucket *nbuckets = yu_calloc(new_num_buckets, sizeof(*nbuckets));
+  if (!nbuckets) {
+    return false;
+  }
+
+  for (size_t i = 0; i < htable->num_buckets; ++i) {
+    struct hash_entry *entry = htable->buckets[i].entry;
+
+    while (entry) {
+      struct hash_entry *next = entry->next;
+      struct hash_bucket *bucket = &nbuckets[entry->hashv % new_num_buckets];
+
+      entry->next = bucket->entry;
+      bucket->entry = entry;
+
+      entry = next;
+    }
+  }
+
+  yu_free(htable->buckets);
+
+  htable->buckets = nbuckets;
+  htable->num_buckets = new_num_buckets;
+  htable->stripe_ideal_num_items =
+    new_num_buckets * IDEAL_LOAD_FACTOR / htable->num_stripes + 1;
+
+  return true;
+}
+
+/* Grow the table unless another thread has already done it */
+static void chtable_expand_buckets(concurrent_hash_table *htable,
+                                   size_t seen_num_buckets) {
+  chtable_lock_all(htable);
+
+  if (htable->num_buckets == seen_num_buckets) {
+    /* On memory failure table just stays more loaded */
+    chtable_resize(htable, seen_num_buckets * 2);
+  }
+
+  chtable_unlock_all(htable);
+}
+
+concurrent_hash_table *chtable_create(size_t num_buckets, size_t num_stripes,
+                                      ht_hash_fun hash, ht_equal_fun equal,
+                                      bool ordered) {
+  assert(num_buckets > 0);
+  assert(num_stripes > 0);
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  concurrent_hash_table *htable = yu_malloc(sizeof(*htable));
+  if (!htable) {
+    return NULL;
+  }
+
+  htable->num_stripes = num_stripes;
+  htable->num_buckets = chtable_round_buckets(htable, num_buckets);
+
+  /* Allocator gives no cache line alignment, so one extra line is
+   * allocated and stripes start at the first aligned address in it */
+  if (num_stripes > (SIZE_MAX - CACHE_LINE_SIZE) / sizeof(*htable->stripes)) {
+    yu_free(htable);
+    return NULL;
+  }
+  htable->stripes_block =
+    yu_malloc(num_stripes * sizeof(*htable->stripes) + CACHE_LINE_SIZE - 1);
+  if (!htable->stripes_block) {
+    yu_free(htable);
+    return NULL;
+  }
+  htable->stripes =
+    (struct chtable_stripe *)(((uintptr_t)htable->stripes_block +
+                               CACHE_LINE_SIZE - 1) &
+                              ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+  memset(htable->stripes, 0, num_stripes * sizeof(*htable->stripes));
+
+  htable->buckets = yu_calloc(htable->num_buckets, sizeof(*htable->buckets));
+  if (!htable->buckets) {
+    yu_free(htable->stripes_block);
+    yu_free(htable);
+    return NULL;
+  }
+
+  size_t num_locks = 0;
+  while (num_locks < num_stripes &&
+         pthread_mutex_init(&htable->stripes[num_locks].lock, NULL) == 0) {
+    ++num_locks;
+  }
+  if (num_locks < num_stripes ||
+      pthread_mutex_init(&htable->list_lock, NULL) != 0) {
+    while (num_locks > 0) {
+      pthread_mutex_destroy(&htable->stripes[--num_locks].lock);
+    }
+    yu_free(htable->buckets);
+    yu_free(htable->stripes_block);
+    yu_free(htable);
+    return NULL;
+  }
+
+  htable->hash = hash;
+  htable->equal = equal;
+  htable->ordered = ordered;
+  htable->dummy_head.ht_next = htable->dummy_head.ht_prev = &htable->dummy_head;
+
+  htable->stripe_ideal_num_items =
+    htable->num_buckets * IDEAL_LOAD_FACTOR / num_stripes + 1;
+
+  return htable;
+}
+
+void chtable_destroy(concurrent_hash_table *htable, ch_destroy_fun destroy) {
+  if (!htable) {
+    return;
+  }
+
+  if (destroy) {
+    destroy(htable);
+  }
+
+  for (size_t i = 0; i < htable->num_stripes; ++i) {
+    pthread_mutex_destroy(&htable->stripes[i].lock);
+  }
+  pthread_mutex_destroy(&htable->list_lock);
+
+  yu_free(htable->buckets);
+  yu_free(htable->stripes_block);
+  yu_free(htable);
+}
+
+bool chtable_rehash(concurrent_hash_table *htable, size_t new_num_buckets) {
+  assert(htable != NULL);
+  assert(new_num_buckets > 0);
+
+  chtable_lock_all(htable);
+  bool ok = chtable_resize(htable, new_num_buckets);
+  chtable_unlock_all(htable);
+
+  return ok;
+}
+
+bool chtable_insert(concurrent_hash_table *htable, struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  entry->hashv = htable->hash(entry);
+
+  struct chtable_stripe *stripe = chtable_stripe(htable, entry->hashv);
+  pthread_mutex_lock(&stripe->lock);
+
+  struct hash_bucket *bucket = chtable_bucket(htable, entry->hashv);
+  entry->next = bucket->entry;
+  bucket->entry = entry;
+
+  chtable_list_append(htable, entry);
+
+  size_t num_items = ++stripe->num_items;
+  size_t num_buckets = htable->num_buckets;
+  bool expand = num_items > htable->stripe_ideal_num_items;
+
+  pthread_mutex_unlock(&stripe->lock);
+
+  if (expand) {
+    chtable_expand_buckets(htable, num_buckets);
+  }
+
+  return true;
+}
+
+bool chtable_replace(concurrent_hash_table *htable, struct hash_entry *entry,
+                     struct hash_entry **replaced) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+  assert(replaced != NULL);
+
+  *replaced = NULL;
+
+  entry->hashv = htable->hash(entry);
+
+  struct chtable_stripe *stripe = chtable_stripe(htable, entry->hashv);
+  pthread_mutex_lock(&stripe->lock);
+
+  struct hash_bucket *bucket = chtable_bucket(htable, entry->hashv);
+  struct hash_entry **link = chtable_lookup_in_bucket(htable, bucket, entry);
+
+  if (*link) {
+    struct hash_entry *victim = *link;
+
+    entry->next = victim->next;
+    *link = entry;
+    chtable_list_replace(htable, victim, entry);
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    *replaced = victim;
+    return true;
+  }
+
+  entry->next = bucket->entry;
+  bucket->entry = entry;
+
+  chtable_list_append(htable, entry);
+
+  size_t num_items = ++stripe->num_items;
+  size_t num_buckets = htable->num_buckets;
+  bool expand = num_items > htable->stripe_ideal_num_items;
+
+  pthread_mutex_unlock(&stripe->lock);
+
+  if (expand) {
+    chtable_expand_buckets(htable, num_buckets);
+  }
+
+  return true;
+}
+
+struct hash_entry *chtable_lookup(concurrent_hash_table *htable,
+                                  struct hash_entry *query) {
+  assert(htable != NULL);
+  assert(query != NULL);
+
+  query->hashv = htable->hash(query);
+
+  struct chtable_stripe *stripe = chtable_stripe(htable, query->hashv);
+  pthread_mutex_lock(&stripe->lock);
+
+  struct hash_bucket *bucket = chtable_bucket(htable, query->hashv);
+  struct hash_entry *entry = *chtable_lookup_in_bucket(htable, bucket, query);
+
+  pthread_mutex_unlock(&stripe->lock);
+
+  return entry;
+}
+
+struct hash_entry *chtable_remove(concurrent_hash_table *htable,
+                                  struct hash_entry *query) {
+  assert(htable != NULL);
+  assert(query != NULL);
+
+  query->hashv = htable->hash(query);
+
+  struct chtable_stripe *stripe = chtable_stripe(htable, query->hashv);
+  pthread_mutex_lock(&stripe->lock);
+
+  struct hash_bucket *bucket = chtable_bucket(htable, query->hashv);
+  struct hash_entry **link = chtable_lookup_in_bucket(htable, bucket, query);
+  struct hash_entry *entry = *link;
+
+  if (entry) {
+    *link = entry->next;
+    chtable_list_unlink(htable, entry);
+    stripe->num_items--;
+  }
+
+  pthread_mutex_unlock(&stripe->lock);
+
+  return entry;
+}
+
+void chtable_erase(concurrent_hash_table *htable, struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  struct chtable_stripe *stripe = chtable_stripe(htable, entry->hashv);
+  pthread_mutex_lock(&stripe->lock);
+
+  struct hash_bucket *bucket = chtable_bucket(htable, entry->hashv);
+  struct hash_entry **link = &bucket->entry;
+
+  while (*link != entry) {
+    link = &(*link)->next;
+  }
+
+  *link = entry->next;
+  chtable_list_unlink(htable, entry);
+  stripe->num_items--;
+
+  pthread_mutex_unlock(&stripe->lock);
+}
+
+void chtable_for_each(concurrent_hash_table *htable, ch_visit_fun visit,
+                      void *arg) {
+  assert(htable != NULL);
+  assert(visit != NULL);
+
+  /* Writers take their stripe before the list lock,
+   * so holding every stripe blocks all of them */
+  chtable_lock_all(htable);
+
+  if (htable->ordered) {
+    struct hash_entry *entry = chtable_head(htable);
+
+    while (entry != &htable->dummy_head) {
+      struct hash_entry *next = entry->ht_next;
+      visit(entry, arg);
+      entry = next;
+    }
+  } else {
+    for (size_t i = 0; i < htable->num_buckets; ++i) {
+      struct hash_entry *entry = htable->buckets[i].entry;
+
+      while (entry) {
+        struct hash_entry *next = entry->next;
+        visit(entry, arg);
+        entry = next;
+      }
+    }
+  }
+
+  chtable_unlock_all(htable);
+}
+
+size_t chtable_size(concurrent_hash_table *htable) {
+  assert(htable != NULL);
+
+  size_t num_items = 0;
+  for (size_t i = 0; i < htable->num_stripes; ++i) {
+    struct chtable_stripe *stripe = &htable->stripes[i];
+
+    pthread_mutex_lock(&stripe->lock);
+    num_items += stripe->num_items;
+    pthread_mutex_unlock(&stripe->lock);
+  }
+
+  return num_items;
+}
+
+size_t chtable_num_buckets(concurrent_hash_table *htable) {
+  assert(htable != NULL);
+
+  pthread_mutex_lock(&htable->stripes[0].lock);
+  size_t num_buckets = htable->num_buckets;
+  pthread_mutex_unlock(&htable->stripes[0].lock);
+
+  return num_buckets;
+}
@@ -1,12 +1,37 @@
 #include "datastructs/functions.h"
+#include "datastructs/macros.h"
 #include "datastructs/memory.h"
 
+#include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/uio.h>
+
+  #define YU_HASH_IOV
+#endif
+
 #define FNV_PRIME 0x100000001b3
 #define FNV_OFFSET 0xcbf29ce484222325UL
 
+#if defined(__GNUC__) || defined(__clang__)
+  /* Aligned word reads of `yu_strlen_words` may pass the end of the string,
+   * but never cross a page boundary */
+  #define YU_WORD_STRLEN
+  #define YU_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+typedef uint64_t __attribute__((may_alias)) yu_aliased_word;
+#endif
+
+/* Secret and mixing steps follow wyhash final version 4 */
+static const uint64_t wy_secret[4] = {
+  0x2d358dccaa6c78a5ULL,
+  0x8bb84b93962eacc9ULL,
+  0x4b33a62ed433d4a3ULL,
+  0x4d5a2da51de1aa47ULL,
+};
+
 size_t yu_hash_bern(const void *key, size_t size) {
   const unsigned char *bytes = key;
   size_t hash = 5381;
@@ -16,9 +41,9 @@ size_t yu_hash_bern(const void *key, size_t size) {
   return hash;
 }
 
-size_t yu_hash_fnv1a(const void *key, size_t size) {
-  const unsigned char *bytes = key;
-  size_t hashv = FNV_OFFSET;
+static inline size_t fnv1a_update(size_t hashv, const void *data,
+                                  size_t size) {
+  const unsigned char *bytes = data;
   for (size_t i = 0; i < size; ++i) {
     hashv ^= bytes[i];
     hashv *= FNV_PRIME;
@@ -26,11 +51,164 @@ size_t yu_hash_fnv1a(const void *key, size_t size) {
   return hashv;
 }
 
-#define FNHASHDEF(type, postfix)                                               \
-  size_t yu_hash_##postfix(type key) {                                         \
-    return yu_hash_fnv1a(&key, sizeof(key));                                   \
+size_t yu_hash_fnv1a(const void *key, size_t size) {
+  return fnv1a_update(FNV_OFFSET, key, size);
+}
+
+void yu_hash_fnv1a_init(struct yu_fnv1a_state *state) {
+  assert(state);
+  state->hashv = FNV_OFFSET;
+}
+
+void yu_hash_fnv1a_update(struct yu_fnv1a_state *state, const void *data,
+                          size_t size) {
+  assert(state);
+  state->hashv = fnv1a_update(state->hashv, data, size);
+}
+
+size_t yu_hash_fnv1a_final(const struct yu_fnv1a_state *state) {
+  assert(state);
+  return state->hashv;
+}
+
+#ifdef YU_HASH_IOV
+size_t yu_hash_fnv1a_iov(const struct iovec *iov, size_t iovcnt) {
+  size_t hashv = FNV_OFFSET;
+  for (size_t i = 0; i < iovcnt; ++i) {
+    hashv = fnv1a_update(hashv, iov[i].iov_base, iov[i].iov_len);
+  }
+  return hashv;
+}
+#endif
+
+/* 64x64 -> 128 bit product, low half in `a` and high half in `b` */
+static inline void wy_mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, la = (uint32_t)*a;
+  uint64_t hb = *b >> 32, lb = (uint32_t)*b;
+  uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+  uint64_t mid = (ll >> 32) + (uint32_t)hl + (uint32_t)lh;
+
+  *a = (mid << 32) | (uint32_t)ll;
+  *b = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b) {
+  wy_mum(&a, &b);
+  return a ^ b;
+}
+
+/* Unaligned little-endian reads */
+static inline uint64_t wy_read8(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t wy_read4(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/* First, middle and last byte of 1 to 3 byte key */
+static inline uint64_t wy_read3(const unsigned char *p, size_t size) {
+  return ((uint64_t)p[0] << 16) | ((uint64_t)p[size >> 1] << 8) | p[size - 1];
+}
+
+uint64_t yu_hash_wy_seed(const void *key, size_t size, uint64_t seed) {
+  const unsigned char *p = key;
+  uint64_t a, b;
+
+  seed ^= wy_mix(seed ^ wy_secret[0], wy_secret[1]);
+
+  if (size <= 16) {
+    if (size >= 4) {
+      /* Two pairs of 4 byte reads overlap to cover any size from 4 to 16 */
+      size_t mid = (size >> 3) << 2;
+      a = (wy_read4(p) << 32) | wy_read4(p + mid);
+      b = (wy_read4(p + size - 4) << 32) | wy_read4(p + size - 4 - mid);
+    } else if (size > 0) {
+      a = wy_read3(p, size);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = size;
+
+    if (i > 48) {
+      /* Three independent lanes hide latency of the multiplies */
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = wy_mix(wy_read8(p) ^ wy_secret[1], wy_read8(p + 8) ^ seed);
+        see1 = wy_mix(wy_read8(p + 16) ^ wy_secret[2], wy_read8(p + 24) ^ see1);
+        see2 = wy_mix(wy_read8(p + 32) ^ wy_secret[3], wy_read8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+
+    while (i > 16) {
+      seed = wy_mix(wy_read8(p) ^ wy_secret[1], wy_read8(p + 8) ^ seed);
+      p += 16;
+      i -= 16;
+    }
+
+    /* Last 16 bytes, overlapping the already mixed ones if needed */
+    a = wy_read8(p + i - 16);
+    b = wy_read8(p + i - 8);
+  }
+
+  a ^= wy_secret[1];
+  b ^= seed;
+  wy_mum(&a, &b);
+
+  return wy_mix(a ^ wy_secret[0] ^ size, b ^ wy_secret[1]);
+}
+
+size_t yu_hash_wy(const void *key, size_t size) {
+  return yu_hash_wy_seed(key, size, 0);
+}
+
+#ifdef YU_WORD_STRLEN
+/* Reads aligned 8 byte words and checks all their bytes for zero at once:
+ * `(v - 0x01..01) & ~v & 0x80..80` is non-zero iff some byte of `v` is zero */
+YU_NO_SANITIZE_ADDRESS static size_t yu_strlen_words(const char *str) {
+  const char *p = str;
+
+  for (; (uintptr_t)p % sizeof(uint64_t) != 0; ++p) {
+    if (*p == '\0') {
+      return p - str;
+    }
   }
 
+  const yu_aliased_word *w = (const yu_aliased_word *)p;
+  for (;; ++w) {
+    uint64_t v = *w;
+    if ((v - 0x0101010101010101ULL) & ~v & 0x8080808080808080ULL) {
+      break;
+    }
+  }
+
+  for (p = (const char *)w; *p; ++p) {
+  }
+  return p - str;
+}
+#else
+static size_t yu_strlen_words(const char *str) { return strlen(str); }
+#endif
+
+size_t yu_hash_wy_str(const char *str) {
+  return yu_hash_wy_seed(str, yu_strlen_words(str), 0);
+}
+
 #define FNCMPDEF(type, postfix)                                                \
   int yu_cmp_##postfix(const void *a, const void *b) {                         \
     if (*(type *)a > *(type *)b) {                                             \
@@ -42,21 +220,17 @@ size_t yu_hash_fnv1a(const void *key, size_t size) {
     return 0;                                                                  \
   }
 
-#define TYPED_FUNCTIONS(Type, postfix)                                         \
-  FNHASHDEF(Type, postfix)                                                     \
-  FNCMPDEF(Type, postfix)
-
-TYPED_FUNCTIONS(int64_t, i64)
-TYPED_FUNCTIONS(int32_t, i32)
-TYPED_FUNCTIONS(int16_t, i16)
-TYPED_FUNCTIONS(int8_t, i8)
-TYPED_FUNCTIONS(uint64_t, u64)
-TYPED_FUNCTIONS(uint32_t, u32)
-TYPED_FUNCTIONS(uint16_t, u16)
-TYPED_FUNCTIONS(uint8_t, u8)
-TYPED_FUNCTIONS(double, double)
-TYPED_FUNCTIONS(float, float)
-TYPED_FUNCTIONS(void *, ptr)
+FNCMPDEF(int64_t, i64)
+FNCMPDEF(int32_t, i32)
+FNCMPDEF(int16_t, i16)
+FNCMPDEF(int8_t, i8)
+FNCMPDEF(uint64_t, u64)
+FNCMPDEF(uint32_t, u32)
+FNCMPDEF(uint16_t, u16)
+FNCMPDEF(uint8_t, u8)
+FNCMPDEF(double, double)
+FNCMPDEF(float, float)
+FNCMPDEF(void *, ptr)
 
 uint64_t yu_hash_str(const char *str) {
   const unsigned char *bytes = (const unsigned char *)str;
@@ -76,3 +250,236 @@ char *yu_dup_str(const char *s) {
   }
   return str;
 }
+
+/* Batch hashing of `uint64_t` keys runs the splitmix64 finalizer in vector
+ * registers. Below AVX-512 vectors have no 64 bit multiply and it is built
+ * of three 32x32 -> 64 bit ones, which pays off from four lanes of AVX2 */
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+  #define YU_HASH_SIMD
+  #include <immintrin.h>
+
+  #define YU_TARGET_SSE42 __attribute__((target("sse4.2")))
+  #define YU_TARGET_AVX2 __attribute__((target("avx2")))
+  #define YU_TARGET_AVX512 __attribute__((target("avx512f,avx512dq")))
+#endif
+
+/* Strings of a batch are prefetched that far ahead of the hashed one */
+#define STR_PREFETCH_DISTANCE 8
+
+static enum yu_simd simd_limit = YU_SIMD_AVX512;
+
+static void mix64_scalar(const uint64_t *keys, size_t *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = (size_t)yu_hash_mix64(keys[i]);
+  }
+}
+
+#ifdef YU_HASH_SIMD
+YU_TARGET_AVX2 static inline __m256i avx2_mul64(__m256i x, __m256i c) {
+  __m256i cross =
+    _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), c),
+                     _mm256_mul_epu32(x, _mm256_srli_epi64(c, 32)));
+  return _mm256_add_epi64(_mm256_mul_epu32(x, c),
+                          _mm256_slli_epi64(cross, 32));
+}
+
+YU_TARGET_AVX2 static void mix64_avx2(const uint64_t *keys, size_t *out,
+                                      size_t n) {
+  __m256i c1 = _mm256_set1_epi64x(0xbf58476d1ce4e5b9ULL);
+  __m256i c2 = _mm256_set1_epi64x(0x94d049bb133111ebULL);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(keys + i));
+    x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 30));
+    x = avx2_mul64(x, c1);
+    x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 27));
+    x = avx2_mul64(x, c2);
+    x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 31));
+    _mm256_storeu_si256((__m256i *)(out + i), x);
+  }
+  mix64_scalar(keys + i, out + i, n - i);
+}
+
+YU_TARGET_AVX512 static void mix64_avx512(const uint64_t *keys, size_t *out,
+                                          size_t n) {
+  __m512i c1 = _mm512_set1_epi64(0xbf58476d1ce4e5b9ULL);
+  __m512i c2 = _mm512_set1_epi64(0x94d049bb133111ebULL);
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m512i x = _mm512_loadu_si512(keys + i);
+    x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 30));
+    x = _mm512_mullo_epi64(x, c1);
+    x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 27));
+    x = _mm512_mullo_epi64(x, c2);
+    x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 31));
+    _mm512_storeu_si512(out + i, x);
+  }
+  mix64_scalar(keys + i, out + i, n - i);
+}
+#endif  // YU_HASH_SIMD
+
+static enum yu_simd simd_supported(void) {
+#ifdef YU_HASH_SIMD
+  /* Also checks that the OS saves the vector registers */
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+    return YU_SIMD_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return YU_SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return YU_SIMD_SSE42;
+  }
+#endif
+  return YU_SIMD_NONE;
+}
+
+static enum yu_simd simd_level(void) {
+  enum yu_simd supported = simd_supported();
+  return supported < simd_limit ? supported : simd_limit;
+}
+
+enum yu_simd yu_hash_simd(enum yu_simd max_level) {
+  simd_limit = max_level;
+  return simd_level();
+}
+
+void yu_hash_u64_batch(const uint64_t *keys, size_t *out, size_t n) {
+  switch (simd_level()) {
+#ifdef YU_HASH_SIMD
+  case YU_SIMD_AVX512:
+    mix64_avx512(keys, out, n);
+    break;
+  case YU_SIMD_AVX2:
+    mix64_avx2(keys, out, n);
+    break;
+#endif
+  default:
+    mix64_scalar(keys, out, n);
+  }
+}
+
+void yu_hash_wy_batch(const void *keys, size_t key_size, size_t *out,
+                      size_t n) {
+  const unsigned char *p = keys;
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = (size_t)yu_hash_wy_seed(p + i * key_size, key_size, 0);
+  }
+}
+
+void yu_hash_wy_str_batch(const char *const *strs, size_t *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    if (i + STR_PREFETCH_DISTANCE < n) {
+      YU_PREFETCH(strs[i + STR_PREFETCH_DISTANCE]);
+    }
+    out[i] = (size_t)yu_hash_wy_seed(strs[i], yu_strlen_words(strs[i]), 0);
+  }
+}
+
+/* CRC32C (Castagnoli, reflected polynomial 0x82f63b78) of one byte */
+static const uint32_t crc32c_table[256] = {
+  0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c,
+  0x26a1e7e8, 0xd4ca64eb, 0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b,
+  0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24, 0x105ec76f, 0xe235446c,
+  0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+  0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc,
+  0xbc267848, 0x4e4dfb4b, 0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a,
+  0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35, 0xaa64d611, 0x580f5512,
+  0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+  0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad,
+  0x1642ae59, 0xe4292d5a, 0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a,
+  0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595, 0x417b1dbc, 0xb3109ebf,
+  0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+  0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f,
+  0xed03a29b, 0x1f682198, 0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927,
+  0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38, 0xdbfc821c, 0x2997011f,
+  0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+  0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e,
+  0x4767748a, 0xb50cf789, 0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859,
+  0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46, 0x7198540d, 0x83f3d70e,
+  0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+  0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de,
+  0xdde0eb2a, 0x2f8b6829, 0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c,
+  0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93, 0x082f63b7, 0xfa44e0b4,
+  0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+  0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b,
+  0xb4091bff, 0x466298fc, 0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c,
+  0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033, 0xa24bb5a6, 0x502036a5,
+  0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+  0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975,
+  0x0e330a81, 0xfc588982, 0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d,
+  0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622, 0x38cc2a06, 0xcaa7a905,
+  0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+  0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8,
+  0xe52cc12c, 0x1747422f, 0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff,
+  0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0, 0xd3d3e1ab, 0x21b862a8,
+  0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+  0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78,
+  0x7fab5e8c, 0x8dc0dd8f, 0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee,
+  0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1, 0x69e9f0d5, 0x9b8273d6,
+  0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+  0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69,
+  0xd5cf889d, 0x27a40b9e, 0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e,
+  0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
+};
+
+/* Same as the SSE4.2 `crc32` instruction on 8 bytes: no inversion, bytes
+ * from the lowest one */
+static inline uint32_t crc32c_step_sw(uint32_t crc, uint64_t word) {
+  for (int i = 0; i < 8; ++i) {
+    crc = crc32c_table[(crc ^ word) & 0xff] ^ (crc >> 8);
+    word >>= 8;
+  }
+  return crc;
+}
+
+/* Two lanes take even and odd 8 byte words, so that two `crc32` run at
+ * once instead of waiting for each other. Tail is read like the short
+ * keys of `yu_hash_wy`. Lanes are joined into 64 bits and mixed, as CRC
+ * alone leaves the low bits linear in the key. It is a macro so that the
+ * `crc32` instruction is inlined into its loop */
+#define CRC32C_DEF(name, step)                                                 \
+  static size_t name(const void *key, size_t size) {                           \
+    const unsigned char *p = key;                                              \
+    uint32_t lo = 0xffffffff, hi = 0xffffffff;                                 \
+    size_t i = size;                                                           \
+                                                                               \
+    for (; i > 16; i -= 16, p += 16) {                                         \
+      lo = step(lo, wy_read8(p));                                              \
+      hi = step(hi, wy_read8(p + 8));                                          \
+    }                                                                          \
+                                                                               \
+    if (i >= 8) {                                                              \
+      lo = step(lo, wy_read8(p));                                              \
+      hi = step(hi, wy_read8(p + i - 8));                                      \
+    } else if (i >= 4) {                                                       \
+      lo = step(lo, wy_read4(p));                                              \
+      hi = step(hi, wy_read4(p + i - 4));                                      \
+    } else if (i > 0) {                                                        \
+      lo = step(lo, wy_read3(p, i));                                           \
+    }                                                                          \
+                                                                               \
+    return (size_t)yu_hash_mix64((((uint64_t)hi << 32) | lo) ^ size);          \
+  }
+
+CRC32C_DEF(crc32c_sw, crc32c_step_sw)
+
+#ifdef YU_HASH_SIMD
+YU_TARGET_SSE42 static inline uint32_t crc32c_step_hw(uint32_t crc,
+                                                      uint64_t word) {
+  return (uint32_t)_mm_crc32_u64(crc, word);
+}
+
+YU_TARGET_SSE42 CRC32C_DEF(crc32c_hw, crc32c_step_hw)
+#endif
+
+size_t yu_hash_crc32c(const void *key, size_t size) {
+#ifdef YU_HASH_SIMD
+  if (simd_limit >= YU_SIMD_SSE42 && __builtin_cpu_supports("sse4.2")) {
+    return crc32c_hw(key, size);
+  }
+#endif
+  return crc32c_sw(key, size);
+}
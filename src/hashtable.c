@@ -2,37 +2,332 @@
 #include "datastructs/memory.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* Should be arranged from 0.5 to 0.8 */
-#define IDEAL_LOAD_FACTOR 0.7
+#ifdef YU_HTABLE_THREADS
+  #include <pthread.h>
+#endif
 
-#define htable_head(htable) (htable->dummy_head.ht_next)
-#define htable_tail(htable) (htable->dummy_head.ht_prev)
+/* Should be arranged from 0.5 to 0.8 */
+#define DEFAULT_LOAD_FACTOR 0.7
+/* Table is halved when load factor drops below this value. Load factor
+ * after halving is half of the ideal one, so the table does not resize
+ * back and forth when entries are inserted and removed around the limit */
+#define DEFAULT_SHRINK_LOAD_FACTOR (DEFAULT_LOAD_FACTOR / 4)
+#define DEFAULT_GROWTH_FACTOR 2.0
+
+/* Auto-tuning samples this number of buckets before every growth */
+#define TUNE_SAMPLE_BUCKETS 256
+/* Sample with fewer non-empty buckets is not trusted */
+#define TUNE_MIN_CHAINS 16
+/* Load factor is multiplied or divided by this step when average chain
+ * length is off the target by more than the tolerance */
+#define TUNE_STEP 1.25
+#define TUNE_TOLERANCE 1.1
+#define TUNE_MIN_LOAD_FACTOR 0.25
+#define TUNE_MAX_LOAD_FACTOR 4.0
+
+/* Number of non-empty buckets migrated by a single operation
+ * during incremental rehash */
+#define REHASH_STEP 4
+/* Number of empty buckets that could be visited by a single operation */
+#define REHASH_EMPTY_VISITS (REHASH_STEP * 10)
+
+/* Number of entries batched operations prefetch together */
+#define BATCH_SIZE 16
+
+/* Runs shorter than this are sorted by insertion sort */
+#define SORT_INSERTION_SIZE 16
+
+/* Number of buckets parallel visits prefetch ahead */
+#define VISIT_PREFETCH_DISTANCE 32
+
+/* Each thread of parallel operations gets at least this number of entries */
+#define THREAD_MIN_ITEMS 4096
+#define MAX_THREADS 64
+
+#ifndef YU_HTABLE_COMPACT
+  #define htable_head(htable) (htable->dummy_head.ht_next)
+  #define htable_tail(htable) (htable->dummy_head.ht_prev)
 
 /* Pointer to an invalid memory address used for determining dummy head */
 static unsigned char dummy_ptr__;
-#define DUMMY_PTR ((void *)&dummy_ptr__)
+  #define DUMMY_PTR ((void *)&dummy_ptr__)
+#endif
 
 struct hash_table {
-  struct hash_bucket *buckets;  /* Buckets to store pointers to hash entrys */
+  struct hash_bucket *buckets; /* Buckets to store pointers to hash entrys */
+#ifndef YU_HTABLE_COMPACT
   struct hash_entry dummy_head; /* Dummy head of `global` linked list */
+#endif
+
+  /* Buckets that are being migrated during incremental rehash,
+   * `NULL` if rehash is not in progress */
+  struct hash_bucket *old_buckets;
 
   ht_hash_fun hash;
   ht_equal_fun equal;
 
+  struct htable_policy policy; /* Load factor is changed by auto-tuning */
+
   /* Number of items in the hash table should not be
    * greater than this value */
   size_t ideal_num_items;
+  /* Table shrinks when number of items drops below this value */
+  size_t shrink_num_items;
+  /* Table never shrinks automatically below this number of buckets */
+  size_t min_num_buckets;
 
   size_t num_items;   /* Number of items in the table */
   size_t num_buckets; /* Number of buckets in the table */
+
+  size_t old_num_buckets; /* Number of buckets in `old_buckets` */
+  size_t rehash_idx;      /* Next bucket in `old_buckets` to migrate */
+
+  bool incremental; /* Spread rehash across multiple operations */
+  bool scanning;    /* `htable_scan` callback is running, do not shrink */
 };
 
+static inline size_t htable_index(const hash_table *htable, size_t hashv,
+                                  size_t num_buckets) {
+  if (htable->policy.bucket_count == HTABLE_BUCKETS_POW2) {
+    return hashv & (num_buckets - 1);
+  }
+  return hashv % num_buckets;
+}
+
+static void htable_migrate_bucket(hash_table *htable,
+                                  struct hash_bucket *bucket) {
+  struct hash_entry *entry = bucket->entry;
+
+  while (entry) {
+    struct hash_entry *next = entry->next;
+    size_t idx = htable_index(htable, entry->hashv, htable->num_buckets);
+    struct hash_bucket *dest = &htable->buckets[idx];
+
+    entry->next = dest->entry;
+    dest->entry = entry;
+
+    entry = next;
+  }
+
+  bucket->entry = NULL;
+}
+
+static void htable_rehash_finish(hash_table *htable) {
+  for (size_t i = htable->rehash_idx; i < htable->old_num_buckets; ++i) {
+    htable_migrate_bucket(htable, &htable->old_buckets[i]);
+  }
+
+  yu_free(htable->old_buckets);
+  htable->old_buckets = NULL;
+}
+
+static void htable_rehash_step(hash_table *htable) {
+  if (!htable->old_buckets) {
+    return;
+  }
+
+  size_t empty_visits = REHASH_EMPTY_VISITS;
+  size_t migrated = 0;
+
+  while (htable->rehash_idx < htable->old_num_buckets &&
+         migrated < REHASH_STEP) {
+    struct hash_bucket *bucket = &htable->old_buckets[htable->rehash_idx++];
+
+    if (bucket->entry) {
+      htable_migrate_bucket(htable, bucket);
+      migrated++;
+    } else if (--empty_visits == 0) {
+      break;
+    }
+  }
+
+  if (htable->rehash_idx == htable->old_num_buckets) {
+    yu_free(htable->old_buckets);
+    htable->old_buckets = NULL;
+  }
+}
+
+static inline void htable_set_limits(hash_table *htable) {
+  htable->ideal_num_items =
+    htable->num_buckets * htable->policy.load_factor + 1;
+  htable->shrink_num_items =
+    htable->num_buckets * htable->policy.shrink_load_factor;
+}
+
+static bool htable_is_prime(size_t n) {
+  if (n < 2) {
+    return false;
+  }
+
+  for (size_t d = 2; d <= n / d; ++d) {
+    if (n % d == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* Closest allowed number of buckets not less than `num_buckets` */
+static size_t htable_round_buckets(const hash_table *htable,
+                                   size_t num_buckets) {
+  size_t rounded = num_buckets > 0 ? num_buckets : 1;
+
+  switch (htable->policy.bucket_count) {
+  case HTABLE_BUCKETS_POW2:
+    rounded = 1;
+    while (rounded < num_buckets) {
+      rounded *= 2;
+    }
+    break;
+  case HTABLE_BUCKETS_PRIME:
+    while (!htable_is_prime(rounded)) {
+      rounded++;
+    }
+    break;
+  case HTABLE_BUCKETS_ANY:
+    break;
+  }
+
+  return rounded;
+}
+
+static size_t htable_grown_buckets(const hash_table *htable,
+                                   size_t num_buckets) {
+  size_t grown = num_buckets * htable->policy.growth_factor;
+  if (grown <= num_buckets) {
+    grown = num_buckets + 1;
+  }
+
+  return htable_round_buckets(htable, grown);
+}
+
+/* Number of buckets before the last growth, `num_buckets` if the table
+ * could not have grown to it. Shrinking follows growth steps backwards,
+ * so counts of `HTABLE_BUCKETS_ANY` stay `initial count * factor^k` */
+static size_t htable_smaller_buckets(const hash_table *htable,
+                                     size_t num_buckets) {
+  if (htable->policy.bucket_count == HTABLE_BUCKETS_POW2) {
+    return num_buckets > 1 ? num_buckets / 2 : num_buckets;
+  }
+
+  size_t smaller = num_buckets / htable->policy.growth_factor;
+  if (smaller == 0) {
+    return num_buckets;
+  }
+
+  if (htable->policy.bucket_count == HTABLE_BUCKETS_PRIME) {
+    smaller = htable_round_buckets(htable, smaller);
+    return smaller < num_buckets ? smaller : num_buckets;
+  }
+
+  /* Division is truncated, the exact step back could be a bit larger */
+  while (smaller < num_buckets &&
+         htable_grown_buckets(htable, smaller) < num_buckets) {
+    smaller++;
+  }
+
+  return smaller < num_buckets &&
+             htable_grown_buckets(htable, smaller) == num_buckets
+           ? smaller
+           : num_buckets;
+}
+
+/* Sample evenly spread buckets and move load factor towards the one
+ * that gives target average length of non-empty chains */
+static void htable_tune(hash_table *htable) {
+  struct htable_policy *policy = &htable->policy;
+
+  /* Entries are split between old and new buckets during rehash */
+  if (policy->target_chain_length <= 0 || htable->old_buckets) {
+    return;
+  }
+
+  size_t stride = htable->num_buckets / TUNE_SAMPLE_BUCKETS;
+  if (stride == 0) {
+    stride = 1;
+  }
+
+  size_t num_chains = 0;
+  size_t num_entries = 0;
+  for (size_t i = 0; i < htable->num_buckets; i += stride) {
+    struct hash_entry *entry = htable->buckets[i].entry;
+
+    num_chains += entry != NULL;
+    for (; entry; entry = entry->next) {
+      num_entries++;
+    }
+  }
+
+  if (num_chains < TUNE_MIN_CHAINS) {
+    return;
+  }
+
+  double chain_length = (double)num_entries / num_chains;
+  double step = 1;
+  if (chain_length > policy->target_chain_length * TUNE_TOLERANCE) {
+    step = 1 / TUNE_STEP;
+  } else if (chain_length * TUNE_TOLERANCE < policy->target_chain_length) {
+    step = TUNE_STEP;
+  }
+
+  double load_factor = policy->load_factor * step;
+  if (load_factor < TUNE_MIN_LOAD_FACTOR) {
+    load_factor = TUNE_MIN_LOAD_FACTOR;
+  } else if (load_factor > TUNE_MAX_LOAD_FACTOR) {
+    load_factor = TUNE_MAX_LOAD_FACTOR;
+  }
+
+  /* Shrink limit keeps its ratio to the load factor */
+  policy->shrink_load_factor *= load_factor / policy->load_factor;
+  policy->load_factor = load_factor;
+  htable_set_limits(htable);
+}
+
+static bool htable_resize(hash_table *htable, size_t new_num_buckets,
+                          bool incremental) {
+  struct hash_bucket *nbuckets = yu_calloc(new_num_buckets, sizeof(*nbuckets));
+  if (!nbuckets) {
+    return false;
+  }
+
+  if (htable->old_buckets) {
+    htable_rehash_finish(htable);
+  }
+
+  htable->old_buckets = htable->buckets;
+  htable->old_num_buckets = htable->num_buckets;
+  htable->rehash_idx = 0;
+
+  htable->buckets = nbuckets;
+  htable->num_buckets = new_num_buckets;
+  htable_set_limits(htable);
+
+  if (!incremental) {
+    htable_rehash_finish(htable);
+  }
+
+  return true;
+}
+
 static inline struct hash_bucket *htable_bucket_by_hashv(hash_table *htable,
                                                          size_t hashv) {
-  return &htable->buckets[hashv % htable->num_buckets];
+  if (htable->old_buckets) {
+    /* Entries with this hash value could still be in the old bucket.
+     * Migrate it now, so every entry is found in the new one */
+    size_t idx = htable_index(htable, hashv, htable->old_num_buckets);
+    struct hash_bucket *old = &htable->old_buckets[idx];
+
+    if (old->entry) {
+      htable_migrate_bucket(htable, old);
+    }
+  }
+
+  return &htable->buckets[htable_index(htable, hashv, htable->num_buckets)];
 }
 
 static inline struct hash_bucket *htable_bucket(hash_table *htable,
@@ -43,30 +338,95 @@ static inline struct hash_bucket *htable_bucket(hash_table *htable,
 }
 
 static inline bool htable_expand_buckets(hash_table *htable) {
+  if (htable->num_items < htable->ideal_num_items) {
+    return true;
+  }
+
+  /* Tuning could raise the limit, so that the table does not grow */
+  htable_tune(htable);
+
   return htable->num_items < htable->ideal_num_items ||
-         htable_rehash(htable, htable->num_buckets * 2);
+         htable_resize(htable,
+                       htable_grown_buckets(htable, htable->num_buckets),
+                       htable->incremental);
+}
+
+/* Shrinking steps back by the growth factor only while the table could
+ * have grown from the smaller count, see `htable_smaller_buckets`.
+ *
+ * Compact tables are iterated by buckets, and shrinking during
+ * `htable_for_each_temp` would reorder them under the iterator */
+static inline bool htable_shrink_buckets(hash_table *htable) {
+#ifdef YU_HTABLE_COMPACT
+  YU_UNUSED(htable);
+  return true;
+#else
+  if (htable->scanning || htable->num_items >= htable->shrink_num_items) {
+    return true;
+  }
+
+  size_t num_buckets = htable_smaller_buckets(htable, htable->num_buckets);
+  if (num_buckets == htable->num_buckets ||
+      num_buckets < htable->min_num_buckets ||
+      (size_t)(num_buckets * htable->policy.load_factor + 1) <=
+        htable->num_items) {
+    return true;
+  }
+
+  return htable_resize(htable, num_buckets, htable->incremental);
+#endif
+}
+
+/* Number of buckets after growing current one until `num_items` fit */
+static size_t htable_buckets_for(hash_table *htable, size_t num_items) {
+  size_t num_buckets = htable->num_buckets;
+  while ((size_t)(num_buckets * htable->policy.load_factor + 1) <
+         num_items) {
+    num_buckets = htable_grown_buckets(htable, num_buckets);
+  }
+
+  return num_buckets;
+}
+
+/* Grow once, so that `num_items` entries fit without another rehash */
+static bool htable_reserve_items(hash_table *htable, size_t num_items,
+                                 bool incremental) {
+  size_t num_buckets = htable_buckets_for(htable, num_items);
+
+  return num_buckets == htable->num_buckets ||
+         htable_resize(htable, num_buckets, incremental);
 }
 
 static void htable_replace_entry(struct hash_entry **victim,
                                  struct hash_entry *new) {
   struct hash_entry *entry = *victim;
 
+#ifndef YU_HTABLE_COMPACT
   new->ht_prev = entry->ht_prev;
   new->ht_next = entry->ht_next;
+#endif
   new->next = entry->next;
 
   *victim = new;
 
+#ifndef YU_HTABLE_COMPACT
   new->ht_prev->ht_next = new;
   new->ht_next->ht_prev = new;
+#endif
 }
 
-static void htable_link_entry(struct hash_entry *tail, struct hash_entry *entry,
+static void htable_link_entry(hash_table *htable, struct hash_entry *entry,
                               struct hash_bucket *bucket) {
+#ifdef YU_HTABLE_COMPACT
+  YU_UNUSED(htable);
+#else
+  struct hash_entry *tail = htable_tail(htable);
+
   entry->ht_prev = tail;
   entry->ht_next = tail->ht_next;
   tail->ht_next->ht_prev = entry;
   tail->ht_next = entry;
+#endif
 
   entry->next = bucket->entry;
   bucket->entry = entry;
@@ -89,17 +449,61 @@ static struct hash_entry **htable_lookup_in_bucket(hash_table *htable,
   return link;
 }
 
+static struct hash_entry **
+htable_lookup_key_in_bucket(struct hash_bucket *bucket, size_t hashv,
+                            const void *key, ht_key_equal_fun key_equal) {
+  struct hash_entry **link = &bucket->entry;
+
+  while (*link) {
+    struct hash_entry *entry = *link;
+    if (entry->hashv == hashv && key_equal(entry, key)) {
+      break;
+    }
+
+    link = &entry->next;
+  }
+
+  return link;
+}
+
+void htable_policy_init(struct htable_policy *policy) {
+  assert(policy != NULL);
+
+  policy->load_factor = DEFAULT_LOAD_FACTOR;
+  policy->growth_factor = DEFAULT_GROWTH_FACTOR;
+  policy->shrink_load_factor = DEFAULT_SHRINK_LOAD_FACTOR;
+  policy->bucket_count = HTABLE_BUCKETS_ANY;
+  policy->target_chain_length = 0;
+}
+
 hash_table *htable_create(size_t num_buckets, ht_hash_fun hash,
                           ht_equal_fun equal) {
+  return htable_create_ex(num_buckets, hash, equal, NULL);
+}
+
+hash_table *htable_create_ex(size_t num_buckets, ht_hash_fun hash,
+                             ht_equal_fun equal,
+                             const struct htable_policy *policy) {
   assert(num_buckets > 0);
   assert(hash != NULL);
   assert(equal != NULL);
+  assert(!policy || policy->load_factor > 0);
+  assert(!policy || policy->growth_factor > 1);
+  assert(!policy || (policy->shrink_load_factor >= 0 &&
+                     policy->shrink_load_factor < policy->load_factor));
 
   hash_table *htable = yu_malloc(sizeof(*htable));
   if (!htable) {
     return NULL;
   }
 
+  if (policy) {
+    htable->policy = *policy;
+  } else {
+    htable_policy_init(&htable->policy);
+  }
+  num_buckets = htable_round_buckets(htable, num_buckets);
+
   htable->buckets = yu_calloc(num_buckets, sizeof(*htable->buckets));
   if (!htable->buckets) {
     yu_free(htable);
@@ -108,13 +512,22 @@ hash_table *htable_create(size_t num_buckets, ht_hash_fun hash,
 
   htable->equal = equal;
   htable->hash = hash;
+#ifndef YU_HTABLE_COMPACT
   htable->dummy_head.ht_next = htable->dummy_head.ht_prev = &htable->dummy_head;
 
   htable->dummy_head.next = DUMMY_PTR;
+#endif
 
   htable->num_items = 0;
-  htable->ideal_num_items = num_buckets * IDEAL_LOAD_FACTOR + 1;
   htable->num_buckets = num_buckets;
+  htable->min_num_buckets = num_buckets;
+  htable_set_limits(htable);
+
+  htable->old_buckets = NULL;
+  htable->old_num_buckets = 0;
+  htable->rehash_idx = 0;
+  htable->incremental = false;
+  htable->scanning = false;
 
   return htable;
 }
@@ -128,54 +541,104 @@ void htable_destroy(hash_table *htable, ht_destroy_fun destroy_table) {
     destroy_table(htable);
   }
 
+  if (htable->old_buckets) {
+    yu_free(htable->old_buckets);
+  }
   yu_free(htable->buckets);
   yu_free(htable);
 }
 
 bool htable_rehash(hash_table *htable, size_t new_num_buckets) {
   assert(htable != NULL);
+  assert(new_num_buckets > 0);
 
-  struct hash_bucket *nbuckets = yu_calloc(new_num_buckets, sizeof(*nbuckets));
-  if (!nbuckets) {
+  return htable_resize(htable, htable_round_buckets(htable, new_num_buckets),
+                       false);
+}
+
+bool htable_reserve(hash_table *htable, size_t num_items) {
+  assert(htable != NULL);
+
+  if (!htable_reserve_items(htable, num_items, false)) {
     return false;
   }
 
-  yu_free(htable->buckets);
+  /* Do not shrink below reserved size while the table is being filled */
+  size_t num_buckets = htable_buckets_for(htable, num_items);
+  if (num_buckets > htable->min_num_buckets) {
+    htable->min_num_buckets = num_buckets;
+  }
 
-  htable->buckets = nbuckets;
-  htable->num_buckets = new_num_buckets;
-  htable->ideal_num_items = new_num_buckets * IDEAL_LOAD_FACTOR + 1;
+  return true;
+}
+
+bool htable_shrink_to_fit(hash_table *htable) {
+  assert(htable != NULL);
 
-  struct hash_entry *entry = htable_head(htable);
-  while (entry != &htable->dummy_head) {
-    struct hash_bucket *bucket = htable_bucket_by_hashv(htable, entry->hashv);
+  size_t num_buckets = htable->num_buckets;
+  for (;;) {
+    size_t smaller = htable_smaller_buckets(htable, num_buckets);
+    if (smaller == num_buckets ||
+        (size_t)(smaller * htable->policy.load_factor + 1) <=
+          htable->num_items) {
+      break;
+    }
+    num_buckets = smaller;
+  }
 
-    entry->next = bucket->entry;
-    bucket->entry = entry;
+  if (num_buckets != htable->num_buckets &&
+      !htable_resize(htable, num_buckets, false)) {
+    return false;
+  }
 
-    entry = entry->ht_next;
+  if (htable->old_buckets) {
+    htable_rehash_finish(htable);
   }
+  htable->min_num_buckets = num_buckets;
 
   return true;
 }
 
-bool htable_insert(hash_table *htable, struct hash_entry *entry) {
+void htable_set_incremental(hash_table *htable, bool incremental) {
+  assert(htable != NULL);
+
+  if (!incremental && htable->old_buckets) {
+    htable_rehash_finish(htable);
+  }
+  htable->incremental = incremental;
+}
+
+bool htable_rehashing(hash_table *htable) {
+  assert(htable != NULL);
+  return htable->old_buckets != NULL;
+}
+
+bool htable_insert_hashed(hash_table *htable, struct hash_entry *entry,
+                          size_t hashv) {
   assert(htable != NULL);
   assert(entry != NULL);
 
   if (!htable_expand_buckets(htable)) {
     return false;
   }
+  htable_rehash_step(htable);
 
-  struct hash_bucket *bucket = htable_bucket(htable, entry);
-  struct hash_entry *tail = htable_tail(htable);
+  entry->hashv = hashv;
+  struct hash_bucket *bucket = htable_bucket_by_hashv(htable, hashv);
 
-  htable_link_entry(tail, entry, bucket);
+  htable_link_entry(htable, entry, bucket);
   htable->num_items++;
 
   return true;
 }
 
+bool htable_insert(hash_table *htable, struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  return htable_insert_hashed(htable, entry, htable->hash(entry));
+}
+
 bool htable_replace(hash_table *htable, struct hash_entry *entry,
                     struct hash_entry **replaced) {
   assert(htable != NULL);
@@ -187,10 +650,10 @@ bool htable_replace(hash_table *htable, struct hash_entry *entry,
   if (!htable_expand_buckets(htable)) {
     return false;
   }
+  htable_rehash_step(htable);
 
   struct hash_bucket *bucket = htable_bucket(htable, entry);
   struct hash_entry **link = htable_lookup_in_bucket(htable, bucket, entry);
-  struct hash_entry *tail = htable_tail(htable);
 
   if (*link) {
     *replaced = *link;
@@ -199,7 +662,34 @@ bool htable_replace(hash_table *htable, struct hash_entry *entry,
     return true;
   }
 
-  htable_link_entry(tail, entry, bucket);
+  htable_link_entry(htable, entry, bucket);
+  htable->num_items++;
+
+  return true;
+}
+
+bool htable_find_or_insert(hash_table *htable, struct hash_entry *entry,
+                           struct hash_entry **existing) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+  assert(existing != NULL);
+
+  *existing = NULL;
+
+  if (!htable_expand_buckets(htable)) {
+    return false;
+  }
+  htable_rehash_step(htable);
+
+  struct hash_bucket *bucket = htable_bucket(htable, entry);
+  struct hash_entry **link = htable_lookup_in_bucket(htable, bucket, entry);
+
+  if (*link) {
+    *existing = *link;
+    return true;
+  }
+
+  htable_link_entry(htable, entry, bucket);
   htable->num_items++;
 
   return true;
@@ -209,73 +699,661 @@ struct hash_entry *htable_lookup(hash_table *htable, struct hash_entry *query) {
   assert(htable != NULL);
   assert(query != NULL);
 
+  htable_rehash_step(htable);
+
   struct hash_bucket *bucket = htable_bucket(htable, query);
 
   return *htable_lookup_in_bucket(htable, bucket, query);
 }
 
+struct hash_bucket *htable_bucket_for(hash_table *htable, size_t hashv) {
+  assert(htable != NULL);
+
+  htable_rehash_step(htable);
+
+  return htable_bucket_by_hashv(htable, hashv);
+}
+
+struct hash_entry *htable_lookup_hashed(hash_table *htable, size_t hashv,
+                                        const void *key,
+                                        ht_key_equal_fun key_equal) {
+  assert(htable != NULL);
+  assert(key_equal != NULL);
+
+  struct hash_bucket *bucket = htable_bucket_for(htable, hashv);
+
+  return *htable_lookup_key_in_bucket(bucket, hashv, key, key_equal);
+}
+
 static void htable_remove_link(struct hash_entry **link) {
+#ifndef YU_HTABLE_COMPACT
   struct hash_entry *entry = *link;
 
   entry->ht_prev->ht_next = entry->ht_next;
   entry->ht_next->ht_prev = entry->ht_prev;
+#endif
   *link = (*link)->next;
 }
 
-struct hash_entry *htable_remove(hash_table *htable, struct hash_entry *query) {
+void htable_unlink(hash_table *htable, struct hash_entry **link) {
   assert(htable != NULL);
-  assert(query != NULL);
+  assert(link != NULL && *link != NULL);
 
-  struct hash_bucket *bucket = htable_bucket(htable, query);
-  struct hash_entry **link = htable_lookup_in_bucket(htable, bucket, query);
+  htable_remove_link(link);
+  htable->num_items--;
+  htable_shrink_buckets(htable);
+}
 
-  struct hash_entry *entry = *link;
+/* First stage of batched operations: hash every entry of
+ * the group and prefetch the buckets they belong to */
+static void htable_batch_hash(hash_table *htable, struct hash_entry **entries,
+                              size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    htable_rehash_step(htable);
 
-  if (entry) {
-    htable_remove_link(link);
-    htable->num_items--;
+    size_t hashv = entries[i]->hashv = htable->hash(entries[i]);
+
+    if (htable->old_buckets) {
+      size_t old_idx = htable_index(htable, hashv, htable->old_num_buckets);
+      YU_PREFETCH(&htable->old_buckets[old_idx]);
+    }
+    size_t idx = htable_index(htable, hashv, htable->num_buckets);
+    YU_PREFETCH(&htable->buckets[idx]);
   }
+}
 
-  return entry;
+/* Second stage: load buckets and prefetch the first entries of chains */
+static void htable_batch_buckets(hash_table *htable,
+                                 struct hash_entry **entries,
+                                 struct hash_bucket **buckets, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    buckets[i] = htable_bucket_by_hashv(htable, entries[i]->hashv);
+    YU_PREFETCH(buckets[i]->entry);
+  }
 }
 
-void htable_erase(hash_table *htable, struct hash_entry *entry) {
+void htable_lookup_batch(hash_table *htable, struct hash_entry **queries,
+                         struct hash_entry **results, size_t n) {
   assert(htable != NULL);
-  assert(entry != NULL);
+  assert(queries != NULL);
+  assert(results != NULL);
 
-  struct hash_bucket *bucket = htable_bucket_by_hashv(htable, entry->hashv);
-  struct hash_entry **link = &bucket->entry;
+  struct hash_bucket *buckets[BATCH_SIZE];
 
-  while (*link != entry) {
-    link = &(*link)->next;
-  }
+  for (size_t start = 0; start < n; start += BATCH_SIZE) {
+    struct hash_entry **group = queries + start;
+    size_t count = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
 
-  htable_remove_link(link);
-  htable->num_items--;
-}
+    htable_batch_hash(htable, group, count);
+    htable_batch_buckets(htable, group, buckets, count);
 
-size_t htable_size(hash_table *htable) {
-  assert(htable != NULL);
-  return htable->num_items;
+    for (size_t i = 0; i < count; ++i) {
+      results[start + i] =
+        *htable_lookup_in_bucket(htable, buckets[i], group[i]);
+    }
+  }
 }
 
-size_t htable_num_buckets(hash_table *htable) {
+void htable_remove_batch(hash_table *htable, struct hash_entry **queries,
+                         struct hash_entry **results, size_t n) {
   assert(htable != NULL);
-  return htable->num_buckets;
-}
+  assert(queries != NULL);
+  assert(results != NULL);
 
-struct hash_entry *htable_first(hash_table *htable) {
-  assert(htable != NULL);
-  return htable->num_items ? htable_head(htable) : NULL;
-}
+  struct hash_bucket *buckets[BATCH_SIZE];
 
-struct hash_entry *htable_last(hash_table *htable) {
-  assert(htable != NULL);
-  return htable->num_items ? htable_tail(htable) : NULL;
-}
+  for (size_t start = 0; start < n; start += BATCH_SIZE) {
+    struct hash_entry **group = queries + start;
+    size_t count = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
 
-struct hash_entry *htable_next(const struct hash_entry *entry) {
-  assert(entry != NULL);
+    htable_batch_hash(htable, group, count);
+    htable_batch_buckets(htable, group, buckets, count);
+
+    for (size_t i = 0; i < count; ++i) {
+      struct hash_entry **link =
+        htable_lookup_in_bucket(htable, buckets[i], group[i]);
+
+      results[start + i] = *link;
+      if (*link) {
+        htable_remove_link(link);
+        htable->num_items--;
+      }
+    }
+  }
+
+  /* Shrink only after the whole batch: resizing in the middle
+   * of a group would invalidate resolved buckets */
+  size_t num_buckets;
+  do {
+    num_buckets = htable->num_buckets;
+  } while (htable_shrink_buckets(htable) && num_buckets != htable->num_buckets);
+}
+
+bool htable_insert_batch(hash_table *htable, struct hash_entry **entries,
+                         size_t n) {
+  assert(htable != NULL);
+  assert(entries != NULL);
+
+  if (!htable_reserve_items(htable, htable->num_items + n,
+                            htable->incremental)) {
+    return false;
+  }
+
+  struct hash_bucket *buckets[BATCH_SIZE];
+
+  for (size_t start = 0; start < n; start += BATCH_SIZE) {
+    struct hash_entry **group = entries + start;
+    size_t count = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
+
+    htable_batch_hash(htable, group, count);
+    htable_batch_buckets(htable, group, buckets, count);
+
+    for (size_t i = 0; i < count; ++i) {
+      htable_link_entry(htable, group[i], buckets[i]);
+      htable->num_items++;
+    }
+  }
+
+  return true;
+}
+
+/* Number of threads to process `n` entries, at least one */
+static size_t htable_threads_for(size_t n, size_t num_threads) {
+  size_t max_threads = n / THREAD_MIN_ITEMS;
+
+  if (num_threads > max_threads) {
+    num_threads = max_threads;
+  }
+  if (num_threads > MAX_THREADS) {
+    num_threads = MAX_THREADS;
+  }
+
+  return num_threads > 0 ? num_threads : 1;
+}
+
+/* Run `fn` for every task, in separate threads if possible. Task that
+ * could not get a thread is run by the calling one */
+static void htable_run_tasks(void *(*fn)(void *), void *tasks,
+                             size_t task_size, size_t num_tasks) {
+#ifdef YU_HTABLE_THREADS
+  pthread_t threads[MAX_THREADS];
+  bool started[MAX_THREADS];
+
+  for (size_t i = 1; i < num_tasks; ++i) {
+    void *task = (char *)tasks + i * task_size;
+
+    started[i] = pthread_create(&threads[i], NULL, fn, task) == 0;
+    if (!started[i]) {
+      fn(task);
+    }
+  }
+  fn(tasks);
+
+  for (size_t i = 1; i < num_tasks; ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+#else
+  for (size_t i = 0; i < num_tasks; ++i) {
+    fn((char *)tasks + i * task_size);
+  }
+#endif
+}
+
+/* Push entry to the head of the bucket chain. Threads of parallel build
+ * share buckets, joining the threads publishes the chains */
+static inline void htable_push_entry(struct hash_bucket *bucket,
+                                     struct hash_entry *entry) {
+#ifdef YU_HTABLE_THREADS
+  struct hash_entry *head = __atomic_load_n(&bucket->entry, __ATOMIC_RELAXED);
+  do {
+    entry->next = head;
+  } while (!__atomic_compare_exchange_n(&bucket->entry, &head, entry, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#else
+  entry->next = bucket->entry;
+  bucket->entry = entry;
+#endif
+}
+
+struct build_task {
+  hash_table *htable;
+  struct hash_entry **entries;
+  size_t n;
+};
+
+static void *htable_build_task(void *arg) {
+  struct build_task *task = arg;
+  hash_table *htable = task->htable;
+  struct hash_entry **entries = task->entries;
+
+  for (size_t i = 0; i < task->n; ++i) {
+    struct hash_entry *entry = entries[i];
+    entry->hashv = htable->hash(entry);
+
+#ifndef YU_HTABLE_COMPACT
+    /* Insertion order list of the segment, its ends are stitched later */
+    entry->ht_prev = i > 0 ? entries[i - 1] : NULL;
+    entry->ht_next = i + 1 < task->n ? entries[i + 1] : NULL;
+#endif
+
+    size_t idx = htable_index(htable, entry->hashv, htable->num_buckets);
+    htable_push_entry(&htable->buckets[idx], entry);
+  }
+
+  return NULL;
+}
+
+bool htable_build_parallel(hash_table *htable, struct hash_entry **entries,
+                           size_t n, size_t num_threads) {
+  assert(htable != NULL);
+  assert(entries != NULL || n == 0);
+
+  if (!htable_reserve_items(htable, htable->num_items + n, false)) {
+    return false;
+  }
+  if (htable->old_buckets) {
+    htable_rehash_finish(htable);
+  }
+
+  if (n == 0) {
+    return true;
+  }
+
+  struct build_task tasks[MAX_THREADS];
+  num_threads = htable_threads_for(n, num_threads);
+
+  size_t chunk = n / num_threads, rem = n % num_threads, start = 0;
+  for (size_t i = 0; i < num_threads; ++i) {
+    size_t count = chunk + (i < rem);
+
+    tasks[i] = (struct build_task){htable, entries + start, count};
+    start += count;
+  }
+
+  htable_run_tasks(htable_build_task, tasks, sizeof(*tasks), num_threads);
+
+#ifndef YU_HTABLE_COMPACT
+  struct hash_entry *tail = htable_tail(htable);
+  for (size_t i = 0; i < num_threads; ++i) {
+    tail->ht_next = tasks[i].entries[0];
+    tasks[i].entries[0]->ht_prev = tail;
+    tail = tasks[i].entries[tasks[i].n - 1];
+  }
+  tail->ht_next = &htable->dummy_head;
+  htable_tail(htable) = tail;
+#endif
+
+  htable->num_items += n;
+  return true;
+}
+
+struct visit_task {
+  hash_table *htable;
+  size_t lo, hi;         /* Range of `buckets` */
+  size_t old_lo, old_hi; /* Range of `old_buckets` */
+
+  ht_visit_fun visit;
+  ht_fold_fun fold; /* Used instead of `visit` if not `NULL` */
+  void *acc;
+  void *arg;
+};
+
+static void htable_visit_range(struct visit_task *task,
+                               struct hash_bucket *buckets, size_t lo,
+                               size_t hi) {
+  for (size_t i = lo; i < hi; ++i) {
+    /* Chains are scattered over the heap, fetch them ahead */
+    if (i + VISIT_PREFETCH_DISTANCE < hi) {
+      YU_PREFETCH(buckets[i + VISIT_PREFETCH_DISTANCE].entry);
+    }
+
+    for (struct hash_entry *entry = buckets[i].entry; entry;
+         entry = entry->next) {
+      if (task->fold) {
+        task->fold(task->acc, entry, task->arg);
+      } else {
+        task->visit(entry, task->arg);
+      }
+    }
+  }
+}
+
+static void *htable_visit_task(void *arg) {
+  struct visit_task *task = arg;
+  hash_table *htable = task->htable;
+
+  htable_visit_range(task, htable->buckets, task->lo, task->hi);
+  if (htable->old_buckets) {
+    htable_visit_range(task, htable->old_buckets, task->old_lo, task->old_hi);
+  }
+
+  return NULL;
+}
+
+/* Split both bucket arrays into `num_threads` ranges */
+static void htable_split_buckets(hash_table *htable, struct visit_task *tasks,
+                                 size_t num_threads) {
+  for (size_t i = 0; i < num_threads; ++i) {
+    tasks[i].htable = htable;
+    tasks[i].lo = htable->num_buckets / num_threads * i;
+    tasks[i].hi = htable->num_buckets / num_threads * (i + 1);
+    tasks[i].old_lo = htable->old_num_buckets / num_threads * i;
+    tasks[i].old_hi = htable->old_num_buckets / num_threads * (i + 1);
+  }
+
+  tasks[num_threads - 1].hi = htable->num_buckets;
+  tasks[num_threads - 1].old_hi = htable->old_num_buckets;
+}
+
+void htable_parallel_for_each(hash_table *htable, ht_visit_fun fn, void *arg,
+                              size_t num_threads) {
+  assert(htable != NULL);
+  assert(fn != NULL);
+
+  struct visit_task tasks[MAX_THREADS];
+  num_threads = htable_threads_for(htable->num_items, num_threads);
+
+  htable_split_buckets(htable, tasks, num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    tasks[i].visit = fn;
+    tasks[i].fold = NULL;
+    tasks[i].acc = NULL;
+    tasks[i].arg = arg;
+  }
+
+  htable_run_tasks(htable_visit_task, tasks, sizeof(*tasks), num_threads);
+}
+
+bool htable_parallel_reduce(hash_table *htable, void *acc, size_t acc_size,
+                            ht_fold_fun fold, ht_combine_fun combine,
+                            void *arg, size_t num_threads) {
+  assert(htable != NULL);
+  assert(acc != NULL);
+  assert(fold != NULL);
+  assert(combine != NULL);
+
+  struct visit_task tasks[MAX_THREADS];
+  num_threads = htable_threads_for(htable->num_items, num_threads);
+
+  /* First thread folds into `acc` itself, others get copies of it */
+  size_t stride = (acc_size + sizeof(max_align_t) - 1) /
+                  sizeof(max_align_t) * sizeof(max_align_t);
+  char *accs = NULL;
+  if (num_threads > 1) {
+    accs = yu_malloc((num_threads - 1) * stride);
+    if (!accs) {
+      return false;
+    }
+  }
+
+  htable_split_buckets(htable, tasks, num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    tasks[i].visit = NULL;
+    tasks[i].fold = fold;
+    tasks[i].acc = i == 0 ? acc : accs + (i - 1) * stride;
+    tasks[i].arg = arg;
+
+    if (i > 0) {
+      memcpy(tasks[i].acc, acc, acc_size);
+    }
+  }
+
+  htable_run_tasks(htable_visit_task, tasks, sizeof(*tasks), num_threads);
+
+  for (size_t i = 1; i < num_threads; ++i) {
+    combine(acc, tasks[i].acc, arg);
+  }
+
+  if (accs) {
+    yu_free(accs);
+  }
+  return true;
+}
+
+struct hash_entry *htable_remove(hash_table *htable, struct hash_entry *query) {
+  assert(htable != NULL);
+  assert(query != NULL);
+
+  htable_rehash_step(htable);
+
+  struct hash_bucket *bucket = htable_bucket(htable, query);
+  struct hash_entry **link = htable_lookup_in_bucket(htable, bucket, query);
+
+  struct hash_entry *entry = *link;
+
+  if (entry) {
+    htable_unlink(htable, link);
+  }
+
+  return entry;
+}
+
+struct hash_entry *htable_remove_hashed(hash_table *htable, size_t hashv,
+                                        const void *key,
+                                        ht_key_equal_fun key_equal) {
+  assert(htable != NULL);
+  assert(key_equal != NULL);
+
+  struct hash_bucket *bucket = htable_bucket_for(htable, hashv);
+  struct hash_entry **link =
+    htable_lookup_key_in_bucket(bucket, hashv, key, key_equal);
+
+  struct hash_entry *entry = *link;
+
+  if (entry) {
+    htable_unlink(htable, link);
+  }
+
+  return entry;
+}
+
+void htable_erase(hash_table *htable, struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  htable_rehash_step(htable);
+
+  struct hash_bucket *bucket = htable_bucket_by_hashv(htable, entry->hashv);
+  struct hash_entry **link = &bucket->entry;
+
+  while (*link != entry) {
+    link = &(*link)->next;
+  }
+
+  htable_unlink(htable, link);
+}
+
+/* Bucket counts are always `odd * 2^k` with the same odd factor, so
+ * bucket index is `x + odd * y`, where `x = hashv % odd` never changes
+ * on resize and `y` gains one high bit every time the table doubles.
+ * Cursor keeps `x` as is and increments `y` in reverse-binary order,
+ * so buckets split by a resize are never skipped */
+static size_t htable_odd_part(size_t num_buckets) {
+  while (num_buckets % 2 == 0) {
+    num_buckets /= 2;
+  }
+  return num_buckets;
+}
+
+static size_t htable_reverse_bits(size_t v) {
+  size_t r = 0;
+  for (size_t i = 0; i < sizeof(v) * CHAR_BIT; ++i) {
+    r = (r << 1) | (v & 1);
+    v >>= 1;
+  }
+  return r;
+}
+
+size_t htable_scan(hash_table *htable, size_t cursor, ht_scan_fun fn,
+                   void *arg) {
+  assert(htable != NULL);
+  assert(fn != NULL);
+
+  size_t odd = htable_odd_part(htable->num_buckets);
+
+  /* Growth factor other than 2 changes the odd factor, the arrays
+   * could not be matched by `y` */
+  if (htable->old_buckets &&
+      htable_odd_part(htable->old_num_buckets) != odd) {
+    htable_rehash_finish(htable);
+  }
+
+  size_t x = cursor % odd;
+  size_t y = cursor / odd;
+
+  size_t mask = htable->num_buckets / odd - 1;
+  size_t small_mask = mask;
+
+  if (htable->old_buckets) {
+    size_t old_mask = htable->old_num_buckets / odd - 1;
+    if (old_mask < small_mask) {
+      small_mask = old_mask;
+    }
+
+    /* Move every entry of the visited buckets into the new array,
+     * so that the callback could erase entries with `htable_erase` */
+    for (size_t i = y & small_mask; i <= old_mask; i += small_mask + 1) {
+      htable_migrate_bucket(htable, &htable->old_buckets[x + odd * i]);
+    }
+  }
+
+  htable->scanning = true;
+
+  /* Smaller array was indexed by the low bits of `y` only, buckets
+   * of the larger one that share these bits are visited together */
+  for (size_t i = y & small_mask; i <= mask; i += small_mask + 1) {
+    struct hash_entry *entry = htable->buckets[x + odd * i].entry;
+
+    while (entry) {
+      struct hash_entry *next = entry->next;
+      fn(entry, arg);
+      entry = next;
+    }
+  }
+
+  htable->scanning = false;
+  htable_shrink_buckets(htable);
+
+  y |= ~small_mask;
+  y = htable_reverse_bits(htable_reverse_bits(y) + 1);
+
+  if (y == 0 && ++x == odd) {
+    return 0;
+  }
+
+  return x + odd * y;
+}
+
+size_t htable_size(hash_table *htable) {
+  assert(htable != NULL);
+  return htable->num_items;
+}
+
+size_t htable_num_buckets(hash_table *htable) {
+  assert(htable != NULL);
+  return htable->num_buckets;
+}
+
+void htable_get_policy(hash_table *htable, struct htable_policy *policy) {
+  assert(htable != NULL);
+  assert(policy != NULL);
+
+  *policy = htable->policy;
+}
+
+#ifdef YU_HTABLE_COMPACT
+/* First entry of the first non-empty bucket starting from `idx` */
+static struct hash_entry *htable_first_from(hash_table *htable, size_t idx) {
+  for (; idx < htable->num_buckets; ++idx) {
+    if (htable->buckets[idx].entry) {
+      return htable->buckets[idx].entry;
+    }
+  }
+
+  return NULL;
+}
+
+/* Last entry of the last non-empty bucket before `idx` */
+static struct hash_entry *htable_last_before(hash_table *htable, size_t idx) {
+  while (idx-- > 0) {
+    struct hash_entry *entry = htable->buckets[idx].entry;
+
+    if (entry) {
+      while (entry->next) {
+        entry = entry->next;
+      }
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+struct hash_entry *htable_first(hash_table *htable) {
+  assert(htable != NULL);
+
+  /* Iteration walks only new buckets */
+  if (htable->old_buckets) {
+    htable_rehash_finish(htable);
+  }
+  return htable->num_items ? htable_first_from(htable, 0) : NULL;
+}
+
+struct hash_entry *htable_last(hash_table *htable) {
+  assert(htable != NULL);
+
+  if (htable->old_buckets) {
+    htable_rehash_finish(htable);
+  }
+  return htable->num_items ? htable_last_before(htable, htable->num_buckets)
+                           : NULL;
+}
+
+struct hash_entry *htable_next_in(hash_table *htable,
+                                  const struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  if (entry->next) {
+    return entry->next;
+  }
+
+  size_t idx = htable_index(htable, entry->hashv, htable->num_buckets);
+  return htable_first_from(htable, idx + 1);
+}
+
+struct hash_entry *htable_prev_in(hash_table *htable,
+                                  const struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  size_t idx = htable_index(htable, entry->hashv, htable->num_buckets);
+  struct hash_entry *prev = htable->buckets[idx].entry;
+
+  if (prev == entry) {
+    return htable_last_before(htable, idx);
+  }
+
+  while (prev->next != entry) {
+    prev = prev->next;
+  }
+  return prev;
+}
+#else
+struct hash_entry *htable_first(hash_table *htable) {
+  assert(htable != NULL);
+  return htable->num_items ? htable_head(htable) : NULL;
+}
+
+struct hash_entry *htable_last(hash_table *htable) {
+  assert(htable != NULL);
+  return htable->num_items ? htable_tail(htable) : NULL;
+}
+
+struct hash_entry *htable_next(const struct hash_entry *entry) {
+  assert(entry != NULL);
 
   entry = entry->ht_next;
   if (entry->next == DUMMY_PTR) {
@@ -294,6 +1372,36 @@ struct hash_entry *htable_prev(const struct hash_entry *entry) {
   return (struct hash_entry *)entry;
 }
 
+struct hash_entry *htable_next_in(hash_table *htable,
+                                  const struct hash_entry *entry) {
+  YU_UNUSED(htable);
+  return htable_next(entry);
+}
+
+struct hash_entry *htable_prev_in(hash_table *htable,
+                                  const struct hash_entry *entry) {
+  YU_UNUSED(htable);
+  return htable_prev(entry);
+}
+
+void htable_move_last(hash_table *htable, struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  struct hash_entry *tail = htable_tail(htable);
+  if (entry == tail) {
+    return;
+  }
+
+  entry->ht_prev->ht_next = entry->ht_next;
+  entry->ht_next->ht_prev = entry->ht_prev;
+
+  entry->ht_prev = tail;
+  entry->ht_next = tail->ht_next;
+  tail->ht_next->ht_prev = entry;
+  tail->ht_next = entry;
+}
+
 /* Simon Tatham's algorithm */
 void htable_sort(hash_table *htable, ht_less_fun less) {
   assert(htable != NULL);
@@ -358,3 +1466,245 @@ void htable_sort(hash_table *htable, ht_less_fun less) {
   htable_head(htable) = head;
   htable_tail(htable) = tail;
 }
+
+/* Collect pointers to every entry in the list order */
+static struct hash_entry **htable_entries_array(hash_table *htable,
+                                                size_t extra) {
+  struct hash_entry **entries =
+    yu_malloc((htable->num_items + extra) * sizeof(*entries));
+  if (!entries) {
+    return NULL;
+  }
+
+  size_t i = 0;
+  for (struct hash_entry *entry = htable_head(htable);
+       entry != &htable->dummy_head; entry = entry->ht_next) {
+    entries[i++] = entry;
+  }
+
+  return entries;
+}
+
+/* Link entries into the list in the order of the array */
+static void htable_relink(hash_table *htable, struct hash_entry **entries) {
+  struct hash_entry *prev = &htable->dummy_head;
+
+  for (size_t i = 0; i < htable->num_items; ++i) {
+    prev->ht_next = entries[i];
+    entries[i]->ht_prev = prev;
+    prev = entries[i];
+  }
+
+  prev->ht_next = &htable->dummy_head;
+  htable_tail(htable) = prev;
+}
+
+/* Merge sorted `src[0, mid)` and `src[mid, n)` into `dst`.
+ * Equal entries are taken from the left run first, so sort is stable */
+static void htable_merge(struct hash_entry **src, size_t mid, size_t n,
+                         struct hash_entry **dst, ht_less_fun less) {
+  size_t i = 0, j = mid, k = 0;
+
+  while (i < mid && j < n) {
+    dst[k++] = less(src[j], src[i]) ? src[j++] : src[i++];
+  }
+  while (i < mid) {
+    dst[k++] = src[i++];
+  }
+  while (j < n) {
+    dst[k++] = src[j++];
+  }
+}
+
+/* Sort `entries` in place, `buf` is scratch space of the same size */
+static void htable_merge_sort(struct hash_entry **entries,
+                              struct hash_entry **buf, size_t n,
+                              ht_less_fun less) {
+  if (n <= SORT_INSERTION_SIZE) {
+    for (size_t i = 1; i < n; ++i) {
+      struct hash_entry *entry = entries[i];
+      size_t j = i;
+
+      for (; j > 0 && less(entry, entries[j - 1]); --j) {
+        entries[j] = entries[j - 1];
+      }
+      entries[j] = entry;
+    }
+    return;
+  }
+
+  size_t mid = n / 2;
+  htable_merge_sort(entries, buf, mid, less);
+  htable_merge_sort(entries + mid, buf + mid, n - mid, less);
+
+  if (!less(entries[mid], entries[mid - 1])) {
+    return; /* Runs are already in order */
+  }
+
+  memcpy(buf, entries, n * sizeof(*buf));
+  htable_merge(buf, mid, n, entries, less);
+}
+
+struct sort_task {
+  struct hash_entry **src;
+  struct hash_entry **dst;
+  size_t mid; /* Runs to merge are `src[0, mid)` and `src[mid, n)` */
+  size_t n;
+  ht_less_fun less;
+  bool merge; /* Merge runs into `dst` or sort `src` using `dst` as scratch */
+};
+
+static void *htable_sort_task(void *arg) {
+  struct sort_task *task = arg;
+
+  if (task->merge) {
+    htable_merge(task->src, task->mid, task->n, task->dst, task->less);
+  } else {
+    htable_merge_sort(task->src, task->dst, task->n, task->less);
+  }
+
+  return NULL;
+}
+
+/* `entries` holds `2 * n` pointers, second half is scratch space.
+ * Returns the half with sorted entries */
+static struct hash_entry **htable_parallel_sort(struct hash_entry **entries,
+                                                size_t n, size_t num_threads,
+                                                ht_less_fun less) {
+  struct sort_task tasks[MAX_THREADS];
+  size_t bounds[MAX_THREADS + 1];
+
+  size_t chunk = n / num_threads, rem = n % num_threads;
+  for (size_t i = 0; i <= num_threads; ++i) {
+    bounds[i] = chunk * i + (i < rem ? i : rem);
+  }
+
+  /* Every thread sorts its own chunk */
+  for (size_t i = 0; i < num_threads; ++i) {
+    tasks[i] = (struct sort_task){entries + bounds[i], entries + n + bounds[i],
+                                  0, bounds[i + 1] - bounds[i], less, false};
+  }
+  htable_run_tasks(htable_sort_task, tasks, sizeof(*tasks), num_threads);
+
+  /* Then neighbouring runs are merged pairwise, half of the threads
+   * are left on every round */
+  struct hash_entry **src = entries, **dst = entries + n;
+  for (size_t width = 1; width < num_threads; width *= 2) {
+    size_t num_tasks = 0;
+
+    for (size_t i = 0; i < num_threads; i += 2 * width) {
+      size_t lo = bounds[i];
+      size_t mid = bounds[i + width < num_threads ? i + width : num_threads];
+      size_t hi = bounds[i + 2 * width < num_threads ? i + 2 * width
+                                                     : num_threads];
+
+      tasks[num_tasks++] =
+        (struct sort_task){src + lo, dst + lo, mid - lo, hi - lo, less, true};
+    }
+    htable_run_tasks(htable_sort_task, tasks, sizeof(*tasks), num_tasks);
+
+    struct hash_entry **tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  return src;
+}
+
+bool htable_sort_array(hash_table *htable, ht_less_fun less,
+                       size_t num_threads) {
+  assert(htable != NULL);
+  assert(less != NULL);
+
+  size_t n = htable->num_items;
+  if (n < 2) {
+    return true;
+  }
+
+  struct hash_entry **entries = htable_entries_array(htable, n);
+  if (!entries) {
+    return false;
+  }
+
+  num_threads = htable_threads_for(n, num_threads);
+
+  if (num_threads > 1) {
+    htable_relink(htable, htable_parallel_sort(entries, n, num_threads, less));
+  } else {
+    htable_merge_sort(entries, entries + n, n, less);
+    htable_relink(htable, entries);
+  }
+
+  yu_free(entries);
+  return true;
+}
+
+struct sort_item {
+  uint64_t key;
+  struct hash_entry *entry;
+};
+
+/* LSD radix sort by bytes of the key. Every pass is stable and
+ * bytes that are equal in every key are skipped */
+bool htable_sort_by_key(hash_table *htable, ht_key_fun key) {
+  assert(htable != NULL);
+  assert(key != NULL);
+
+  size_t n = htable->num_items;
+  if (n < 2) {
+    return true;
+  }
+
+  struct sort_item *items = yu_malloc(2 * n * sizeof(*items));
+  if (!items) {
+    return false;
+  }
+
+  size_t counts[sizeof(uint64_t)][256] = {{0}};
+
+  size_t i = 0;
+  for (struct hash_entry *entry = htable_head(htable);
+       entry != &htable->dummy_head; entry = entry->ht_next, ++i) {
+    uint64_t k = key(entry);
+
+    items[i].key = k;
+    items[i].entry = entry;
+    for (size_t byte = 0; byte < sizeof(uint64_t); ++byte) {
+      counts[byte][(k >> (byte * CHAR_BIT)) & 0xFF]++;
+    }
+  }
+
+  struct sort_item *src = items, *dst = items + n;
+  for (size_t byte = 0; byte < sizeof(uint64_t); ++byte) {
+    size_t *count = counts[byte];
+    if (count[(src[0].key >> (byte * CHAR_BIT)) & 0xFF] == n) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (size_t digit = 0; digit < 256; ++digit) {
+      size_t cur = count[digit];
+      count[digit] = offset;
+      offset += cur;
+    }
+
+    for (i = 0; i < n; ++i) {
+      dst[count[(src[i].key >> (byte * CHAR_BIT)) & 0xFF]++] = src[i];
+    }
+
+    struct sort_item *tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  /* Scratch half is not needed anymore and is large enough for pointers */
+  struct hash_entry **entries = (struct hash_entry **)dst;
+  for (i = 0; i < n; ++i) {
+    entries[i] = src[i].entry;
+  }
+  htable_relink(htable, entries);
+
+  yu_free(items);
+  return true;
+}
+#endif
@@ -0,0 +1,429 @@
+#include "datastructs/hash_table_snapshot.h"
+#include "datastructs/memory.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+
+  #define SNAPSHOT_MMAP
+#endif
+
+#define SNAPSHOT_MAGIC 0x31504e5354485559ULL /* "YUHTSNP1" */
+#define SNAPSHOT_VERSION 1
+
+/* Entries start at this alignment inside of the image */
+#define SNAPSHOT_ENTRY_ALIGN 64
+
+/* Number of hash values written at once */
+#define SNAPSHOT_CHUNK 1024
+
+/*
+ * Image layout:
+ *
+ *   header
+ *   uint64_t offsets[num_buckets + 1] Index of the first entry of bucket
+ *   uint64_t hashes[num_items]        Hash value of every entry
+ *   padding up to `SNAPSHOT_ENTRY_ALIGN`
+ *   entries, `entry_size` bytes each, grouped by bucket
+ */
+struct snapshot_header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t word_size; /* `sizeof(size_t)` of the writer */
+
+  uint64_t num_items;
+  uint64_t num_buckets;
+  uint64_t entry_size;
+  uint64_t member_offset;
+  uint64_t entries_offset; /* Offset of the first entry from the image start */
+
+  uint64_t reserved;
+};
+
+struct htable_snapshot {
+  unsigned char *image; /* Mapped file or its copy in memory */
+  size_t image_size;
+
+  const uint64_t *offsets;
+  const uint64_t *hashes;
+  unsigned char *entries;
+
+  size_t num_items;
+  size_t num_buckets;
+  size_t entry_size;
+  size_t member_offset;
+
+  ht_hash_fun hash;
+  ht_equal_fun equal;
+};
+
+static bool snapshot_add_size(size_t *size, uint64_t count, uint64_t item) {
+  if (item && count > (SIZE_MAX - *size) / item) {
+    return false;
+  }
+
+  *size += count * item;
+  return true;
+}
+
+/* Compute offset of entries and total size of the image,
+ * returns false if header could not describe a valid image */
+static bool snapshot_layout(const struct snapshot_header *header,
+                            size_t *entries_offset, size_t *image_size) {
+  if (header->magic != SNAPSHOT_MAGIC ||
+      header->version != SNAPSHOT_VERSION ||
+      header->word_size != sizeof(size_t) || header->num_buckets == 0 ||
+      header->entry_size < header->member_offset + sizeof(struct hash_entry)) {
+    return false;
+  }
+
+  size_t size = sizeof(*header);
+  if (!snapshot_add_size(&size, header->num_buckets + 1, sizeof(uint64_t)) ||
+      !snapshot_add_size(&size, header->num_items, sizeof(uint64_t)) ||
+      !snapshot_add_size(&size, 1, SNAPSHOT_ENTRY_ALIGN - 1)) {
+    return false;
+  }
+  size &= ~(size_t)(SNAPSHOT_ENTRY_ALIGN - 1);
+
+  if (header->entries_offset != size) {
+    return false;
+  }
+  *entries_offset = size;
+
+  if (!snapshot_add_size(&size, header->num_items, header->entry_size)) {
+    return false;
+  }
+  *image_size = size;
+
+  return true;
+}
+
+static bool snapshot_write_hashes(FILE *file, struct hash_entry **order,
+                                  size_t num_items) {
+  uint64_t hashes[SNAPSHOT_CHUNK];
+
+  for (size_t start = 0; start < num_items; start += SNAPSHOT_CHUNK) {
+    size_t count = num_items - start < SNAPSHOT_CHUNK ? num_items - start
+                                                      : SNAPSHOT_CHUNK;
+
+    for (size_t i = 0; i < count; ++i) {
+      hashes[i] = order[start + i]->hashv;
+    }
+
+    if (fwrite(hashes, sizeof(*hashes), count, file) != count) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool snapshot_write_entries(FILE *file, struct hash_entry **order,
+                                   size_t num_items, size_t entry_size,
+                                   size_t member_offset) {
+  unsigned char *copy = yu_malloc(entry_size);
+  if (!copy) {
+    return false;
+  }
+
+  bool ok = true;
+  for (size_t i = 0; ok && i < num_items; ++i) {
+    memcpy(copy, (unsigned char *)order[i] - member_offset, entry_size);
+
+    /* Links are meaningless inside of the image */
+    struct hash_entry *entry = (struct hash_entry *)(copy + member_offset);
+#ifndef YU_HTABLE_COMPACT
+    entry->ht_next = entry->ht_prev = NULL;
+#endif
+    entry->next = NULL;
+
+    ok = fwrite(copy, entry_size, 1, file) == 1;
+  }
+
+  yu_free(copy);
+  return ok;
+}
+
+/* Group entries by bucket with counting sort. On return `offsets[i]`
+ * is the index of the first entry of bucket `i` inside of `order` */
+static void snapshot_order(hash_table *htable, uint64_t *offsets,
+                           size_t num_buckets, struct hash_entry **order) {
+  struct hash_entry *entry;
+
+  for (entry = htable_first(htable); entry;
+       entry = htable_next_in(htable, entry)) {
+    offsets[entry->hashv % num_buckets + 1]++;
+  }
+  for (size_t i = 1; i <= num_buckets; ++i) {
+    offsets[i] += offsets[i - 1];
+  }
+
+  for (entry = htable_first(htable); entry;
+       entry = htable_next_in(htable, entry)) {
+    order[offsets[entry->hashv % num_buckets]++] = entry;
+  }
+
+  /* Every offset now points to the start of the next bucket */
+  for (size_t i = num_buckets; i > 0; --i) {
+    offsets[i] = offsets[i - 1];
+  }
+  offsets[0] = 0;
+}
+
+bool htable_snapshot_save(hash_table *htable, const char *path,
+                          size_t entry_size, size_t member_offset) {
+  assert(htable != NULL);
+  assert(path != NULL);
+  assert(entry_size >= member_offset + sizeof(struct hash_entry));
+
+  struct snapshot_header header = {0};
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.word_size = sizeof(size_t);
+  header.num_items = htable_size(htable);
+  /* One bucket per entry on average, chains are short and contiguous */
+  header.num_buckets = header.num_items ? header.num_items : 1;
+  header.entry_size = entry_size;
+  header.member_offset = member_offset;
+
+  size_t num_items = header.num_items;
+  size_t num_buckets = header.num_buckets;
+  size_t entries_offset, image_size;
+
+  header.entries_offset = sizeof(header) +
+                          (num_buckets + 1 + num_items) * sizeof(uint64_t) +
+                          SNAPSHOT_ENTRY_ALIGN - 1;
+  header.entries_offset &= ~(uint64_t)(SNAPSHOT_ENTRY_ALIGN - 1);
+  if (!snapshot_layout(&header, &entries_offset, &image_size)) {
+    return false;
+  }
+
+  /* Number of buckets is never zero, unlike number of items */
+  uint64_t *offsets = yu_calloc(num_buckets + 1, sizeof(*offsets));
+  struct hash_entry **order = yu_calloc(num_buckets, sizeof(*order));
+  FILE *file = NULL;
+  bool ok = false;
+
+  if (!offsets || !order || !(file = fopen(path, "wb"))) {
+    goto out;
+  }
+
+  snapshot_order(htable, offsets, num_buckets, order);
+
+  static const unsigned char padding[SNAPSHOT_ENTRY_ALIGN] = {0};
+  size_t padding_size = entries_offset - sizeof(header) -
+                        (num_buckets + 1 + num_items) * sizeof(uint64_t);
+
+  ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+       fwrite(offsets, sizeof(*offsets), num_buckets + 1, file) ==
+         num_buckets + 1 &&
+       snapshot_write_hashes(file, order, num_items) &&
+       fwrite(padding, 1, padding_size, file) == padding_size &&
+       snapshot_write_entries(file, order, num_items, entry_size,
+                              member_offset);
+
+out:
+  if (file && fclose(file) != 0) {
+    ok = false;
+  }
+  if (file && !ok) {
+    remove(path);
+  }
+
+  if (order) {
+    yu_free(order);
+  }
+  if (offsets) {
+    yu_free(offsets);
+  }
+  return ok;
+}
+
+#ifdef SNAPSHOT_MMAP
+static bool snapshot_load(htable_snapshot *snapshot, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      (size_t)st.st_size < sizeof(struct snapshot_header)) {
+    close(fd);
+    return false;
+  }
+
+  void *image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (image == MAP_FAILED) {
+    return false;
+  }
+
+  snapshot->image = image;
+  snapshot->image_size = st.st_size;
+
+  return true;
+}
+
+static void snapshot_unload(htable_snapshot *snapshot) {
+  if (snapshot->image) {
+    munmap(snapshot->image, snapshot->image_size);
+  }
+}
+#else
+/* Read the whole image into memory, used where mapping is unavailable */
+static bool snapshot_read(htable_snapshot *snapshot, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+
+  struct snapshot_header header;
+  size_t entries_offset, image_size;
+
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      !snapshot_layout(&header, &entries_offset, &image_size) ||
+      !(snapshot->image = yu_malloc(image_size))) {
+    fclose(file);
+    return false;
+  }
+
+  size_t rest = image_size - sizeof(header);
+  memcpy(snapshot->image, &header, sizeof(header));
+
+  bool ok = fread(snapshot->image + sizeof(header), 1, rest, file) == rest;
+  fclose(file);
+
+  snapshot->image_size = image_size;
+
+  return ok;
+}
+
+static void snapshot_unload(htable_snapshot *snapshot) {
+  if (snapshot->image) {
+    yu_free(snapshot->image);
+  }
+}
+#endif
+
+htable_snapshot *htable_snapshot_open(const char *path, ht_hash_fun hash,
+                                      ht_equal_fun equal) {
+  assert(path != NULL);
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  htable_snapshot *snapshot = yu_malloc(sizeof(*snapshot));
+  if (!snapshot) {
+    return NULL;
+  }
+
+  snapshot->image = NULL;
+
+#ifdef SNAPSHOT_MMAP
+  bool loaded = snapshot_load(snapshot, path);
+#else
+  bool loaded = snapshot_read(snapshot, path);
+#endif
+
+  struct snapshot_header header;
+  size_t entries_offset, image_size;
+
+  if (loaded) {
+    memcpy(&header, snapshot->image, sizeof(header));
+    loaded = snapshot_layout(&header, &entries_offset, &image_size) &&
+             image_size == snapshot->image_size;
+  }
+
+  if (!loaded) {
+    snapshot_unload(snapshot);
+    yu_free(snapshot);
+    return NULL;
+  }
+
+  snapshot->offsets = (const uint64_t *)(snapshot->image + sizeof(header));
+  snapshot->hashes = snapshot->offsets + header.num_buckets + 1;
+  snapshot->entries = snapshot->image + entries_offset;
+
+  snapshot->num_items = header.num_items;
+  snapshot->num_buckets = header.num_buckets;
+  snapshot->entry_size = header.entry_size;
+  snapshot->member_offset = header.member_offset;
+
+  snapshot->hash = hash;
+  snapshot->equal = equal;
+
+  /* Only the ends are checked here to keep opening free of per-entry work,
+   * offsets in between are bounded by lookup */
+  if (snapshot->offsets[0] != 0 ||
+      snapshot->offsets[snapshot->num_buckets] != snapshot->num_items) {
+    htable_snapshot_close(snapshot);
+    return NULL;
+  }
+
+  return snapshot;
+}
+
+void htable_snapshot_close(htable_snapshot *snapshot) {
+  if (!snapshot) {
+    return;
+  }
+
+  snapshot_unload(snapshot);
+  yu_free(snapshot);
+}
+
+static inline struct hash_entry *snapshot_entry(htable_snapshot *snapshot,
+                                                size_t idx) {
+  return (struct hash_entry *)(snapshot->entries + idx * snapshot->entry_size +
+                               snapshot->member_offset);
+}
+
+struct hash_entry *htable_snapshot_lookup(htable_snapshot *snapshot,
+                                          struct hash_entry *query) {
+  assert(snapshot != NULL);
+  assert(query != NULL);
+
+  query->hashv = snapshot->hash(query);
+
+  /* Corrupt offsets must not lead out of the image. Bucket with start past
+   * its end is empty */
+  size_t bucket = query->hashv % snapshot->num_buckets;
+  size_t end = snapshot->offsets[bucket + 1];
+  if (end > snapshot->num_items) {
+    end = snapshot->num_items;
+  }
+
+  for (size_t i = snapshot->offsets[bucket]; i < end; ++i) {
+    if (snapshot->hashes[i] != query->hashv) {
+      continue;
+    }
+
+    struct hash_entry *entry = snapshot_entry(snapshot, i);
+    if (snapshot->equal(entry, query)) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+size_t htable_snapshot_size(htable_snapshot *snapshot) {
+  assert(snapshot != NULL);
+  return snapshot->num_items;
+}
+
+struct hash_entry *htable_snapshot_at(htable_snapshot *snapshot, size_t idx) {
+  assert(snapshot != NULL);
+  assert(idx < snapshot->num_items);
+
+  return snapshot_entry(snapshot, idx);
+}
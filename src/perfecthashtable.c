@@ -0,0 +1,750 @@
+#include "datastructs/perfect_hash_table.h"
+#include "datastructs/memory.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+
+  #define PHT_MMAP
+#endif
+
+#define PHT_MAGIC 0x3154485054485559ULL /* "YUHTPHT1" */
+#define PHT_VERSION 1
+
+/* Average number of keys per bucket, 16-bit pilots take 16 / 6 bits
+ * per key */
+#define PHT_BUCKET_SIZE 6
+/* Keys are spread over 1% more positions than there are keys, so that
+ * the last buckets still find free ones. Positions past the last key
+ * are remapped to the free positions below it */
+#define PHT_EXTRA_DIVISOR 100
+/* 60% of keys go to 30% of buckets. Large buckets are placed first,
+ * while the table is still empty, and small ones fill the gaps */
+#define PHT_DENSE_KEYS 0x99999999ULL /* 0.6 * 2^32 */
+#define PHT_DENSE_BUCKETS_PERCENT 30
+
+/* Building gives up after trying this number of seeds */
+#define PHT_MAX_ATTEMPTS 8
+#define PHT_SEED 0x9E3779B97F4A7C15ULL
+#define PHT_POSITION_SALT 0xC2B2AE3D27D4EB4FULL
+
+/* Entries start at this alignment inside of the image */
+#define PHT_ENTRY_ALIGN 64
+
+/*
+ * Image layout:
+ *
+ *   header
+ *   uint16_t pilots[num_buckets]
+ *   padding up to 8 bytes
+ *   uint32_t remap[table_size - num_items]
+ *   padding up to `PHT_ENTRY_ALIGN`
+ *   entries, `entry_size` bytes each, by position
+ */
+struct pht_header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t word_size; /* `sizeof(size_t)` of the writer */
+
+  uint64_t num_items;
+  uint64_t num_buckets;
+  uint64_t num_dense_buckets;
+  uint64_t table_size;
+  uint64_t seed;
+
+  uint64_t entry_size;
+  uint64_t member_offset;
+  uint64_t remap_offset;   /* Offset of `remap` from the image start */
+  uint64_t entries_offset; /* Offset of the first entry from the image start */
+};
+
+struct perfect_htable {
+  unsigned char *image; /* Mapped file of opened table, `NULL` if built */
+  size_t image_size;
+
+  const uint16_t *pilots; /* Pilot of every bucket */
+  const uint32_t *remap;  /* Free positions for positions past the last key */
+
+  struct hash_entry **slots; /* Entries of built table by position */
+  unsigned char *entries;    /* Entries of opened table by position */
+  size_t entry_size;
+  size_t member_offset;
+
+  size_t num_items;
+  size_t num_buckets;
+  size_t num_dense_buckets;
+  size_t table_size; /* Number of positions, greater than `num_items` */
+  uint64_t seed;
+
+  ht_hash_fun hash;
+  ht_equal_fun equal;
+};
+
+/* Another seed does not help on failure: either entries have equal hash
+ * values or memory ran out */
+enum pht_result { PHT_PLACED, PHT_RETRY, PHT_FAILED };
+
+/* Finalizer of splitmix64, spreads every input bit over the output */
+static inline uint64_t pht_mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+static inline uint64_t pht_key(const perfect_htable *table, size_t hashv) {
+  return pht_mix((uint64_t)hashv ^ table->seed);
+}
+
+static inline size_t pht_bucket(const perfect_htable *table, uint64_t key) {
+  if ((key >> 32) < PHT_DENSE_KEYS) {
+    return key % table->num_dense_buckets;
+  }
+
+  return table->num_dense_buckets +
+         key % (table->num_buckets - table->num_dense_buckets);
+}
+
+static inline uint64_t pht_displaced(uint64_t key) {
+  return pht_mix(key ^ PHT_POSITION_SALT);
+}
+
+static inline uint64_t pht_pilot_mix(const perfect_htable *table,
+                                     uint16_t pilot) {
+  return pht_mix(pilot + table->seed);
+}
+
+static inline struct hash_entry *pht_entry(const perfect_htable *table,
+                                           size_t pos) {
+  if (table->slots) {
+    return table->slots[pos];
+  }
+
+  return (struct hash_entry *)(table->entries + pos * table->entry_size +
+                               table->member_offset);
+}
+
+static void pht_set_sizes(perfect_htable *table, size_t num_items) {
+  table->num_items = num_items;
+  table->num_buckets = num_items / PHT_BUCKET_SIZE + 2;
+  table->num_dense_buckets =
+    table->num_buckets * PHT_DENSE_BUCKETS_PERCENT / 100;
+  if (table->num_dense_buckets == 0) {
+    table->num_dense_buckets = 1;
+  }
+  table->table_size = num_items + num_items / PHT_EXTRA_DIVISOR + 1;
+}
+
+/* Scratch memory of a build */
+struct pht_build {
+  struct hash_entry **entries;
+  uint16_t *pilots;
+  size_t *positions; /* Bucket, then position of every entry */
+
+  uint64_t *displaced;  /* Displaced hash value of every entry */
+  size_t *bucket_start; /* First member of every bucket */
+  size_t *members;      /* Entries grouped by bucket */
+  size_t *order;        /* Buckets from the largest to the smallest */
+  uint64_t *taken;      /* Bitmap of taken positions */
+};
+
+static inline bool pht_taken(const uint64_t *taken, size_t pos) {
+  return (taken[pos / 64] >> (pos % 64)) & 1;
+}
+
+/* Group entries by bucket and order buckets by size, largest first */
+static bool pht_group(perfect_htable *table, struct pht_build *build) {
+  size_t num_items = table->num_items;
+  size_t num_buckets = table->num_buckets;
+  size_t *bucket_start = build->bucket_start;
+
+  memset(bucket_start, 0, (num_buckets + 1) * sizeof(*bucket_start));
+  for (size_t i = 0; i < num_items; ++i) {
+    uint64_t key = pht_key(table, build->entries[i]->hashv);
+
+    build->displaced[i] = pht_displaced(key);
+    build->positions[i] = pht_bucket(table, key);
+    bucket_start[build->positions[i] + 1]++;
+  }
+
+  size_t max_size = 0;
+  for (size_t b = 0; b < num_buckets; ++b) {
+    if (bucket_start[b + 1] > max_size) {
+      max_size = bucket_start[b + 1];
+    }
+    bucket_start[b + 1] += bucket_start[b];
+  }
+
+  for (size_t i = 0; i < num_items; ++i) {
+    build->members[bucket_start[build->positions[i]]++] = i;
+  }
+  /* Every start now points to the start of the next bucket */
+  for (size_t b = num_buckets; b > 0; --b) {
+    bucket_start[b] = bucket_start[b - 1];
+  }
+  bucket_start[0] = 0;
+
+  /* Counting sort of buckets by size, descending */
+  size_t *size_start = yu_calloc(max_size + 2, sizeof(*size_start));
+  if (!size_start) {
+    return false;
+  }
+
+  for (size_t b = 0; b < num_buckets; ++b) {
+    size_t size = bucket_start[b + 1] - bucket_start[b];
+    size_start[max_size - size + 1]++;
+  }
+  for (size_t s = 1; s <= max_size + 1; ++s) {
+    size_start[s] += size_start[s - 1];
+  }
+  for (size_t b = 0; b < num_buckets; ++b) {
+    size_t size = bucket_start[b + 1] - bucket_start[b];
+    build->order[size_start[max_size - size]++] = b;
+  }
+
+  yu_free(size_start);
+  return true;
+}
+
+/* Find pilot that moves every member of the bucket to a free position */
+static enum pht_result pht_place_bucket(perfect_htable *table,
+                                        struct pht_build *build,
+                                        size_t bucket) {
+  const size_t *members = &build->members[build->bucket_start[bucket]];
+  size_t size = build->bucket_start[bucket + 1] - build->bucket_start[bucket];
+
+  /* Equal hash values collide under every pilot */
+  for (size_t i = 0; i < size; ++i) {
+    for (size_t j = i + 1; j < size; ++j) {
+      if (build->displaced[members[i]] == build->displaced[members[j]]) {
+        return PHT_FAILED;
+      }
+    }
+  }
+
+  for (uint32_t pilot = 0; pilot <= UINT16_MAX; ++pilot) {
+    uint64_t mixed = pht_pilot_mix(table, (uint16_t)pilot);
+    size_t placed = 0;
+
+    for (; placed < size; ++placed) {
+      size_t pos = (build->displaced[members[placed]] ^ mixed) %
+                   table->table_size;
+      if (pht_taken(build->taken, pos)) {
+        break;
+      }
+
+      build->taken[pos / 64] |= (uint64_t)1 << (pos % 64);
+      build->positions[members[placed]] = pos;
+    }
+
+    if (placed == size) {
+      build->pilots[bucket] = (uint16_t)pilot;
+      return PHT_PLACED;
+    }
+
+    /* Release positions taken by this pilot */
+    while (placed--) {
+      size_t pos = build->positions[members[placed]];
+      build->taken[pos / 64] &= ~((uint64_t)1 << (pos % 64));
+    }
+  }
+
+  return PHT_RETRY;
+}
+
+static enum pht_result pht_place(perfect_htable *table,
+                                 struct pht_build *build) {
+  if (!pht_group(table, build)) {
+    return PHT_FAILED;
+  }
+
+  memset(build->taken, 0,
+         (table->table_size + 63) / 64 * sizeof(*build->taken));
+
+  for (size_t i = 0; i < table->num_buckets; ++i) {
+    enum pht_result result = pht_place_bucket(table, build, build->order[i]);
+    if (result != PHT_PLACED) {
+      return result;
+    }
+  }
+
+  return PHT_PLACED;
+}
+
+/* Move entries placed past the last key to free positions below it */
+static void pht_remap(perfect_htable *table, struct pht_build *build,
+                      uint32_t *remap) {
+  size_t free_pos = 0;
+
+  for (size_t i = 0; i < table->num_items; ++i) {
+    size_t pos = build->positions[i];
+
+    if (pos >= table->num_items) {
+      while (pht_taken(build->taken, free_pos)) {
+        free_pos++;
+      }
+
+      remap[pos - table->num_items] = (uint32_t)free_pos;
+      pos = free_pos++;
+    }
+
+    table->slots[pos] = build->entries[i];
+  }
+}
+
+static void pht_free_build(struct pht_build *build) {
+  if (build->displaced) {
+    yu_free(build->displaced);
+  }
+  if (build->bucket_start) {
+    yu_free(build->bucket_start);
+  }
+  if (build->members) {
+    yu_free(build->members);
+  }
+  if (build->order) {
+    yu_free(build->order);
+  }
+  if (build->taken) {
+    yu_free(build->taken);
+  }
+  if (build->positions) {
+    yu_free(build->positions);
+  }
+}
+
+/* Entries must have their hash values */
+static perfect_htable *pht_build(struct hash_entry **entries,
+                                 size_t num_items, ht_hash_fun hash,
+                                 ht_equal_fun equal) {
+  if (num_items > UINT32_MAX) {
+    return NULL;
+  }
+
+  perfect_htable *table = yu_calloc(1, sizeof(*table));
+  if (!table) {
+    return NULL;
+  }
+
+  table->hash = hash;
+  table->equal = equal;
+  pht_set_sizes(table, num_items);
+
+  size_t num_remapped = table->table_size - num_items;
+  uint16_t *pilots = yu_calloc(table->num_buckets, sizeof(*pilots));
+  uint32_t *remap = yu_calloc(num_remapped, sizeof(*remap));
+  /* Number of slots could be zero, unlike number of positions */
+  table->slots = yu_calloc(num_items + 1, sizeof(*table->slots));
+
+  struct pht_build build = {0};
+  build.entries = entries;
+  build.pilots = pilots;
+  build.positions = yu_malloc((num_items + 1) * sizeof(*build.positions));
+  build.displaced = yu_malloc((num_items + 1) * sizeof(*build.displaced));
+  build.bucket_start =
+    yu_malloc((table->num_buckets + 1) * sizeof(*build.bucket_start));
+  build.members = yu_malloc((num_items + 1) * sizeof(*build.members));
+  build.order = yu_malloc(table->num_buckets * sizeof(*build.order));
+  build.taken =
+    yu_malloc((table->table_size + 63) / 64 * sizeof(*build.taken));
+
+  enum pht_result result = PHT_FAILED;
+  if (pilots && remap && table->slots && build.positions && build.displaced &&
+      build.bucket_start && build.members && build.order && build.taken) {
+    for (size_t attempt = 0; attempt < PHT_MAX_ATTEMPTS; ++attempt) {
+      table->seed = pht_mix(PHT_SEED + attempt);
+
+      result = pht_place(table, &build);
+      if (result != PHT_RETRY) {
+        break;
+      }
+    }
+  }
+
+  if (result == PHT_PLACED) {
+    pht_remap(table, &build, remap);
+  }
+  pht_free_build(&build);
+
+  table->pilots = pilots;
+  table->remap = remap;
+
+  if (result != PHT_PLACED) {
+    phtable_destroy(table);
+    return NULL;
+  }
+
+  return table;
+}
+
+perfect_htable *phtable_build(hash_table *htable, ht_hash_fun hash,
+                              ht_equal_fun equal) {
+  assert(htable != NULL);
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  size_t num_items = htable_size(htable);
+  struct hash_entry **entries =
+    yu_malloc((num_items + 1) * sizeof(*entries));
+  if (!entries) {
+    return NULL;
+  }
+
+  size_t i = 0;
+  for (struct hash_entry *entry = htable_first(htable); entry;
+       entry = htable_next_in(htable, entry)) {
+    entries[i++] = entry;
+  }
+
+  perfect_htable *table = pht_build(entries, num_items, hash, equal);
+
+  yu_free(entries);
+  return table;
+}
+
+perfect_htable *phtable_build_array(struct hash_entry **entries,
+                                    size_t num_items, ht_hash_fun hash,
+                                    ht_equal_fun equal) {
+  assert(entries != NULL || num_items == 0);
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  for (size_t i = 0; i < num_items; ++i) {
+    entries[i]->hashv = hash(entries[i]);
+  }
+
+  return pht_build(entries, num_items, hash, equal);
+}
+
+static bool pht_add_size(size_t *size, uint64_t count, uint64_t item) {
+  if (item && count > (SIZE_MAX - *size) / item) {
+    return false;
+  }
+
+  *size += count * item;
+  return true;
+}
+
+static bool pht_align(size_t *size, size_t align) {
+  if (!pht_add_size(size, 1, align - 1)) {
+    return false;
+  }
+
+  *size &= ~(align - 1);
+  return true;
+}
+
+/* Compute offsets and total size of the image,
+ * returns false if header could not describe a valid image */
+static bool pht_layout(const struct pht_header *header, size_t *image_size) {
+  if (header->magic != PHT_MAGIC || header->version != PHT_VERSION ||
+      header->word_size != sizeof(size_t) ||
+      header->num_items > UINT32_MAX ||
+      header->table_size <= header->num_items ||
+      header->num_buckets < 2 || header->num_dense_buckets == 0 ||
+      header->num_dense_buckets >= header->num_buckets ||
+      header->entry_size < header->member_offset + sizeof(struct hash_entry)) {
+    return false;
+  }
+
+  size_t size = sizeof(*header);
+  if (!pht_add_size(&size, header->num_buckets, sizeof(uint16_t)) ||
+      !pht_align(&size, sizeof(uint64_t)) || header->remap_offset != size ||
+      !pht_add_size(&size, header->table_size - header->num_items,
+                    sizeof(uint32_t)) ||
+      !pht_align(&size, PHT_ENTRY_ALIGN) || header->entries_offset != size ||
+      !pht_add_size(&size, header->num_items, header->entry_size)) {
+    return false;
+  }
+  *image_size = size;
+
+  return true;
+}
+
+static bool pht_write_padding(FILE *file, size_t size) {
+  static const unsigned char padding[PHT_ENTRY_ALIGN] = {0};
+  return fwrite(padding, 1, size, file) == size;
+}
+
+static bool pht_write_entries(perfect_htable *table, FILE *file,
+                              size_t entry_size, size_t member_offset) {
+  unsigned char *copy = yu_malloc(entry_size);
+  if (!copy) {
+    return false;
+  }
+
+  bool ok = true;
+  for (size_t i = 0; ok && i < table->num_items; ++i) {
+    memcpy(copy, (unsigned char *)pht_entry(table, i) - member_offset,
+           entry_size);
+
+    /* Links are meaningless inside of the image */
+    struct hash_entry *entry = (struct hash_entry *)(copy + member_offset);
+#ifndef YU_HTABLE_COMPACT
+    entry->ht_next = entry->ht_prev = NULL;
+#endif
+    entry->next = NULL;
+
+    ok = fwrite(copy, entry_size, 1, file) == 1;
+  }
+
+  yu_free(copy);
+  return ok;
+}
+
+bool phtable_save(perfect_htable *table, const char *path, size_t entry_size,
+                  size_t member_offset) {
+  assert(table != NULL);
+  assert(path != NULL);
+  assert(entry_size >= member_offset + sizeof(struct hash_entry));
+
+  struct pht_header header = {0};
+  header.magic = PHT_MAGIC;
+  header.version = PHT_VERSION;
+  header.word_size = sizeof(size_t);
+  header.num_items = table->num_items;
+  header.num_buckets = table->num_buckets;
+  header.num_dense_buckets = table->num_dense_buckets;
+  header.table_size = table->table_size;
+  header.seed = table->seed;
+  header.entry_size = entry_size;
+  header.member_offset = member_offset;
+
+  size_t num_remapped = table->table_size - table->num_items;
+  size_t pilots_end = sizeof(header) + table->num_buckets * sizeof(uint16_t);
+  size_t remap_offset = pilots_end;
+  pht_align(&remap_offset, sizeof(uint64_t));
+  size_t remap_end = remap_offset + num_remapped * sizeof(uint32_t);
+  size_t entries_offset = remap_end;
+  pht_align(&entries_offset, PHT_ENTRY_ALIGN);
+
+  header.remap_offset = remap_offset;
+  header.entries_offset = entries_offset;
+
+  size_t image_size;
+  if (!pht_layout(&header, &image_size)) {
+    return false;
+  }
+
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+
+  bool ok =
+    fwrite(&header, sizeof(header), 1, file) == 1 &&
+    fwrite(table->pilots, sizeof(uint16_t), table->num_buckets, file) ==
+      table->num_buckets &&
+    pht_write_padding(file, remap_offset - pilots_end) &&
+    fwrite(table->remap, sizeof(uint32_t), num_remapped, file) ==
+      num_remapped &&
+    pht_write_padding(file, entries_offset - remap_end) &&
+    pht_write_entries(table, file, entry_size, member_offset);
+
+  if (fclose(file) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    remove(path);
+  }
+
+  return ok;
+}
+
+#ifdef PHT_MMAP
+static bool pht_load(perfect_htable *table, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct pht_header)) {
+    close(fd);
+    return false;
+  }
+
+  void *image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (image == MAP_FAILED) {
+    return false;
+  }
+
+  table->image = image;
+  table->image_size = st.st_size;
+
+  return true;
+}
+
+static void pht_unload(perfect_htable *table) {
+  if (table->image) {
+    munmap(table->image, table->image_size);
+  }
+}
+#else
+/* Read the whole image into memory, used where mapping is unavailable */
+static bool pht_load(perfect_htable *table, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+
+  struct pht_header header;
+  size_t image_size;
+
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      !pht_layout(&header, &image_size) ||
+      !(table->image = yu_malloc(image_size))) {
+    fclose(file);
+    return false;
+  }
+
+  size_t rest = image_size - sizeof(header);
+  memcpy(table->image, &header, sizeof(header));
+
+  bool ok = fread(table->image + sizeof(header), 1, rest, file) == rest;
+  fclose(file);
+
+  table->image_size = image_size;
+
+  return ok;
+}
+
+static void pht_unload(perfect_htable *table) {
+  if (table->image) {
+    yu_free(table->image);
+  }
+}
+#endif
+
+perfect_htable *phtable_open(const char *path, ht_hash_fun hash,
+                             ht_equal_fun equal) {
+  assert(path != NULL);
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  perfect_htable *table = yu_calloc(1, sizeof(*table));
+  if (!table) {
+    return NULL;
+  }
+
+  struct pht_header header;
+  size_t image_size;
+
+  bool loaded = pht_load(table, path);
+  if (loaded) {
+    memcpy(&header, table->image, sizeof(header));
+    loaded = pht_layout(&header, &image_size) &&
+             image_size == table->image_size;
+  }
+
+  if (!loaded) {
+    pht_unload(table);
+    yu_free(table);
+    return NULL;
+  }
+
+  table->pilots = (const uint16_t *)(table->image + sizeof(header));
+  table->remap = (const uint32_t *)(table->image + header.remap_offset);
+  table->entries = table->image + header.entries_offset;
+  table->entry_size = header.entry_size;
+  table->member_offset = header.member_offset;
+
+  table->num_items = header.num_items;
+  table->num_buckets = header.num_buckets;
+  table->num_dense_buckets = header.num_dense_buckets;
+  table->table_size = header.table_size;
+  table->seed = header.seed;
+
+  table->hash = hash;
+  table->equal = equal;
+
+  /* Remapped positions are the only ones not bounded by construction */
+  size_t num_remapped = table->table_size - table->num_items;
+  for (size_t i = 0; table->num_items && i < num_remapped; ++i) {
+    if (table->remap[i] >= table->num_items) {
+      phtable_destroy(table);
+      return NULL;
+    }
+  }
+
+  return table;
+}
+
+void phtable_destroy(perfect_htable *table) {
+  if (!table) {
+    return;
+  }
+
+  if (table->image) {
+    pht_unload(table);
+  } else {
+    if (table->pilots) {
+      yu_free((void *)table->pilots);
+    }
+    if (table->remap) {
+      yu_free((void *)table->remap);
+    }
+    if (table->slots) {
+      yu_free(table->slots);
+    }
+  }
+
+  yu_free(table);
+}
+
+struct hash_entry *phtable_lookup(perfect_htable *table,
+                                  struct hash_entry *query) {
+  assert(table != NULL);
+  assert(query != NULL);
+
+  query->hashv = table->hash(query);
+  if (table->num_items == 0) {
+    return NULL;
+  }
+
+  uint64_t key = pht_key(table, query->hashv);
+  uint16_t pilot = table->pilots[pht_bucket(table, key)];
+  size_t pos =
+    (pht_displaced(key) ^ pht_pilot_mix(table, pilot)) % table->table_size;
+
+  if (pos >= table->num_items) {
+    pos = table->remap[pos - table->num_items];
+  }
+
+  struct hash_entry *entry = pht_entry(table, pos);
+  if (entry->hashv == query->hashv && table->equal(entry, query)) {
+    return entry;
+  }
+
+  return NULL;
+}
+
+size_t phtable_size(perfect_htable *table) {
+  assert(table != NULL);
+  return table->num_items;
+}
+
+size_t phtable_index_size(perfect_htable *table) {
+  assert(table != NULL);
+  return table->num_buckets * sizeof(uint16_t) +
+         (table->table_size - table->num_items) * sizeof(uint32_t);
+}
+
+struct hash_entry *phtable_at(perfect_htable *table, size_t idx) {
+  assert(table != NULL);
+  assert(idx < table->num_items);
+
+  return pht_entry(table, idx);
+}
@@ -0,0 +1,468 @@
+#include "datastructs/rcu_hash_table.h"
+#include "datastructs/memory.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+/* Should be arranged from 0.5 to 0.8 */
+#define IDEAL_LOAD_FACTOR 0.7
+
+/* Entries retired in epoch `e` are freed once global epoch reaches `e + 2`,
+ * so only three lists of retired entries are alive at the same time */
+#define NUM_EPOCHS 3
+
+#define load_acquire(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define load_relaxed(ptr) __atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define store_release(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#define store_relaxed(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELAXED)
+
+struct rcu_buckets {
+  struct rcu_buckets *retired_next; /* Next retired bucket array */
+  size_t num_buckets;
+
+  struct hash_bucket buckets[];
+};
+
+struct rcu_reader {
+  /* Epoch observed when critical section was entered, 0 outside of it */
+  size_t epoch;
+
+  struct rcu_reader *next;
+  rcu_hash_table *htable;
+};
+
+struct rcu_hash_table {
+  struct rcu_buckets *table; /* Published with release store */
+
+  /* Odd while rehash relinks entries. Lookup that missed
+   * has to be retried if sequence has changed */
+  size_t seq;
+
+  size_t epoch; /* Global epoch, starts from 1 */
+
+  /* Everything below is protected by `write_lock` */
+  pthread_mutex_t write_lock;
+
+  struct rcu_reader *readers; /* Registered readers */
+
+  /* Entries are chained through `ht_next` once they are retired */
+  struct hash_entry *retired[NUM_EPOCHS];
+  struct rcu_buckets *retired_tables[NUM_EPOCHS];
+
+  ht_hash_fun hash;
+  ht_equal_fun equal;
+  rcu_free_fun free_entry;
+
+  /* Number of items in the hash table should not be
+   * greater than this value */
+  size_t ideal_num_items;
+
+  size_t num_items; /* Number of items in the table */
+};
+
+static struct rcu_buckets *rcu_buckets_create(size_t num_buckets) {
+  struct rcu_buckets *table =
+    yu_calloc(1, sizeof(*table) + num_buckets * sizeof(table->buckets[0]));
+
+  if (table) {
+    table->num_buckets = num_buckets;
+  }
+  return table;
+}
+
+static void rcu_free_retired(rcu_hash_table *htable, size_t slot) {
+  struct hash_entry *entry = htable->retired[slot];
+  while (entry) {
+    struct hash_entry *next = entry->ht_next;
+    htable->free_entry(entry);
+    entry = next;
+  }
+  htable->retired[slot] = NULL;
+
+  struct rcu_buckets *table = htable->retired_tables[slot];
+  while (table) {
+    struct rcu_buckets *next = table->retired_next;
+    yu_free(table);
+    table = next;
+  }
+  htable->retired_tables[slot] = NULL;
+}
+
+/* Advances global epoch if every active reader has observed it.
+ * Must be called with `write_lock` held */
+static bool rcu_try_advance(rcu_hash_table *htable) {
+  size_t epoch = load_relaxed(&htable->epoch);
+
+  for (struct rcu_reader *reader = htable->readers; reader;
+       reader = reader->next) {
+    size_t reader_epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+    if (reader_epoch && reader_epoch != epoch) {
+      return false;
+    }
+  }
+
+  __atomic_store_n(&htable->epoch, epoch + 1, __ATOMIC_SEQ_CST);
+
+  /* Nobody could see entries retired two epochs ago */
+  rcu_free_retired(htable, (epoch + 2) % NUM_EPOCHS);
+  return true;
+}
+
+static void rcu_retire(rcu_hash_table *htable, struct hash_entry *entry) {
+  size_t slot = load_relaxed(&htable->epoch) % NUM_EPOCHS;
+
+  entry->ht_next = htable->retired[slot];
+  htable->retired[slot] = entry;
+
+  rcu_try_advance(htable);
+}
+
+static struct hash_entry **rcu_lookup_in_bucket(rcu_hash_table *htable,
+                                                struct hash_bucket *bucket,
+                                                struct hash_entry *query) {
+  struct hash_entry **link = &bucket->entry;
+
+  while (*link) {
+    struct hash_entry *entry = *link;
+    if (entry->hashv == query->hashv && htable->equal(entry, query)) {
+      break;
+    }
+
+    link = &entry->next;
+  }
+
+  return link;
+}
+
+static inline struct hash_bucket *rcu_bucket(struct rcu_buckets *table,
+                                             size_t hashv) {
+  return &table->buckets[hashv % table->num_buckets];
+}
+
+/* Must be called with `write_lock` held */
+static bool rcu_resize(rcu_hash_table *htable, size_t new_num_buckets) {
+  struct rcu_buckets *ntable = rcu_buckets_create(new_num_buckets);
+  if (!ntable) {
+    return false;
+  }
+
+  struct rcu_buckets *table = htable->table;
+  size_t seq = htable->seq;
+
+  /* Readers that walk relinked chains could miss entries,
+   * they will retry because sequence is odd */
+  store_relaxed(&htable->seq, seq + 1);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  for (size_t i = 0; i < table->num_buckets; ++i) {
+    struct hash_entry *entry = table->buckets[i].entry;
+
+    while (entry) {
+      struct hash_entry *next = entry->next;
+      struct hash_bucket *bucket = rcu_bucket(ntable, entry->hashv);
+
+      /* Moved entries point only to entries moved before them,
+       * so concurrent readers always reach the end of a chain */
+      store_release(&entry->next, bucket->entry);
+      bucket->entry = entry;
+
+      entry = next;
+    }
+  }
+
+  store_release(&htable->table, ntable);
+  store_release(&htable->seq, seq + 2);
+
+  htable->ideal_num_items = new_num_buckets * IDEAL_LOAD_FACTOR + 1;
+
+  size_t slot = load_relaxed(&htable->epoch) % NUM_EPOCHS;
+  table->retired_next = htable->retired_tables[slot];
+  htable->retired_tables[slot] = table;
+
+  rcu_try_advance(htable);
+  return true;
+}
+
+static inline bool rcu_expand_buckets(rcu_hash_table *htable) {
+  return htable->num_items < htable->ideal_num_items ||
+         rcu_resize(htable, htable->table->num_buckets * 2);
+}
+
+rcu_hash_table *rcu_htable_create(size_t num_buckets, ht_hash_fun hash,
+                                  ht_equal_fun equal, rcu_free_fun free_entry) {
+  assert(num_buckets > 0);
+  assert(hash != NULL);
+  assert(equal != NULL);
+  assert(free_entry != NULL);
+
+  rcu_hash_table *htable = yu_malloc(sizeof(*htable));
+  if (!htable) {
+    return NULL;
+  }
+
+  htable->table = rcu_buckets_create(num_buckets);
+  if (!htable->table) {
+    yu_free(htable);
+    return NULL;
+  }
+
+  if (pthread_mutex_init(&htable->write_lock, NULL) != 0) {
+    yu_free(htable->table);
+    yu_free(htable);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < NUM_EPOCHS; ++i) {
+    htable->retired[i] = NULL;
+    htable->retired_tables[i] = NULL;
+  }
+
+  htable->seq = 0;
+  htable->epoch = 1;
+  htable->readers = NULL;
+
+  htable->hash = hash;
+  htable->equal = equal;
+  htable->free_entry = free_entry;
+
+  htable->num_items = 0;
+  htable->ideal_num_items = num_buckets * IDEAL_LOAD_FACTOR + 1;
+
+  return htable;
+}
+
+void rcu_htable_destroy(rcu_hash_table *htable) {
+  if (!htable) {
+    return;
+  }
+
+  assert(htable->readers == NULL);
+
+  for (size_t i = 0; i < NUM_EPOCHS; ++i) {
+    rcu_free_retired(htable, i);
+  }
+
+  struct rcu_buckets *table = htable->table;
+  for (size_t i = 0; i < table->num_buckets; ++i) {
+    struct hash_entry *entry = table->buckets[i].entry;
+
+    while (entry) {
+      struct hash_entry *next = entry->next;
+      htable->free_entry(entry);
+      entry = next;
+    }
+  }
+
+  pthread_mutex_destroy(&htable->write_lock);
+
+  yu_free(table);
+  yu_free(htable);
+}
+
+rcu_reader *rcu_htable_reader_register(rcu_hash_table *htable) {
+  assert(htable != NULL);
+
+  rcu_reader *reader = yu_malloc(sizeof(*reader));
+  if (!reader) {
+    return NULL;
+  }
+
+  reader->epoch = 0;
+  reader->htable = htable;
+
+  pthread_mutex_lock(&htable->write_lock);
+  reader->next = htable->readers;
+  htable->readers = reader;
+  pthread_mutex_unlock(&htable->write_lock);
+
+  return reader;
+}
+
+void rcu_htable_reader_unregister(rcu_reader *reader) {
+  assert(reader != NULL);
+  assert(reader->epoch == 0);
+
+  rcu_hash_table *htable = reader->htable;
+
+  pthread_mutex_lock(&htable->write_lock);
+
+  struct rcu_reader **link = &htable->readers;
+  while (*link != reader) {
+    link = &(*link)->next;
+  }
+  *link = reader->next;
+
+  pthread_mutex_unlock(&htable->write_lock);
+
+  yu_free(reader);
+}
+
+void rcu_htable_read_lock(rcu_reader *reader) {
+  assert(reader != NULL);
+
+  size_t epoch = load_acquire(&reader->htable->epoch);
+
+  /* Writers must see that we are active before we read any pointer */
+  __atomic_store_n(&reader->epoch, epoch, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void rcu_htable_read_unlock(rcu_reader *reader) {
+  assert(reader != NULL);
+
+  store_release(&reader->epoch, 0);
+}
+
+struct hash_entry *rcu_htable_lookup(rcu_hash_table *htable,
+                                     struct hash_entry *query) {
+  assert(htable != NULL);
+  assert(query != NULL);
+
+  query->hashv = htable->hash(query);
+
+  for (;;) {
+    size_t seq = load_acquire(&htable->seq);
+
+    struct rcu_buckets *table = load_acquire(&htable->table);
+    struct hash_bucket *bucket = rcu_bucket(table, query->hashv);
+    struct hash_entry *entry = load_acquire(&bucket->entry);
+
+    while (entry) {
+      if (entry->hashv == query->hashv && htable->equal(entry, query)) {
+        return entry;
+      }
+      entry = load_acquire(&entry->next);
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (!(seq & 1) && load_relaxed(&htable->seq) == seq) {
+      return NULL;
+    }
+
+    sched_yield();
+  }
+}
+
+bool rcu_htable_rehash(rcu_hash_table *htable, size_t new_num_buckets) {
+  assert(htable != NULL);
+  assert(new_num_buckets > 0);
+
+  pthread_mutex_lock(&htable->write_lock);
+  bool ok = rcu_resize(htable, new_num_buckets);
+  pthread_mutex_unlock(&htable->write_lock);
+
+  return ok;
+}
+
+bool rcu_htable_insert(rcu_hash_table *htable, struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  entry->hashv = htable->hash(entry);
+
+  pthread_mutex_lock(&htable->write_lock);
+
+  if (!rcu_expand_buckets(htable)) {
+    pthread_mutex_unlock(&htable->write_lock);
+    return false;
+  }
+
+  struct hash_bucket *bucket = rcu_bucket(htable->table, entry->hashv);
+
+  entry->next = bucket->entry;
+  store_release(&bucket->entry, entry);
+  htable->num_items++;
+
+  pthread_mutex_unlock(&htable->write_lock);
+  return true;
+}
+
+bool rcu_htable_replace(rcu_hash_table *htable, struct hash_entry *entry) {
+  assert(htable != NULL);
+  assert(entry != NULL);
+
+  entry->hashv = htable->hash(entry);
+
+  pthread_mutex_lock(&htable->write_lock);
+
+  if (!rcu_expand_buckets(htable)) {
+    pthread_mutex_unlock(&htable->write_lock);
+    return false;
+  }
+
+  struct hash_bucket *bucket = rcu_bucket(htable->table, entry->hashv);
+  struct hash_entry **link = rcu_lookup_in_bucket(htable, bucket, entry);
+  struct hash_entry *victim = *link;
+
+  if (victim) {
+    entry->next = victim->next;
+    store_release(link, entry);
+
+    rcu_retire(htable, victim);
+  } else {
+    entry->next = bucket->entry;
+    store_release(&bucket->entry, entry);
+    htable->num_items++;
+  }
+
+  pthread_mutex_unlock(&htable->write_lock);
+  return true;
+}
+
+bool rcu_htable_remove(rcu_hash_table *htable, struct hash_entry *query) {
+  assert(htable != NULL);
+  assert(query != NULL);
+
+  query->hashv = htable->hash(query);
+
+  pthread_mutex_lock(&htable->write_lock);
+
+  struct hash_bucket *bucket = rcu_bucket(htable->table, query->hashv);
+  struct hash_entry **link = rcu_lookup_in_bucket(htable, bucket, query);
+  struct hash_entry *entry = *link;
+
+  if (entry) {
+    /* Readers standing on the entry could still follow its `next` */
+    store_release(link, entry->next);
+    htable->num_items--;
+
+    rcu_retire(htable, entry);
+  }
+
+  pthread_mutex_unlock(&htable->write_lock);
+  return entry != NULL;
+}
+
+void rcu_htable_synchronize(rcu_hash_table *htable) {
+  assert(htable != NULL);
+
+  /* After two epochs everything retired before the call is freed */
+  for (size_t advanced = 0; advanced < NUM_EPOCHS - 1;) {
+    pthread_mutex_lock(&htable->write_lock);
+    advanced += rcu_try_advance(htable);
+    pthread_mutex_unlock(&htable->write_lock);
+
+    if (advanced < NUM_EPOCHS - 1) {
+      sched_yield();
+    }
+  }
+}
+
+size_t rcu_htable_size(rcu_hash_table *htable) {
+  assert(htable != NULL);
+
+  pthread_mutex_lock(&htable->write_lock);
+  size_t num_items = htable->num_items;
+  pthread_mutex_unlock(&htable->write_lock);
+
+  return num_items;
+}
+
+size_t rcu_htable_num_buckets(rcu_hash_table *htable) {
+  assert(htable != NULL);
+
+  struct rcu_buckets *table = load_acquire(&htable->table);
+  return table->num_buckets;
+}
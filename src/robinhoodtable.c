@@ -0,0 +1,327 @@
+#include "datastructs/robin_hood_table.h"
+#include "datastructs/memory.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+
+/* Table should not be filled more than 9/10 of its capacity */
+#define RH_MAX_LOAD(capacity) ((capacity) - (capacity) / 10)
+
+#define RH_MIN_CAPACITY 8
+
+/* Fibonacci hashing: high bits of the product depend on every bit
+ * of hash value, so even weak hashes are spread over the table */
+#if SIZE_MAX > 0xFFFFFFFFu
+  #define RH_FIB_MULT ((size_t)0x9E3779B97F4A7C15ULL)
+#else
+  #define RH_FIB_MULT ((size_t)0x9E3779B9UL)
+#endif
+
+struct rh_slot {
+  size_t hashv;
+  struct hash_entry *entry; /* `NULL` if slot is empty */
+};
+
+struct robin_hood_table {
+  struct rh_slot *slots;
+
+  ht_hash_fun hash;
+  ht_equal_fun equal;
+
+  size_t num_items; /* Number of items in the table */
+  size_t capacity;  /* Number of slots, power of two */
+  size_t shift;     /* Shift of the product to get home slot */
+};
+
+static inline size_t rh_home(robin_hood_table *table, size_t hashv) {
+  return (hashv * RH_FIB_MULT) >> table->shift;
+}
+
+/* Probe sequence length: distance of the slot from home slot of its entry */
+static inline size_t rh_psl(robin_hood_table *table, size_t slot) {
+  return (slot - rh_home(table, table->slots[slot].hashv)) &
+         (table->capacity - 1);
+}
+
+static inline size_t rh_capacity_for(size_t num_items) {
+  size_t capacity = RH_MIN_CAPACITY;
+  while (RH_MAX_LOAD(capacity) < num_items) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+static bool rh_alloc(robin_hood_table *table, size_t capacity) {
+  struct rh_slot *slots = yu_calloc(capacity, sizeof(*slots));
+  if (!slots) {
+    return false;
+  }
+
+  table->slots = slots;
+  table->capacity = capacity;
+
+  table->shift = sizeof(size_t) * CHAR_BIT;
+  for (; capacity > 1; capacity >>= 1) {
+    table->shift--;
+  }
+
+  return true;
+}
+
+/* Insert without checking for duplicates. Every entry on the way that
+ * is closer to its home than the carried one gives its slot away */
+static void rh_place(robin_hood_table *table, size_t hashv,
+                     struct hash_entry *entry) {
+  size_t mask = table->capacity - 1;
+  size_t slot = rh_home(table, hashv);
+
+  for (size_t psl = 0;; ++psl, slot = (slot + 1) & mask) {
+    struct rh_slot *cur = &table->slots[slot];
+
+    if (!cur->entry) {
+      cur->hashv = hashv;
+      cur->entry = entry;
+      return;
+    }
+
+    size_t cur_psl = rh_psl(table, slot);
+    if (cur_psl < psl) {
+      size_t tmp_hashv = cur->hashv;
+      struct hash_entry *tmp_entry = cur->entry;
+
+      cur->hashv = hashv;
+      cur->entry = entry;
+
+      hashv = tmp_hashv;
+      entry = tmp_entry;
+      psl = cur_psl;
+    }
+  }
+}
+
+/* Returns slot of the entry or `capacity` if it does not exist */
+static size_t rh_find_slot(robin_hood_table *table, struct hash_entry *query) {
+  size_t mask = table->capacity - 1;
+  size_t hashv = query->hashv;
+  size_t slot = rh_home(table, hashv);
+
+  for (size_t psl = 0;; ++psl, slot = (slot + 1) & mask) {
+    struct rh_slot *cur = &table->slots[slot];
+
+    if (!cur->entry) {
+      return table->capacity;
+    }
+
+    if (cur->hashv == hashv) {
+      if (table->equal(cur->entry, query)) {
+        return slot;
+      }
+    } else if (rh_psl(table, slot) < psl) {
+      /* Query would have taken the slot of an entry closer to its home */
+      return table->capacity;
+    }
+  }
+}
+
+/* Backward shift deletion: following entries that are not in their home
+ * slots move one slot back, so no tombstones are needed */
+static void rh_clear_slot(robin_hood_table *table, size_t slot) {
+  size_t mask = table->capacity - 1;
+  size_t next = (slot + 1) & mask;
+
+  while (table->slots[next].entry && rh_psl(table, next) > 0) {
+    table->slots[slot] = table->slots[next];
+
+    slot = next;
+    next = (next + 1) & mask;
+  }
+
+  table->slots[slot].entry = NULL;
+  table->num_items--;
+}
+
+static bool rh_reserve_one(robin_hood_table *table) {
+  if (table->num_items < RH_MAX_LOAD(table->capacity)) {
+    return true;
+  }
+  return rhtable_rehash(table, table->capacity * 2);
+}
+
+robin_hood_table *rhtable_create(size_t initial_capacity, ht_hash_fun hash,
+                                 ht_equal_fun equal) {
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  robin_hood_table *table = yu_malloc(sizeof(*table));
+  if (!table) {
+    return NULL;
+  }
+
+  size_t capacity = RH_MIN_CAPACITY;
+  while (capacity < initial_capacity) {
+    capacity *= 2;
+  }
+
+  if (!rh_alloc(table, capacity)) {
+    yu_free(table);
+    return NULL;
+  }
+
+  table->hash = hash;
+  table->equal = equal;
+  table->num_items = 0;
+
+  return table;
+}
+
+void rhtable_destroy(robin_hood_table *table, rh_destroy_fun destroy) {
+  if (!table) {
+    return;
+  }
+
+  if (destroy) {
+    destroy(table);
+  }
+
+  yu_free(table->slots);
+  yu_free(table);
+}
+
+bool rhtable_rehash(robin_hood_table *table, size_t new_capacity) {
+  assert(table != NULL);
+
+  struct rh_slot *slots = table->slots;
+  size_t capacity = table->capacity;
+
+  size_t min_capacity = rh_capacity_for(table->num_items);
+  size_t alloc_capacity = RH_MIN_CAPACITY;
+  while (alloc_capacity < new_capacity || alloc_capacity < min_capacity) {
+    alloc_capacity *= 2;
+  }
+
+  if (!rh_alloc(table, alloc_capacity)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < capacity; ++i) {
+    if (slots[i].entry) {
+      rh_place(table, slots[i].hashv, slots[i].entry);
+    }
+  }
+
+  yu_free(slots);
+  return true;
+}
+
+bool rhtable_insert(robin_hood_table *table, struct hash_entry *entry) {
+  assert(table != NULL);
+  assert(entry != NULL);
+
+  if (!rh_reserve_one(table)) {
+    return false;
+  }
+
+  entry->hashv = table->hash(entry);
+
+  rh_place(table, entry->hashv, entry);
+  table->num_items++;
+
+  return true;
+}
+
+bool rhtable_replace(robin_hood_table *table, struct hash_entry *entry,
+                     struct hash_entry **replaced) {
+  assert(table != NULL);
+  assert(entry != NULL);
+  assert(replaced != NULL);
+
+  *replaced = NULL;
+
+  entry->hashv = table->hash(entry);
+
+  size_t slot = rh_find_slot(table, entry);
+  if (slot != table->capacity) {
+    *replaced = table->slots[slot].entry;
+    table->slots[slot].entry = entry;
+    return true;
+  }
+
+  if (!rh_reserve_one(table)) {
+    return false;
+  }
+
+  rh_place(table, entry->hashv, entry);
+  table->num_items++;
+
+  return true;
+}
+
+struct hash_entry *rhtable_lookup(robin_hood_table *table,
+                                  struct hash_entry *query) {
+  assert(table != NULL);
+  assert(query != NULL);
+
+  query->hashv = table->hash(query);
+
+  size_t slot = rh_find_slot(table, query);
+  return slot != table->capacity ? table->slots[slot].entry : NULL;
+}
+
+struct hash_entry *rhtable_remove(robin_hood_table *table,
+                                  struct hash_entry *query) {
+  assert(table != NULL);
+  assert(query != NULL);
+
+  query->hashv = table->hash(query);
+
+  size_t slot = rh_find_slot(table, query);
+  if (slot == table->capacity) {
+    return NULL;
+  }
+
+  struct hash_entry *entry = table->slots[slot].entry;
+  rh_clear_slot(table, slot);
+
+  return entry;
+}
+
+void rhtable_erase(robin_hood_table *table, struct hash_entry *entry) {
+  assert(table != NULL);
+  assert(entry != NULL);
+
+  size_t mask = table->capacity - 1;
+  size_t slot = rh_home(table, entry->hashv);
+
+  while (table->slots[slot].entry != entry) {
+    assert(table->slots[slot].entry && "Entry is not in the table");
+    slot = (slot + 1) & mask;
+  }
+
+  rh_clear_slot(table, slot);
+}
+
+size_t rhtable_size(robin_hood_table *table) {
+  assert(table != NULL);
+  return table->num_items;
+}
+
+size_t rhtable_capacity(robin_hood_table *table) {
+  assert(table != NULL);
+  return table->capacity;
+}
+
+struct hash_entry *rhtable_iter(robin_hood_table *table, size_t *pos) {
+  assert(table != NULL);
+  assert(pos != NULL);
+
+  for (size_t i = *pos; i < table->capacity; ++i) {
+    if (table->slots[i].entry) {
+      *pos = i + 1;
+      return table->slots[i].entry;
+    }
+  }
+
+  *pos = table->capacity;
+  return NULL;
+}
@@ -0,0 +1,397 @@
+#include "datastructs/swiss_table.h"
+#include "datastructs/memory.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SW_USE_SSE2
+#endif
+
+#define SW_GROUP_WIDTH 16
+
+/* Control byte values. Full slots store 7 low bits of hash value */
+#define SW_EMPTY ((int8_t)-128) /* 0b10000000 */
+#define SW_DELETED ((int8_t)-2) /* 0b11111110 */
+
+#define SW_H1(hashv) ((hashv) >> 7)
+#define SW_H2(hashv) ((int8_t)((hashv)&0x7F))
+
+/* Table should not be filled more than 7/8 of its capacity */
+#define SW_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+struct swiss_table {
+  int8_t *ctrl;              /* Control bytes */
+  struct hash_entry **slots; /* Pointers to entries */
+
+  ht_hash_fun hash;
+  ht_equal_fun equal;
+
+  size_t num_items;   /* Number of items in the table */
+  size_t capacity;    /* Number of slots, power of two */
+  size_t growth_left; /* Number of items to insert before rehash */
+};
+
+struct sw_probe {
+  size_t group;
+  size_t mask;
+  size_t stride;
+};
+
+typedef uint32_t sw_bitmask;
+
+#ifdef SW_USE_SSE2
+static inline sw_bitmask sw_match(const int8_t *group, int8_t h2) {
+  __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+  __m128i match = _mm_set1_epi8(h2);
+  return (sw_bitmask)_mm_movemask_epi8(_mm_cmpeq_epi8(match, ctrl));
+}
+
+static inline sw_bitmask sw_match_empty(const int8_t *group) {
+  return sw_match(group, SW_EMPTY);
+}
+
+static inline sw_bitmask sw_match_empty_or_deleted(const int8_t *group) {
+  /* Both EMPTY and DELETED have the sign bit set */
+  __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+  return (sw_bitmask)_mm_movemask_epi8(ctrl);
+}
+#else
+static inline sw_bitmask sw_match(const int8_t *group, int8_t h2) {
+  sw_bitmask mask = 0;
+  for (int i = 0; i < SW_GROUP_WIDTH; ++i) {
+    mask |= (sw_bitmask)(group[i] == h2) << i;
+  }
+  return mask;
+}
+
+static inline sw_bitmask sw_match_empty(const int8_t *group) {
+  return sw_match(group, SW_EMPTY);
+}
+
+static inline sw_bitmask sw_match_empty_or_deleted(const int8_t *group) {
+  sw_bitmask mask = 0;
+  for (int i = 0; i < SW_GROUP_WIDTH; ++i) {
+    mask |= (sw_bitmask)(group[i] < 0) << i;
+  }
+  return mask;
+}
+#endif
+
+static inline unsigned sw_lowest_bit(sw_bitmask mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned)__builtin_ctz(mask);
+#else
+  unsigned bit = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+/* Triangular probing over groups visits every group exactly once
+ * because number of groups is a power of two */
+static inline struct sw_probe sw_probe_start(swiss_table *table, size_t hashv) {
+  struct sw_probe probe;
+  probe.mask = table->capacity / SW_GROUP_WIDTH - 1;
+  probe.group = SW_H1(hashv) & probe.mask;
+  probe.stride = 0;
+  return probe;
+}
+
+static inline void sw_probe_next(struct sw_probe *probe) {
+  probe->stride++;
+  probe->group = (probe->group + probe->stride) & probe->mask;
+}
+
+static inline size_t sw_capacity_for(size_t num_slots) {
+  size_t capacity = SW_GROUP_WIDTH;
+  while (capacity < num_slots) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+static bool sw_alloc(swiss_table *table, size_t capacity) {
+  struct hash_entry **slots = yu_malloc(capacity * sizeof(*slots) + capacity);
+  if (!slots) {
+    return false;
+  }
+
+  table->slots = slots;
+  table->ctrl = (int8_t *)(slots + capacity);
+  table->capacity = capacity;
+  table->growth_left = SW_MAX_LOAD(capacity);
+
+  memset(table->ctrl, SW_EMPTY, capacity);
+  return true;
+}
+
+static size_t sw_find_free_slot(swiss_table *table, size_t hashv) {
+  struct sw_probe probe = sw_probe_start(table, hashv);
+
+  for (;;) {
+    const int8_t *group = table->ctrl + probe.group * SW_GROUP_WIDTH;
+    sw_bitmask mask = sw_match_empty_or_deleted(group);
+    if (mask) {
+      return probe.group * SW_GROUP_WIDTH + sw_lowest_bit(mask);
+    }
+    sw_probe_next(&probe);
+  }
+}
+
+static inline void sw_set_slot(swiss_table *table, size_t slot,
+                               struct hash_entry *entry) {
+  table->ctrl[slot] = SW_H2(entry->hashv);
+  table->slots[slot] = entry;
+}
+
+/* Returns slot of the entry or `capacity` if it does not exist */
+static size_t sw_find_slot(swiss_table *table, struct hash_entry *query) {
+  struct sw_probe probe = sw_probe_start(table, query->hashv);
+  int8_t h2 = SW_H2(query->hashv);
+
+  for (;;) {
+    const int8_t *group = table->ctrl + probe.group * SW_GROUP_WIDTH;
+
+    for (sw_bitmask mask = sw_match(group, h2); mask; mask &= mask - 1) {
+      size_t slot = probe.group * SW_GROUP_WIDTH + sw_lowest_bit(mask);
+      struct hash_entry *entry = table->slots[slot];
+
+      if (entry->hashv == query->hashv && table->equal(entry, query)) {
+        return slot;
+      }
+    }
+
+    if (sw_match_empty(group)) {
+      return table->capacity;
+    }
+    sw_probe_next(&probe);
+  }
+}
+
+static void sw_clear_slot(swiss_table *table, size_t slot) {
+  const int8_t *group = table->ctrl + (slot & ~(size_t)(SW_GROUP_WIDTH - 1));
+
+  /* Probing never continues past a group that has an empty slot,
+   * so such group does not need a tombstone */
+  if (sw_match_empty(group)) {
+    table->ctrl[slot] = SW_EMPTY;
+    table->growth_left++;
+  } else {
+    table->ctrl[slot] = SW_DELETED;
+  }
+  table->num_items--;
+}
+
+static bool sw_reserve_one(swiss_table *table) {
+  if (table->growth_left > 0) {
+    return true;
+  }
+
+  /* Table could be full of tombstones, in that case we don't grow */
+  size_t capacity = table->capacity;
+  if (table->num_items >= SW_MAX_LOAD(capacity) / 2) {
+    capacity *= 2;
+  }
+  return swtable_rehash(table, capacity);
+}
+
+swiss_table *swtable_create(size_t initial_capacity, ht_hash_fun hash,
+                            ht_equal_fun equal) {
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  swiss_table *table = yu_malloc(sizeof(*table));
+  if (!table) {
+    return NULL;
+  }
+
+  if (!sw_alloc(table, sw_capacity_for(initial_capacity))) {
+    yu_free(table);
+    return NULL;
+  }
+
+  table->hash = hash;
+  table->equal = equal;
+  table->num_items = 0;
+
+  return table;
+}
+
+void swtable_destroy(swiss_table *table, sw_destroy_fun destroy) {
+  if (!table) {
+    return;
+  }
+
+  if (destroy) {
+    destroy(table);
+  }
+
+  yu_free(table->slots);
+  yu_free(table);
+}
+
+bool swtable_rehash(swiss_table *table, size_t new_capacity) {
+  assert(table != NULL);
+
+  int8_t *ctrl = table->ctrl;
+  struct hash_entry **slots = table->slots;
+  size_t capacity = table->capacity;
+
+  size_t min_capacity = table->num_items + table->num_items / 7 + 1;
+  if (new_capacity < min_capacity) {
+    new_capacity = min_capacity;
+  }
+
+  if (!sw_alloc(table, sw_capacity_for(new_capacity))) {
+    return false;
+  }
+
+  for (size_t i = 0; i < capacity; ++i) {
+    if (ctrl[i] >= 0) {
+      size_t slot = sw_find_free_slot(table, slots[i]->hashv);
+      sw_set_slot(table, slot, slots[i]);
+    }
+  }
+  table->growth_left -= table->num_items;
+
+  yu_free(slots);
+  return true;
+}
+
+bool swtable_insert(swiss_table *table, struct hash_entry *entry) {
+  assert(table != NULL);
+  assert(entry != NULL);
+
+  if (!sw_reserve_one(table)) {
+    return false;
+  }
+
+  entry->hashv = table->hash(entry);
+
+  size_t slot = sw_find_free_slot(table, entry->hashv);
+  if (table->ctrl[slot] == SW_EMPTY) {
+    table->growth_left--;
+  }
+
+  sw_set_slot(table, slot, entry);
+  table->num_items++;
+
+  return true;
+}
+
+bool swtable_replace(swiss_table *table, struct hash_entry *entry,
+                     struct hash_entry **replaced) {
+  assert(table != NULL);
+  assert(entry != NULL);
+  assert(replaced != NULL);
+
+  *replaced = NULL;
+
+  entry->hashv = table->hash(entry);
+
+  size_t slot = sw_find_slot(table, entry);
+  if (slot != table->capacity) {
+    *replaced = table->slots[slot];
+    table->slots[slot] = entry;
+    return true;
+  }
+
+  if (!sw_reserve_one(table)) {
+    return false;
+  }
+
+  slot = sw_find_free_slot(table, entry->hashv);
+  if (table->ctrl[slot] == SW_EMPTY) {
+    table->growth_left--;
+  }
+
+  sw_set_slot(table, slot, entry);
+  table->num_items++;
+
+  return true;
+}
+
+struct hash_entry *swtable_lookup(swiss_table *table,
+                                  struct hash_entry *query) {
+  assert(table != NULL);
+  assert(query != NULL);
+
+  query->hashv = table->hash(query);
+
+  size_t slot = sw_find_slot(table, query);
+  return slot != table->capacity ? table->slots[slot] : NULL;
+}
+
+struct hash_entry *swtable_remove(swiss_table *table,
+                                  struct hash_entry *query) {
+  assert(table != NULL);
+  assert(query != NULL);
+
+  query->hashv = table->hash(query);
+
+  size_t slot = sw_find_slot(table, query);
+  if (slot == table->capacity) {
+    return NULL;
+  }
+
+  struct hash_entry *entry = table->slots[slot];
+  sw_clear_slot(table, slot);
+
+  return entry;
+}
+
+void swtable_erase(swiss_table *table, struct hash_entry *entry) {
+  assert(table != NULL);
+  assert(entry != NULL);
+
+  struct sw_probe probe = sw_probe_start(table, entry->hashv);
+  int8_t h2 = SW_H2(entry->hashv);
+
+  for (;;) {
+    const int8_t *group = table->ctrl + probe.group * SW_GROUP_WIDTH;
+
+    for (sw_bitmask mask = sw_match(group, h2); mask; mask &= mask - 1) {
+      size_t slot = probe.group * SW_GROUP_WIDTH + sw_lowest_bit(mask);
+
+      if (table->slots[slot] == entry) {
+        sw_clear_slot(table, slot);
+        return;
+      }
+    }
+
+    assert(!sw_match_empty(group) && "Entry is not in the table");
+    sw_probe_next(&probe);
+  }
+}
+
+size_t swtable_size(swiss_table *table) {
+  assert(table != NULL);
+  return table->num_items;
+}
+
+size_t swtable_capacity(swiss_table *table) {
+  assert(table != NULL);
+  return table->capacity;
+}
+
+struct hash_entry *swtable_iter(swiss_table *table, size_t *pos) {
+  assert(table != NULL);
+  assert(pos != NULL);
+
+  for (size_t i = *pos; i < table->capacity; ++i) {
+    if (table->ctrl[i] >= 0) {
+      *pos = i + 1;
+      return table->slots[i];
+    }
+  }
+
+  *pos = table->capacity;
+  return NULL;
+}
@@ -0,0 +1,320 @@
+#include "datastructs/ttl_table.h"
+#include "datastructs/memory.h"
+
+#include <assert.h>
+
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK ((uint64_t)WHEEL_SIZE - 1)
+/* Deadlines farther than this are parked in the last level
+ * and cascaded again when the wheel reaches them */
+#define WHEEL_RANGE ((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+struct ttl_table {
+  hash_table *htable;
+
+  ttl_expire_fun expire;
+  void *expire_arg;
+
+  struct ttl_entry *wheel[WHEEL_LEVELS][WHEEL_SIZE];
+  uint64_t occupied; /* Slots of the first level that may be non-empty */
+
+  /* Entries of the slots the wheel has reached at every level above the
+   * first, not yet spread over finer slots. The wheel does not move on
+   * until they are */
+  struct ttl_entry *cascade[WHEEL_LEVELS];
+
+  uint64_t now;      /* Every tick before this one has been processed */
+  size_t num_timers; /* Number of entries on the wheel */
+};
+
+static void ttl_wheel_link(ttl_table *table, struct ttl_entry *entry) {
+  /* Overdue entries go to the current slot */
+  uint64_t deadline = entry->deadline > table->now ? entry->deadline
+                                                   : table->now;
+  uint64_t delta = deadline - table->now;
+
+  if (delta >= WHEEL_RANGE) {
+    delta = WHEEL_RANGE - 1;
+    deadline = table->now + delta;
+  }
+
+  size_t level = 0;
+  while (delta >> (WHEEL_BITS * (level + 1))) {
+    level++;
+  }
+
+  size_t slot = (deadline >> (WHEEL_BITS * level)) & WHEEL_MASK;
+  struct ttl_entry **head = &table->wheel[level][slot];
+
+  entry->wheel_next = *head;
+  if (*head) {
+    (*head)->wheel_pprev = &entry->wheel_next;
+  }
+  *head = entry;
+  entry->wheel_pprev = head;
+
+  if (level == 0) {
+    table->occupied |= (uint64_t)1 << slot;
+  }
+  table->num_timers++;
+}
+
+static void ttl_wheel_unlink(ttl_table *table, struct ttl_entry *entry) {
+  if (!entry->wheel_pprev) {
+    return;
+  }
+
+  *entry->wheel_pprev = entry->wheel_next;
+  if (entry->wheel_next) {
+    entry->wheel_next->wheel_pprev = entry->wheel_pprev;
+  }
+  entry->wheel_pprev = NULL;
+
+  table->num_timers--;
+}
+
+/* Called when the first level wraps around: entries of the current slot
+ * of the next level are taken off to be cascaded, the next level wraps
+ * around too if its current slot is the first one */
+static void ttl_wheel_reach(ttl_table *table) {
+  for (size_t level = 1; level < WHEEL_LEVELS; ++level) {
+    size_t slot = (table->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    struct ttl_entry *entry = table->wheel[level][slot];
+
+    assert(table->cascade[level] == NULL);
+    table->cascade[level] = entry;
+    if (entry) {
+      entry->wheel_pprev = &table->cascade[level];
+    }
+    table->wheel[level][slot] = NULL;
+
+    if (slot != 0) {
+      break;
+    }
+  }
+}
+
+static bool ttl_wheel_cascading(ttl_table *table) {
+  for (size_t level = 1; level < WHEEL_LEVELS; ++level) {
+    if (table->cascade[level]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Spreads at most `budget` of the taken off entries over finer slots,
+ * returns number of moved entries */
+static size_t ttl_wheel_cascade(ttl_table *table, size_t budget) {
+  size_t moved = 0;
+
+  for (size_t level = 1; level < WHEEL_LEVELS; ++level) {
+    while (table->cascade[level]) {
+      if (moved == budget) {
+        return moved;
+      }
+
+      struct ttl_entry *entry = table->cascade[level];
+      ttl_wheel_unlink(table, entry);
+      ttl_wheel_link(table, entry);
+      moved++;
+    }
+  }
+
+  return moved;
+}
+
+/* Move the wheel forward to `now`, which must not be after the next
+ * non-empty slot of the first level. Stops at the first level boundary
+ * that leaves entries to cascade */
+static void ttl_wheel_advance(ttl_table *table, uint64_t now) {
+  while (table->now < now && !ttl_wheel_cascading(table)) {
+    uint64_t boundary = (table->now | WHEEL_MASK) + 1;
+
+    table->now = boundary < now ? boundary : now;
+    if ((table->now & WHEEL_MASK) == 0) {
+      ttl_wheel_reach(table);
+    }
+  }
+}
+
+static void ttl_drop(ttl_table *table, struct ttl_entry *entry) {
+  ttl_wheel_unlink(table, entry);
+  htable_erase(table->htable, &entry->hh);
+
+  if (table->expire) {
+    table->expire(entry, table->expire_arg);
+  }
+}
+
+ttl_table *ttltable_create(uint64_t now, ht_hash_fun hash, ht_equal_fun equal,
+                           ttl_expire_fun expire, void *expire_arg) {
+  assert(hash != NULL);
+  assert(equal != NULL);
+
+  ttl_table *table = yu_calloc(1, sizeof(*table));
+  if (!table) {
+    return NULL;
+  }
+
+  table->htable = htable_create(1, hash, equal);
+  if (!table->htable) {
+    yu_free(table);
+    return NULL;
+  }
+  /* Growth on insert and shrink on expire move a few buckets per call
+   * instead of the whole table */
+  htable_set_incremental(table->htable, true);
+
+  table->expire = expire;
+  table->expire_arg = expire_arg;
+  table->now = now;
+
+  return table;
+}
+
+void ttltable_destroy(ttl_table *table) {
+  if (!table) {
+    return;
+  }
+
+  if (table->expire) {
+    struct ttl_entry *cur, *n;
+
+    htable_for_each_temp(table->htable, cur, n, hh) {
+      table->expire(cur, table->expire_arg);
+    }
+  }
+
+  htable_destroy(table->htable, NULL);
+  yu_free(table);
+}
+
+bool ttltable_insert(ttl_table *table, struct ttl_entry *entry,
+                     uint64_t deadline) {
+  assert(table != NULL);
+  assert(entry != NULL);
+
+  if (!htable_insert(table->htable, &entry->hh)) {
+    return false;
+  }
+
+  entry->deadline = deadline;
+  entry->wheel_pprev = NULL;
+  if (deadline != TTL_NO_DEADLINE) {
+    ttl_wheel_link(table, entry);
+  }
+
+  return true;
+}
+
+void ttltable_set_deadline(ttl_table *table, struct ttl_entry *entry,
+                           uint64_t deadline) {
+  assert(table != NULL);
+  assert(entry != NULL);
+
+  ttl_wheel_unlink(table, entry);
+
+  entry->deadline = deadline;
+  if (deadline != TTL_NO_DEADLINE) {
+    ttl_wheel_link(table, entry);
+  }
+}
+
+struct ttl_entry *ttltable_lookup(ttl_table *table, struct ttl_entry *query,
+                                  uint64_t now) {
+  assert(table != NULL);
+  assert(query != NULL);
+
+  struct hash_entry *found = htable_lookup(table->htable, &query->hh);
+  if (!found) {
+    return NULL;
+  }
+
+  struct ttl_entry *entry = htable_entry(found, struct ttl_entry, hh);
+  if (entry->deadline <= now) {
+    ttl_drop(table, entry);
+    return NULL;
+  }
+
+  return entry;
+}
+
+struct ttl_entry *ttltable_remove(ttl_table *table, struct ttl_entry *query) {
+  assert(table != NULL);
+  assert(query != NULL);
+
+  struct hash_entry *removed = htable_remove(table->htable, &query->hh);
+  if (!removed) {
+    return NULL;
+  }
+
+  struct ttl_entry *entry = htable_entry(removed, struct ttl_entry, hh);
+  ttl_wheel_unlink(table, entry);
+
+  return entry;
+}
+
+size_t ttltable_expire(ttl_table *table, uint64_t now, size_t budget) {
+  assert(table != NULL);
+
+  size_t expired = 0;
+  size_t work = 0; /* Expired and cascaded entries */
+
+  while (table->now <= now) {
+    work += ttl_wheel_cascade(table, budget - work);
+    if (ttl_wheel_cascading(table)) {
+      return expired;
+    }
+
+    if (table->num_timers == 0) {
+      /* Nothing to cascade, the wheel could jump */
+      table->now = now + 1;
+      break;
+    }
+
+    size_t slot = table->now & WHEEL_MASK;
+    uint64_t rest = table->occupied >> slot;
+
+    if (!rest) {
+      /* Skip to the end of the first level */
+      uint64_t boundary = (table->now | WHEEL_MASK) + 1;
+      ttl_wheel_advance(table, boundary < now + 1 ? boundary : now + 1);
+      continue;
+    }
+
+    if (!(rest & 1)) {
+      size_t skip = 0;
+      for (; !(rest & 1); rest >>= 1) {
+        skip++;
+      }
+      ttl_wheel_advance(table, table->now + skip < now + 1 ? table->now + skip
+                                                           : now + 1);
+      continue;
+    }
+
+    /* Entries of the current slot of the first level are due */
+    struct ttl_entry **head = &table->wheel[0][slot];
+    while (*head) {
+      if (work == budget) {
+        return expired;
+      }
+
+      ttl_drop(table, *head);
+      expired++;
+      work++;
+    }
+    table->occupied &= ~((uint64_t)1 << slot);
+
+    ttl_wheel_advance(table, table->now + 1);
+  }
+
+  return expired;
+}
+
+size_t ttltable_size(ttl_table *table) {
+  assert(table != NULL);
+  return htable_size(table->htable);
+}
@@ -0,0 +1,237 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "datastructs/cache.h"
+#include "datastructs/functions.h"
+
+#include "utils.hpp"
+
+struct KeyValue {
+  KeyValue() {}
+
+  KeyValue(int key_, int val_ = 0) : key(key_), val(val_) {}
+
+  int key;
+  int val;
+  cache_entry ce;
+};
+
+bool equalKeyValue(const hash_entry *a, const hash_entry *b) {
+  KeyValue *firstKeyValue = cache_hash_item(a, KeyValue, ce);
+  KeyValue *secondKeyValue = cache_hash_item(b, KeyValue, ce);
+
+  return firstKeyValue->key == secondKeyValue->key;
+}
+
+size_t hashKeyValueNode(const hash_entry *a) {
+  KeyValue *keyValue = cache_hash_item(a, KeyValue, ce);
+  return yu_hash_i32(keyValue->key);
+}
+
+void evictKeyValue(cache_entry *entry, void *arg) {
+  std::vector<int> *evicted = static_cast<std::vector<int> *>(arg);
+  KeyValue *keyValue = cache_item(entry, KeyValue, ce);
+
+  evicted->push_back(keyValue->key);
+  delete keyValue;
+}
+
+class Cache {
+public:
+  Cache(size_t capacity, cache_policy policy) {
+    cache_ = cache_create(capacity, policy, hashKeyValueNode, equalKeyValue,
+                          evictKeyValue, &evicted_);
+  }
+
+  ~Cache() { cache_destroy(cache_); }
+
+  void put(int key, int val = 0, size_t charge = 1) {
+    KeyValue *keyValue = new KeyValue(key, val);
+
+    bool isPut = cache_add(cache_, keyValue, ce, charge);
+    ASSERT_TRUE(isPut);
+  }
+
+  KeyValue *get(int key) {
+    KeyValue query(key);
+
+    return cache_find(cache_, &query, ce);
+  }
+
+  void remove(int key) {
+    KeyValue query(key);
+
+    KeyValue *removed =
+      cache_item_safe(cache_remove(cache_, &query.ce), KeyValue, ce);
+    delete removed;
+  }
+
+  size_t size() { return cache_size(cache_); }
+
+  size_t used() { return cache_used(cache_); }
+
+  std::vector<int> &evicted() { return evicted_; }
+
+private:
+  std::vector<int> evicted_;
+  cache *cache_;
+};
+
+TEST(CacheTest, LRU_GetPromotesEntry_EvictsLeastRecentlyUsed) {
+  Cache cache(3, CACHE_LRU);
+
+  cache.put(1);
+  cache.put(2);
+  cache.put(3);
+  ASSERT_TRUE(notNull(cache.get(1)));
+
+  cache.put(4);
+  cache.put(5);
+
+  EXPECT_EQ(cache.evicted(), std::vector<int>({2, 3}));
+  EXPECT_EQ(cache.size(), 3);
+  EXPECT_TRUE(notNull(cache.get(1)));
+  EXPECT_FALSE(notNull(cache.get(2)));
+}
+
+TEST(CacheTest, Clock_ReferencedEntry_GetsSecondChance) {
+  Cache cache(3, CACHE_CLOCK);
+
+  cache.put(1);
+  cache.put(2);
+  cache.put(3);
+  ASSERT_TRUE(notNull(cache.get(1)));
+
+  cache.put(4);
+  EXPECT_EQ(cache.evicted(), std::vector<int>({2}));
+
+  /* Mark of the first entry was cleared by the previous eviction */
+  cache.put(5);
+  cache.put(6);
+  EXPECT_EQ(cache.evicted(), std::vector<int>({2, 3, 1}));
+}
+
+TEST(CacheTest, TinyLFU_RareEntry_IsNotAdmitted) {
+  Cache cache(2, CACHE_TINYLFU);
+
+  cache.put(1);
+  cache.put(2);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(notNull(cache.get(1)));
+    ASSERT_TRUE(notNull(cache.get(2)));
+  }
+
+  cache.put(3);
+  EXPECT_EQ(cache.evicted(), std::vector<int>({3}));
+  EXPECT_EQ(cache.size(), 2);
+
+  /* Misses count as accesses too, so frequently missed entry is admitted */
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(notNull(cache.get(3)));
+  }
+  cache.put(3);
+  EXPECT_EQ(cache.evicted(), std::vector<int>({3, 1}));
+  EXPECT_TRUE(notNull(cache.get(3)));
+}
+
+TEST(CacheTest, TinyLFU_GrowingCache_KeepsFrequencies) {
+  Cache cache(32, CACHE_TINYLFU);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(notNull(cache.get(0)));
+  }
+
+  /* Sketch is widened while the cache fills up */
+  for (int i = 0; i < 32; ++i) {
+    cache.put(i);
+  }
+  EXPECT_TRUE(cache.evicted().empty());
+
+  /* And once more by this put. Least recently used entry is still more
+   * frequent than the new one */
+  cache.put(100);
+  EXPECT_EQ(cache.evicted(), std::vector<int>({100}));
+}
+
+TEST(CacheTest, Put_Charges_KeepsUsedWithinCapacity) {
+  Cache cache(100, CACHE_LRU);
+
+  cache.put(1, 0, 40);
+  cache.put(2, 0, 40);
+  cache.put(3, 0, 40);
+  EXPECT_EQ(cache.evicted(), std::vector<int>({1}));
+  EXPECT_EQ(cache.used(), 80);
+
+  /* Entry larger than capacity does not evict anything else */
+  cache.put(4, 0, 200);
+  EXPECT_EQ(cache.evicted(), std::vector<int>({1, 4}));
+  EXPECT_EQ(cache.used(), 80);
+
+  cache.put(5, 0, 100);
+  EXPECT_EQ(cache.evicted(), std::vector<int>({1, 4, 2, 3}));
+  EXPECT_EQ(cache.used(), 100);
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(CacheTest, Put_ExistingKey_EvictsReplacedEntry) {
+  Cache cache(10, CACHE_LRU);
+
+  cache.put(1, 1, 3);
+  cache.put(2, 2, 3);
+  cache.put(1, 10, 5);
+
+  EXPECT_EQ(cache.evicted(), std::vector<int>({1}));
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.used(), 8);
+  ASSERT_TRUE(notNull(cache.get(1)));
+  EXPECT_EQ(cache.get(1)->val, 10);
+}
+
+TEST(CacheTest, Remove_ExistingKey_IsNotEvicted) {
+  Cache cache(10, CACHE_CLOCK);
+
+  cache.put(1, 0, 4);
+  cache.put(2, 0, 4);
+  cache.remove(1);
+  cache.remove(3);
+
+  EXPECT_TRUE(cache.evicted().empty());
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.used(), 4);
+  EXPECT_FALSE(notNull(cache.get(1)));
+}
+
+class CachePolicyTest : public ::testing::TestWithParam<cache_policy> {};
+
+INSTANTIATE_TEST_SUITE_P(Instantiation, CachePolicyTest,
+                         ::testing::Values(CACHE_LRU, CACHE_CLOCK,
+                                           CACHE_TINYLFU));
+
+TEST_P(CachePolicyTest, RandomOperations_KeepsCapacityAndOwnership) {
+  std::vector<int> evicted;
+  size_t numPuts = 0;
+
+  {
+    Cache cache(64, GetParam());
+    unsigned seed = 1;
+
+    for (int i = 0; i < 20000; ++i) {
+      seed = seed * 1103515245 + 12345;
+      int key = static_cast<int>((seed >> 8) % 300);
+
+      if (!cache.get(key)) {
+        cache.put(key, 0, 1 + (seed >> 20) % 4);
+        numPuts++;
+      }
+
+      ASSERT_LE(cache.used(), 64);
+    }
+
+    /* Every entry is either in the cache or was passed to evict */
+    EXPECT_EQ(cache.evicted().size() + cache.size(), numPuts);
+    evicted = cache.evicted();
+  }
+
+  EXPECT_FALSE(evicted.empty());
+}
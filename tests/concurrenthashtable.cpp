@@ -0,0 +1,212 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "datastructs/concurrent_hash_table.h"
+#include "datastructs/functions.h"
+
+#include "utils.hpp"
+
+struct KeyValue {
+  KeyValue() {}
+
+  KeyValue(int key_, int val_ = 0) : key(key_), val(val_) {}
+
+  int key;
+  int val;
+  hash_entry hh;
+};
+
+bool equalKeyValue(const hash_entry *a, const hash_entry *b) {
+  KeyValue *firstKeyValue = htable_entry(a, KeyValue, hh);
+  KeyValue *secondKeyValue = htable_entry(b, KeyValue, hh);
+
+  return firstKeyValue->key == secondKeyValue->key;
+}
+
+size_t hashKeyValueNode(const hash_entry *a) {
+  KeyValue *keyValue = htable_entry(a, KeyValue, hh);
+  return yu_hash_i32(keyValue->key);
+}
+
+void deleteKeyValue(hash_entry *entry, void *arg) {
+  YU_UNUSED(arg);
+  delete htable_entry(entry, KeyValue, hh);
+}
+
+void collectKey(hash_entry *entry, void *arg) {
+  std::vector<int> *keys = static_cast<std::vector<int> *>(arg);
+  keys->push_back(htable_entry(entry, KeyValue, hh)->key);
+}
+
+void destroyKeyValues(concurrent_hash_table *htable) {
+  chtable_for_each(htable, deleteKeyValue, nullptr);
+}
+
+class ConcurrentHashTable {
+public:
+  ConcurrentHashTable(bool ordered = true, size_t numStripes = 8) {
+    ht_ = chtable_create(1, numStripes, hashKeyValueNode, equalKeyValue,
+                         ordered);
+  }
+
+  ~ConcurrentHashTable() { chtable_destroy(ht_, destroyKeyValues); }
+
+  void insert(int key, int val = 0) {
+    KeyValue *keyValue = new KeyValue(key, val);
+
+    bool isInserted = chtable_add(ht_, keyValue, hh);
+    ASSERT_TRUE(isInserted);
+  }
+
+  void replace(int key, int val = 0) {
+    KeyValue *keyValue = new KeyValue(key, val);
+    hash_entry *replaced;
+
+    chtable_replace(ht_, &keyValue->hh, &replaced);
+    if (replaced) {
+      delete htable_entry(replaced, KeyValue, hh);
+    }
+  }
+
+  KeyValue *find(int key) {
+    KeyValue query(key);
+
+    return chtable_find(ht_, &query, hh);
+  }
+
+  void remove(int key) {
+    KeyValue query(key);
+
+    KeyValue *removeKeyValue = chtable_delete(ht_, &query, hh);
+
+    delete removeKeyValue;
+  }
+
+  std::vector<int> keys() {
+    std::vector<int> keys;
+    chtable_for_each(ht_, collectKey, &keys);
+    return keys;
+  }
+
+  size_t size() { return chtable_size(ht_); }
+
+  size_t num_buckets() { return chtable_num_buckets(ht_); }
+
+private:
+  concurrent_hash_table *ht_;
+};
+
+TEST(ConcurrentHashTableTest, Create_DefaultInitialization_ReturnsEmptyTable) {
+  ConcurrentHashTable hashTable;
+
+  EXPECT_EQ(hashTable.size(), 0);
+  EXPECT_EQ(hashTable.num_buckets() % 8, 0);
+  EXPECT_FALSE(notNull(hashTable.find(0)));
+}
+
+TEST(ConcurrentHashTableTest, Insert_InsertAndRemove_ReturnsValidSize) {
+  ConcurrentHashTable hashTable;
+
+  for (int i = 0; i < 100; ++i) {
+    hashTable.insert(i, i);
+  }
+  for (int i = 0; i < 100; i += 2) {
+    hashTable.remove(i);
+  }
+
+  EXPECT_EQ(hashTable.size(), 50);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(notNull(hashTable.find(i)), i % 2 == 1);
+  }
+}
+
+TEST(ConcurrentHashTableTest, Replace_ReplaceExistingItem_ReturnsNewValue) {
+  ConcurrentHashTable hashTable;
+
+  hashTable.insert(1, 1);
+  hashTable.replace(1, 100);
+
+  KeyValue *found = hashTable.find(1);
+
+  ASSERT_TRUE(notNull(found));
+  EXPECT_EQ(found->val, 100);
+  EXPECT_EQ(hashTable.size(), 1);
+}
+
+TEST(ConcurrentHashTableTest, ForEach_Ordered_VisitsInInsertionOrder) {
+  ConcurrentHashTable hashTable;
+  std::vector<int> input{5, 3, 9, 1, 7};
+
+  for (int key : input) {
+    hashTable.insert(key);
+  }
+  hashTable.replace(9);
+
+  ASSERT_EQ(hashTable.keys(), input);
+}
+
+TEST(ConcurrentHashTableTest, Insert_ConcurrentWriters_KeepsEveryItem) {
+  ConcurrentHashTable hashTable(false);
+
+  const int numThreads = 4;
+  const int numItems = 5000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&hashTable, t]() {
+      for (int i = t; i < numItems; i += numThreads) {
+        hashTable.insert(i, i);
+        if (i % 3 == 0) {
+          hashTable.remove(i);
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int> keys = hashTable.keys();
+  std::sort(keys.begin(), keys.end());
+
+  EXPECT_EQ(hashTable.size(), keys.size());
+  for (int i = 0; i < numItems; ++i) {
+    EXPECT_EQ(notNull(hashTable.find(i)), i % 3 != 0);
+  }
+}
+
+TEST(ConcurrentHashTableTest, Insert_ConcurrentOrderedWriters_KeepsList) {
+  ConcurrentHashTable hashTable(true, 4);
+
+  const int numThreads = 4;
+  const int numItems = 4000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&hashTable, t]() {
+      for (int i = t; i < numItems; i += numThreads) {
+        hashTable.insert(i, i);
+        hashTable.find(i / 2);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int> keys = hashTable.keys();
+  std::sort(keys.begin(), keys.end());
+
+  ASSERT_EQ(keys.size(), numItems);
+  for (int i = 0; i < numItems; ++i) {
+    EXPECT_EQ(keys[i], i);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
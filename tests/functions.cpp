@@ -0,0 +1,260 @@
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/uio.h>
+#endif
+
+#include "datastructs/functions.h"
+
+TEST(FunctionsTest, HashWyStr_EveryLengthAndAlignment_MatchesBytes) {
+  std::vector<char> buffer(256);
+
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t length = 0; length < 128; ++length) {
+      char *str = buffer.data() + offset;
+      for (size_t i = 0; i < length; ++i) {
+        str[i] = static_cast<char>('a' + (i * 7 + offset) % 26);
+      }
+      str[length] = '\0';
+
+      ASSERT_EQ(yu_hash_wy_str(str), yu_hash_wy(str, length));
+    }
+  }
+}
+
+TEST(FunctionsTest, HashWy_FlipAnyBit_ChangesHash) {
+  unsigned char key[100];
+  for (size_t i = 0; i < sizeof(key); ++i) {
+    key[i] = static_cast<unsigned char>(i * 31);
+  }
+
+  for (size_t size = 1; size <= sizeof(key); ++size) {
+    size_t hashv = yu_hash_wy(key, size);
+
+    for (size_t bit = 0; bit < size * 8; ++bit) {
+      key[bit / 8] ^= 1 << (bit % 8);
+      ASSERT_NE(yu_hash_wy(key, size), hashv) << size << " " << bit;
+      key[bit / 8] ^= 1 << (bit % 8);
+    }
+  }
+}
+
+TEST(FunctionsTest, HashWy_SizeAndSeed_ChangeHash) {
+  const char zeros[64] = {0};
+  std::set<size_t> hashes;
+
+  for (size_t size = 0; size <= sizeof(zeros); ++size) {
+    hashes.insert(yu_hash_wy(zeros, size));
+  }
+  EXPECT_EQ(hashes.size(), sizeof(zeros) + 1);
+
+  EXPECT_NE(yu_hash_wy_seed("key", 3, 1), yu_hash_wy_seed("key", 3, 2));
+  EXPECT_EQ(yu_hash_wy_seed("key", 3, 0), yu_hash_wy("key", 3));
+}
+
+TEST(FunctionsTest, HashWy_SequentialKeys_SpreadOverLowBits) {
+  const size_t numBuckets = 1024;
+  const size_t numKeys = numBuckets * 64;
+  std::vector<size_t> counts(numBuckets);
+
+  for (uint64_t key = 0; key < numKeys; ++key) {
+    counts[yu_hash_wy(&key, sizeof(key)) % numBuckets]++;
+  }
+
+  for (size_t count : counts) {
+    EXPECT_GT(count, 64 / 2);
+    EXPECT_LT(count, 64 * 2);
+  }
+}
+
+TEST(FunctionsTest, HashI64_SequentialKeys_SpreadOverLowAndHighBits) {
+  const size_t numBuckets = 1024;
+  const int64_t numKeys = numBuckets * 64;
+  std::vector<size_t> low(numBuckets);
+  std::vector<size_t> high(numBuckets);
+  std::set<size_t> hashes;
+
+  for (int64_t key = -numKeys / 2; key < numKeys / 2; ++key) {
+    size_t hashv = yu_hash_i64(key);
+    hashes.insert(hashv);
+    low[hashv % numBuckets]++;
+    high[hashv >> (sizeof(hashv) * 8 - 10)]++;
+  }
+
+  EXPECT_EQ(hashes.size(), static_cast<size_t>(numKeys));
+  for (size_t i = 0; i < numBuckets; ++i) {
+    EXPECT_GT(low[i], 64 / 2);
+    EXPECT_LT(low[i], 64 * 2);
+    EXPECT_GT(high[i], 64 / 2);
+    EXPECT_LT(high[i], 64 * 2);
+  }
+}
+
+TEST(FunctionsTest, HashScalars_EqualKeys_ReturnEqualHashes) {
+  EXPECT_EQ(yu_hash_i32(-1), yu_hash_i32(-1));
+  EXPECT_NE(yu_hash_u8(1), yu_hash_u8(2));
+  EXPECT_NE(yu_hash_u16(0), yu_hash_u16(1));
+  EXPECT_EQ(yu_hash_double(0.0), yu_hash_double(-0.0));
+  EXPECT_EQ(yu_hash_float(0.0f), yu_hash_float(-0.0f));
+  EXPECT_NE(yu_hash_double(1.0), yu_hash_double(-1.0));
+
+  int value = 0;
+  EXPECT_EQ(yu_hash_ptr(&value), yu_hash_ptr(&value));
+  EXPECT_NE(yu_hash_ptr(&value), yu_hash_ptr(&value + 1));
+}
+
+TEST(FunctionsTest, HashCrc32c_Hardware_MatchesTable) {
+  unsigned char key[100];
+  for (size_t i = 0; i < sizeof(key); ++i) {
+    key[i] = static_cast<unsigned char>(i * 131 + 7);
+  }
+
+  for (size_t size = 0; size <= sizeof(key); ++size) {
+    yu_hash_simd(YU_SIMD_NONE);
+    size_t table = yu_hash_crc32c(key, size);
+    yu_hash_simd(YU_SIMD_AVX512);
+
+    ASSERT_EQ(yu_hash_crc32c(key, size), table) << size;
+  }
+}
+
+TEST(FunctionsTest, HashCrc32c_FlipAnyBit_ChangesHash) {
+  unsigned char key[64] = {0};
+  std::set<size_t> hashes;
+
+  for (size_t size = 0; size <= sizeof(key); ++size) {
+    size_t hashv = yu_hash_crc32c(key, size);
+    hashes.insert(hashv);
+
+    for (size_t bit = 0; bit < size * 8; ++bit) {
+      key[bit / 8] ^= 1 << (bit % 8);
+      ASSERT_NE(yu_hash_crc32c(key, size), hashv) << size << " " << bit;
+      key[bit / 8] ^= 1 << (bit % 8);
+    }
+  }
+  EXPECT_EQ(hashes.size(), sizeof(key) + 1);
+}
+
+TEST(FunctionsTest, HashCrc32c_SequentialKeys_SpreadOverLowBits) {
+  const size_t numBuckets = 1024;
+  const size_t numKeys = numBuckets * 64;
+  std::vector<size_t> counts(numBuckets);
+
+  for (uint64_t key = 0; key < numKeys; ++key) {
+    counts[yu_hash_crc32c(&key, sizeof(key)) % numBuckets]++;
+  }
+
+  for (size_t count : counts) {
+    EXPECT_GT(count, 64 / 2);
+    EXPECT_LT(count, 64 * 2);
+  }
+}
+
+class HashBatchTest : public ::testing::TestWithParam<yu_simd> {
+protected:
+  void SetUp() override { yu_hash_simd(GetParam()); }
+
+  void TearDown() override { yu_hash_simd(YU_SIMD_AVX512); }
+};
+
+TEST_P(HashBatchTest, U64Batch_EveryCount_MatchesScalar) {
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < 300; ++i) {
+    keys.push_back(i * 0x9e3779b97f4a7c15ULL);
+  }
+
+  for (size_t n = 0; n <= keys.size(); n += 7) {
+    std::vector<size_t> out(n + 1, 42);
+    yu_hash_u64_batch(keys.data(), out.data(), n);
+
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(out[i], yu_hash_u64(keys[i])) << n << " " << i;
+    }
+    EXPECT_EQ(out[n], 42);
+  }
+}
+
+TEST_P(HashBatchTest, WyBatch_EveryKeySize_MatchesScalar) {
+  const size_t numKeys = 150;
+  std::vector<unsigned char> buffer(numKeys * 100);
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    buffer[i] = static_cast<unsigned char>(i * 131 + 7);
+  }
+
+  for (size_t keySize = 0; keySize <= 100; ++keySize) {
+    std::vector<size_t> out(numKeys);
+    yu_hash_wy_batch(buffer.data(), keySize, out.data(), numKeys);
+
+    for (size_t i = 0; i < numKeys; ++i) {
+      ASSERT_EQ(out[i], yu_hash_wy(buffer.data() + i * keySize, keySize))
+        << keySize << " " << i;
+    }
+  }
+}
+
+TEST_P(HashBatchTest, WyStrBatch_DifferentLengths_MatchesScalar) {
+  std::vector<std::string> strings;
+  std::vector<const char *> strs;
+  for (size_t i = 0; i < 200; ++i) {
+    strings.push_back(std::string(i % 70, static_cast<char>('a' + i % 26)));
+  }
+  for (const std::string &str : strings) {
+    strs.push_back(str.c_str());
+  }
+
+  std::vector<size_t> out(strs.size());
+  yu_hash_wy_str_batch(strs.data(), out.data(), strs.size());
+
+  for (size_t i = 0; i < strs.size(); ++i) {
+    ASSERT_EQ(out[i], yu_hash_wy_str(strs[i])) << i;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Instantiation, HashBatchTest,
+                         ::testing::Values(YU_SIMD_NONE, YU_SIMD_SSE42,
+                                           YU_SIMD_AVX2, YU_SIMD_AVX512));
+
+TEST(FunctionsTest, HashFnv1aUpdate_EverySplit_MatchesOneShot) {
+  const char key[] = "prefix:a somewhat longer payload of the key";
+  const size_t size = sizeof(key) - 1;
+
+  for (size_t first = 0; first <= size; ++first) {
+    for (size_t second = first; second <= size; ++second) {
+      yu_fnv1a_state state;
+      yu_hash_fnv1a_init(&state);
+      yu_hash_fnv1a_update(&state, key, first);
+      yu_hash_fnv1a_update(&state, key + first, second - first);
+      yu_hash_fnv1a_update(&state, key + second, size - second);
+
+      ASSERT_EQ(yu_hash_fnv1a_final(&state), yu_hash_fnv1a(key, size));
+    }
+  }
+}
+
+TEST(FunctionsTest, HashFnv1aFinal_NoUpdates_MatchesEmptyKey) {
+  yu_fnv1a_state state;
+  yu_hash_fnv1a_init(&state);
+  EXPECT_EQ(yu_hash_fnv1a_final(&state), yu_hash_fnv1a("", 0));
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(FunctionsTest, HashFnv1aIov_Fragments_MatchesOneShot) {
+  char prefix[] = "user:";
+  char empty[] = "";
+  char payload[] = "42/profile";
+
+  iovec iov[] = {
+    {prefix, sizeof(prefix) - 1},
+    {empty, 0},
+    {payload, sizeof(payload) - 1},
+  };
+
+  EXPECT_EQ(yu_hash_fnv1a_iov(iov, 3), yu_hash_fnv1a("user:42/profile", 15));
+  EXPECT_EQ(yu_hash_fnv1a_iov(iov, 0), yu_hash_fnv1a("", 0));
+}
+#endif
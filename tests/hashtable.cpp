@@ -38,6 +38,16 @@ size_t hashKeyValueNode(const hash_entry *a) {
   return yu_hash_i32(keyValue->key);
 }
 
+bool equalKeyValueKey(const hash_entry *entry, const void *key) {
+  KeyValue *keyValue = htable_entry(entry, KeyValue, hh);
+  return keyValue->key == *static_cast<const int *>(key);
+}
+
+#define KEY_VALUE_HASH(item) yu_hash_i32((item)->key)
+#define KEY_VALUE_EQUAL(a, b) ((a)->key == (b)->key)
+
+YU_HTABLE_DEFINE(kv_table, KeyValue, hh, KEY_VALUE_HASH, KEY_VALUE_EQUAL)
+
 class HashTable {
 public:
   HashTable() { ht_ = htable_create(1, hashKeyValueNode, equalKeyValue); }
@@ -80,6 +90,12 @@ public:
     return htable_rehash(ht_, new_num_buckets);
   }
 
+  void setIncremental(bool incremental) {
+    htable_set_incremental(ht_, incremental);
+  }
+
+  bool rehashing() { return htable_rehashing(ht_); }
+
   KeyValue *find(int key) {
     KeyValue query(key);
 
@@ -94,7 +110,9 @@ public:
     delete removeKeyValue;
   }
 
+#ifndef YU_HTABLE_COMPACT
   void sort() { htable_sort(ht_, lessKeyValue); }
+#endif
 
   hash_entry *first() { return htable_first(ht_); }
 
@@ -280,6 +298,856 @@ TEST_F(HashTableTestFixture,
   ASSERT_EQ(hashTableSize, numIters);
 }
 
+TEST(HashTableTest, Incremental_InsertManyItems_FindsEveryItemDuringRehash) {
+  HashTable hashTable;
+  hashTable.setIncremental(true);
+
+  bool sawRehashing = false;
+  for (int i = 0; i < 5000; ++i) {
+    hashTable.insert(i, i);
+
+    if (hashTable.rehashing()) {
+      sawRehashing = true;
+
+      for (int j = 0; j <= i; j += 97) {
+        ASSERT_TRUE(notNull(hashTable.find(j)));
+      }
+    }
+  }
+
+  EXPECT_TRUE(sawRehashing);
+  EXPECT_EQ(hashTable.size(), 5000);
+  for (int i = 0; i < 5000; ++i) {
+    KeyValue *found = hashTable.find(i);
+    ASSERT_TRUE(notNull(found));
+    EXPECT_EQ(found->val, i);
+  }
+}
+
+TEST(HashTableTest, Incremental_RemoveDuringRehash_ReturnsValidSize) {
+  HashTable hashTable;
+  hashTable.setIncremental(true);
+
+  for (int i = 0; i < 1000; ++i) {
+    hashTable.insert(i, i);
+  }
+
+  for (int i = 0; i < 1000; i += 2) {
+    hashTable.remove(i);
+  }
+
+  EXPECT_EQ(hashTable.size(), 500);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(notNull(hashTable.find(i)), i % 2 == 1);
+  }
+}
+
+TEST(HashTableTest, Incremental_DisableDuringRehash_FinishesRehash) {
+  HashTable hashTable;
+  hashTable.setIncremental(true);
+
+  int key = 0;
+  while (!hashTable.rehashing()) {
+    hashTable.insert(key++);
+  }
+
+  hashTable.setIncremental(false);
+
+  EXPECT_FALSE(hashTable.rehashing());
+  for (int i = 0; i < key; ++i) {
+    EXPECT_TRUE(notNull(hashTable.find(i)));
+  }
+}
+
+TEST(HashTableTest, LookupBatch_MixedQueries_MatchesSingleLookups) {
+  HashTable hashTable;
+
+  for (int i = 0; i < 100; i += 2) {
+    hashTable.insert(i, i);
+  }
+
+  std::vector<KeyValue> queries;
+  for (int i = 0; i < 100; ++i) {
+    queries.emplace_back(i);
+  }
+
+  std::vector<hash_entry *> queryEntries, results(queries.size());
+  for (KeyValue &query : queries) {
+    queryEntries.push_back(&query.hh);
+  }
+
+  htable_lookup_batch(hashTable.container(), queryEntries.data(),
+                      results.data(), queries.size());
+
+  for (int i = 0; i < 100; ++i) {
+    KeyValue *found = htable_entry_safe(results[i], KeyValue, hh);
+    EXPECT_EQ(found, hashTable.find(i));
+  }
+}
+
+TEST(HashTableTest, RemoveBatch_MixedQueries_RemovesExistingItems) {
+  HashTable hashTable;
+
+  for (int i = 0; i < 50; ++i) {
+    hashTable.insert(i, i);
+  }
+
+  std::vector<KeyValue> queries;
+  for (int i = 25; i < 75; ++i) {
+    queries.emplace_back(i);
+  }
+
+  std::vector<hash_entry *> queryEntries, results(queries.size());
+  for (KeyValue &query : queries) {
+    queryEntries.push_back(&query.hh);
+  }
+
+  htable_remove_batch(hashTable.container(), queryEntries.data(),
+                      results.data(), queries.size());
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(notNull(results[i]), queries[i].key < 50);
+    delete htable_entry_safe(results[i], KeyValue, hh);
+  }
+
+  EXPECT_EQ(hashTable.size(), 25);
+}
+
+#ifndef YU_HTABLE_COMPACT
+TEST(HashTableTest, InsertBatch_ManyItems_KeepsInsertionOrder) {
+  HashTable hashTable;
+  hashTable.setIncremental(true);
+
+  std::vector<hash_entry *> entries;
+  for (int i = 0; i < 1000; ++i) {
+    entries.push_back(&(new KeyValue(i, i))->hh);
+  }
+
+  ASSERT_TRUE(htable_insert_batch(hashTable.container(), entries.data(),
+                                  entries.size()));
+
+  int expected = 0;
+  KeyValue *keyValue;
+  htable_for_each(hashTable.container(), keyValue, hh) {
+    EXPECT_EQ(keyValue->key, expected++);
+  }
+
+  EXPECT_EQ(expected, 1000);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(notNull(hashTable.find(i)));
+  }
+}
+
+TEST(HashTableTest, Shrink_RemoveMostItems_ReturnsLessNumBuckets) {
+  HashTable hashTable;
+
+  for (int i = 0; i < 1000; ++i) {
+    hashTable.insert(i, i);
+  }
+  size_t grownNumBuckets = hashTable.num_buckets();
+
+  for (int i = 0; i < 990; ++i) {
+    hashTable.remove(i);
+  }
+
+  EXPECT_LT(hashTable.num_buckets(), grownNumBuckets / 8);
+  for (int i = 990; i < 1000; ++i) {
+    EXPECT_TRUE(notNull(hashTable.find(i)));
+  }
+}
+
+TEST(HashTableTest, Shrink_InsertRemoveAroundLimit_DoesNotResize) {
+  HashTable hashTable;
+
+  for (int i = 0; i < 1000; ++i) {
+    hashTable.insert(i, i);
+  }
+  /* Remove items until the table shrinks for the first time */
+  size_t grownNumBuckets = hashTable.num_buckets();
+  int key = 0;
+  while (hashTable.num_buckets() == grownNumBuckets) {
+    hashTable.remove(key++);
+  }
+
+  size_t numBuckets = hashTable.num_buckets();
+  for (int round = 0; round < 100; ++round) {
+    hashTable.insert(--key);
+    ASSERT_EQ(hashTable.num_buckets(), numBuckets);
+    hashTable.remove(key++);
+    ASSERT_EQ(hashTable.num_buckets(), numBuckets);
+  }
+}
+
+TEST(HashTableTest, Shrink_RemoveBatch_ReturnsLessNumBuckets) {
+  HashTable hashTable;
+  hashTable.setIncremental(true);
+
+  for (int i = 0; i < 1000; ++i) {
+    hashTable.insert(i, i);
+  }
+  size_t grownNumBuckets = hashTable.num_buckets();
+
+  std::vector<KeyValue> queries;
+  for (int i = 0; i < 1000; ++i) {
+    queries.emplace_back(i);
+  }
+
+  std::vector<hash_entry *> queryEntries, results(queries.size());
+  for (KeyValue &query : queries) {
+    queryEntries.push_back(&query.hh);
+  }
+
+  htable_remove_batch(hashTable.container(), queryEntries.data(),
+                      results.data(), queries.size());
+
+  for (hash_entry *result : results) {
+    ASSERT_TRUE(notNull(result));
+    delete htable_entry(result, KeyValue, hh);
+  }
+
+  EXPECT_EQ(hashTable.size(), 0);
+  EXPECT_LT(hashTable.num_buckets(), grownNumBuckets / 64);
+}
+
+#endif
+
+TEST(HashTableTest, Reserve_BulkLoad_DoesNotRehash) {
+  HashTable hashTable;
+
+  ASSERT_TRUE(htable_reserve(hashTable.container(), 1000));
+  size_t numBuckets = hashTable.num_buckets();
+
+  for (int i = 0; i < 1000; ++i) {
+    hashTable.insert(i, i);
+  }
+  EXPECT_EQ(hashTable.num_buckets(), numBuckets);
+
+  /* Reserved size is kept while the table is sparse */
+  for (int i = 0; i < 1000; ++i) {
+    hashTable.remove(i);
+  }
+  EXPECT_EQ(hashTable.num_buckets(), numBuckets);
+}
+
+TEST(HashTableTest, ShrinkToFit_ReservedTable_KeepsEveryItem) {
+  HashTable hashTable;
+
+  ASSERT_TRUE(htable_reserve(hashTable.container(), 10000));
+  for (int i = 0; i < 10; ++i) {
+    hashTable.insert(i, i);
+  }
+
+  ASSERT_TRUE(htable_shrink_to_fit(hashTable.container()));
+
+  EXPECT_EQ(hashTable.num_buckets(), 16);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(notNull(hashTable.find(i)));
+  }
+
+  /* Next insert fits without growing */
+  hashTable.insert(10);
+  EXPECT_EQ(hashTable.num_buckets(), 16);
+}
+
+TEST(HashTableTest, ForEach_DuringIncrementalRehash_VisitsEveryItemOnce) {
+  HashTable hashTable;
+  hashTable.setIncremental(true);
+
+  int key = 0;
+  while (!hashTable.rehashing()) {
+    hashTable.insert(key++);
+  }
+
+  std::vector<int> visited(key, 0);
+  KeyValue *keyValue;
+  htable_for_each(hashTable.container(), keyValue, hh) {
+    ASSERT_LT(keyValue->key, key);
+    visited[keyValue->key]++;
+  }
+
+  EXPECT_EQ(std::count(visited.begin(), visited.end(), 1), key);
+}
+
+TEST_F(HashTableTestFixture, PrevIn_FromLastItem_VisitsEveryItem) {
+  hash_table *hashTable = ht_.container();
+
+  size_t numIters = 0;
+  for (hash_entry *entry = htable_last(hashTable); entry;
+       entry = htable_prev_in(hashTable, entry)) {
+    numIters++;
+  }
+
+  EXPECT_EQ(numIters, ht_.size());
+}
+
+TEST_F(HashTableTestFixture, ForEachTemp_EraseEveryItem_ReturnsEmptyTable) {
+  hash_table *hashTable = ht_.container();
+  KeyValue *cur, *n;
+
+  htable_for_each_temp(hashTable, cur, n, hh) {
+    htable_erase(hashTable, &cur->hh);
+    delete cur;
+  }
+
+  EXPECT_EQ(ht_.size(), 0);
+  EXPECT_FALSE(notNull(ht_.first()));
+}
+
+static void destroyKeyValues(hash_table *htable) {
+  KeyValue *cur, *n;
+
+  htable_for_each_temp(htable, cur, n, hh) {
+    delete cur;
+  }
+}
+
+TEST(HashTableTest, Define_InsertLookupRemove_MatchesGenericFunctions) {
+  hash_table *htable = kv_table_create(1);
+  ASSERT_TRUE(notNull(htable));
+  htable_set_incremental(htable, true);
+
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_TRUE(kv_table_insert(htable, new KeyValue(i, i)));
+  }
+
+  for (int i = 0; i < 2000; i += 2) {
+    KeyValue query(i);
+    KeyValue *removed = kv_table_remove(htable, &query);
+    ASSERT_TRUE(notNull(removed));
+    EXPECT_EQ(removed->val, i);
+    delete removed;
+  }
+
+  EXPECT_EQ(htable_size(htable), 1000);
+  for (int i = -10; i < 2010; ++i) {
+    KeyValue query(i);
+    bool exists = i >= 0 && i < 2000 && i % 2 == 1;
+
+    KeyValue *found = kv_table_lookup(htable, &query);
+    EXPECT_EQ(notNull(found), exists);
+    EXPECT_EQ(found, htable_find(htable, &query, hh));
+    if (found) {
+      EXPECT_EQ(found->val, i);
+    }
+  }
+
+  KeyValue query(-1);
+  EXPECT_FALSE(notNull(kv_table_remove(htable, &query)));
+
+  htable_destroy(htable, destroyKeyValues);
+}
+
+TEST(HashTableTest, Define_GenericInsert_FoundBySpecializedLookup) {
+  hash_table *htable = kv_table_create(8);
+  ASSERT_TRUE(notNull(htable));
+
+  for (int i = 0; i < 100; ++i) {
+    KeyValue *keyValue = new KeyValue(i, -i);
+    ASSERT_TRUE(htable_add(htable, keyValue, hh));
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    KeyValue query(i);
+    KeyValue *found = kv_table_lookup(htable, &query);
+    ASSERT_TRUE(notNull(found));
+    EXPECT_EQ(found->val, -i);
+  }
+
+  htable_destroy(htable, destroyKeyValues);
+}
+
+TEST(HashTableTest, Hashed_SharedHashAcrossTables_FindsEveryItem) {
+  hash_table *first = htable_create(1, hashKeyValueNode, equalKeyValue);
+  hash_table *second = htable_create(64, hashKeyValueNode, equalKeyValue);
+  htable_set_incremental(first, true);
+
+  for (int i = 0; i < 1000; ++i) {
+    size_t hashv = yu_hash_i32(i);
+    ASSERT_TRUE(htable_insert_hashed(first, &(new KeyValue(i, i))->hh, hashv));
+    if (i % 3 == 0) {
+      ASSERT_TRUE(htable_add(second, new KeyValue(i, -i), hh));
+    }
+  }
+
+  for (int i = -10; i < 1010; ++i) {
+    size_t hashv = yu_hash_i32(i);
+
+    KeyValue *found = htable_find_hashed(first, hashv, &i, equalKeyValueKey,
+                                         KeyValue, hh);
+    EXPECT_EQ(notNull(found), i >= 0 && i < 1000);
+
+    KeyValue query(i);
+    EXPECT_EQ(found, htable_find(first, &query, hh));
+
+    found = htable_find_hashed(second, hashv, &i, equalKeyValueKey, KeyValue,
+                               hh);
+    EXPECT_EQ(notNull(found), i >= 0 && i < 1000 && i % 3 == 0);
+  }
+
+  htable_destroy(first, destroyKeyValues);
+  htable_destroy(second, destroyKeyValues);
+}
+
+TEST(HashTableTest, Hashed_RemoveRawKey_RemovesOnlyMatchingItem) {
+  hash_table *htable = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(htable_add(htable, new KeyValue(i, i), hh));
+  }
+
+  for (int i = 0; i < 100; i += 2) {
+    KeyValue *removed = htable_delete_hashed(htable, yu_hash_i32(i), &i,
+                                             equalKeyValueKey, KeyValue, hh);
+    ASSERT_TRUE(notNull(removed));
+    EXPECT_EQ(removed->val, i);
+    delete removed;
+  }
+
+  int missing = 1000;
+  EXPECT_FALSE(notNull(htable_remove_hashed(htable, yu_hash_i32(missing),
+                                            &missing, equalKeyValueKey)));
+
+  EXPECT_EQ(htable_size(htable), 50);
+  for (int i = 0; i < 100; ++i) {
+    KeyValue query(i);
+    EXPECT_EQ(notNull(htable_find(htable, &query, hh)), i % 2 == 1);
+  }
+
+  htable_destroy(htable, destroyKeyValues);
+}
+
+TEST(HashTableTest, BuildParallel_ManyItems_FindsEveryItemInOrder) {
+  for (size_t numThreads : {1, 3, 8}) {
+    hash_table *htable = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_TRUE(htable_add(htable, new KeyValue(i, i), hh));
+    }
+
+    std::vector<hash_entry *> entries;
+    for (int i = 100; i < 50000; ++i) {
+      entries.push_back(&(new KeyValue(i, i))->hh);
+    }
+
+    ASSERT_TRUE(htable_build_parallel(htable, entries.data(), entries.size(),
+                                      numThreads));
+    EXPECT_EQ(htable_size(htable), 50000);
+
+    for (int i = 0; i < 50000; ++i) {
+      KeyValue query(i);
+      KeyValue *found = htable_find(htable, &query, hh);
+      ASSERT_TRUE(notNull(found));
+      EXPECT_EQ(found->val, i);
+    }
+
+#ifndef YU_HTABLE_COMPACT
+    int expected = 0;
+    KeyValue *keyValue;
+    htable_for_each(htable, keyValue, hh) {
+      ASSERT_EQ(keyValue->key, expected++);
+    }
+    EXPECT_EQ(expected, 50000);
+#endif
+
+    htable_destroy(htable, destroyKeyValues);
+  }
+}
+
+struct KeyValueStats {
+  long long sum;
+  size_t count;
+};
+
+static void foldKeyValue(void *acc, const hash_entry *entry, void *) {
+  KeyValueStats *stats = static_cast<KeyValueStats *>(acc);
+  stats->sum += htable_entry(entry, KeyValue, hh)->val;
+  stats->count++;
+}
+
+static void combineKeyValueStats(void *acc, const void *other, void *) {
+  KeyValueStats *stats = static_cast<KeyValueStats *>(acc);
+  const KeyValueStats *otherStats = static_cast<const KeyValueStats *>(other);
+
+  stats->sum += otherStats->sum;
+  stats->count += otherStats->count;
+}
+
+static void markVisit(hash_entry *entry, void *) {
+  /* Every entry is visited by exactly one thread */
+  htable_entry(entry, KeyValue, hh)->val++;
+}
+
+TEST(HashTableTest, ParallelForEach_DuringIncrementalRehash_VisitsEveryItem) {
+  for (size_t numThreads : {1, 4}) {
+    hash_table *htable = htable_create(1, hashKeyValueNode, equalKeyValue);
+    htable_set_incremental(htable, true);
+
+    int key = 0;
+    while (key < 30000 || !htable_rehashing(htable)) {
+      ASSERT_TRUE(htable_add(htable, new KeyValue(key++, 0), hh));
+    }
+
+    htable_parallel_for_each(htable, markVisit, nullptr, numThreads);
+
+    KeyValue *keyValue;
+    size_t visited = 0;
+    htable_for_each(htable, keyValue, hh) {
+      ASSERT_EQ(keyValue->val, 1);
+      visited++;
+    }
+    EXPECT_EQ(visited, static_cast<size_t>(key));
+
+    htable_destroy(htable, destroyKeyValues);
+  }
+}
+
+TEST(HashTableTest, ParallelReduce_SumValues_MatchesSequentialSum) {
+  for (size_t numThreads : {1, 3, 8}) {
+    hash_table *htable = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+    long long expected = 0;
+    for (int i = 0; i < 40000; ++i) {
+      ASSERT_TRUE(htable_add(htable, new KeyValue(i, i * 3 - 7), hh));
+      expected += i * 3 - 7;
+    }
+
+    KeyValueStats stats = {0, 0};
+    ASSERT_TRUE(htable_parallel_reduce(htable, &stats, sizeof(stats),
+                                       foldKeyValue, combineKeyValueStats,
+                                       nullptr, numThreads));
+    EXPECT_EQ(stats.sum, expected);
+    EXPECT_EQ(stats.count, 40000);
+
+    htable_destroy(htable, destroyKeyValues);
+  }
+}
+
+TEST(HashTableTest, FindOrInsert_CountKeys_ReturnsExistingEntries) {
+  hash_table *htable = htable_create(1, hashKeyValueNode, equalKeyValue);
+  htable_set_incremental(htable, true);
+
+  for (int i = 0; i < 3000; ++i) {
+    KeyValue *keyValue = new KeyValue(i % 1000, 1);
+    hash_entry *existing;
+
+    ASSERT_TRUE(htable_find_or_insert(htable, &keyValue->hh, &existing));
+    if (existing) {
+      EXPECT_GE(i, 1000);
+      htable_entry(existing, KeyValue, hh)->val++;
+      delete keyValue;
+    } else {
+      EXPECT_LT(i, 1000);
+    }
+  }
+
+  EXPECT_EQ(htable_size(htable), 1000);
+  for (int i = 0; i < 1000; ++i) {
+    KeyValue query(i);
+    KeyValue *found = htable_find(htable, &query, hh);
+    ASSERT_TRUE(notNull(found));
+    EXPECT_EQ(found->val, 3);
+  }
+
+  htable_destroy(htable, destroyKeyValues);
+}
+
+static void countVisit(hash_entry *entry, void *arg) {
+  std::vector<int> *visits = static_cast<std::vector<int> *>(arg);
+  int key = htable_entry(entry, KeyValue, hh)->key;
+
+  if (key >= 0 && key < static_cast<int>(visits->size())) {
+    (*visits)[key]++;
+  }
+}
+
+TEST(HashTableTest, Scan_NoModifications_VisitsEveryItemOnce) {
+  for (size_t initialNumBuckets : {1, 3, 12}) {
+    hash_table *htable =
+      htable_create(initialNumBuckets, hashKeyValueNode, equalKeyValue);
+
+    for (int i = 0; i < 1000; ++i) {
+      ASSERT_TRUE(htable_add(htable, new KeyValue(i), hh));
+    }
+
+    std::vector<int> visits(1000);
+    size_t cursor = 0;
+    do {
+      cursor = htable_scan(htable, cursor, countVisit, &visits);
+    } while (cursor != 0);
+
+    for (int i = 0; i < 1000; ++i) {
+      EXPECT_EQ(visits[i], 1);
+    }
+
+    htable_destroy(htable, destroyKeyValues);
+  }
+}
+
+TEST(HashTableTest, Scan_GrowAndShrinkBetweenCalls_VisitsEveryInitialItem) {
+  for (bool incremental : {false, true}) {
+    hash_table *htable = htable_create(3, hashKeyValueNode, equalKeyValue);
+    htable_set_incremental(htable, incremental);
+
+    for (int i = 0; i < 500; ++i) {
+      ASSERT_TRUE(htable_add(htable, new KeyValue(i), hh));
+    }
+
+    std::vector<int> visits(500);
+    size_t cursor = 0;
+    int next = 500;
+    int calls = 0;
+    do {
+      cursor = htable_scan(htable, cursor, countVisit, &visits);
+
+      /* Grow the table during the first calls and shrink it back later */
+      if (calls++ < 30) {
+        for (int j = 0; j < 500; ++j, ++next) {
+          ASSERT_TRUE(htable_add(htable, new KeyValue(next), hh));
+        }
+      } else {
+        for (int j = 0; j < 500 && next > 500; ++j) {
+          KeyValue query(--next);
+          delete htable_delete(htable, &query, hh);
+        }
+      }
+    } while (cursor != 0);
+
+    for (int i = 0; i < 500; ++i) {
+      EXPECT_GE(visits[i], 1);
+    }
+
+    htable_destroy(htable, destroyKeyValues);
+  }
+}
+
+static void eraseEvenKey(hash_entry *entry, void *arg) {
+  hash_table *htable = static_cast<hash_table *>(arg);
+  KeyValue *keyValue = htable_entry(entry, KeyValue, hh);
+
+  if (keyValue->key % 2 == 0) {
+    htable_erase(htable, entry);
+    delete keyValue;
+  }
+}
+
+TEST(HashTableTest, Scan_EraseInCallback_RemovesVisitedItems) {
+  hash_table *htable = htable_create(1, hashKeyValueNode, equalKeyValue);
+  htable_set_incremental(htable, true);
+
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_TRUE(htable_add(htable, new KeyValue(i), hh));
+  }
+
+  size_t cursor = 0;
+  do {
+    cursor = htable_scan(htable, cursor, eraseEvenKey, htable);
+  } while (cursor != 0);
+
+  EXPECT_EQ(htable_size(htable), 2500);
+  for (int i = 0; i < 5000; ++i) {
+    KeyValue query(i);
+    EXPECT_EQ(notNull(htable_find(htable, &query, hh)), i % 2 == 1);
+  }
+
+  htable_destroy(htable, destroyKeyValues);
+}
+
+size_t hashKeyValueClustered(const hash_entry *a) {
+  /* Every 8 consecutive keys share hash value */
+  return htable_entry(a, KeyValue, hh)->key / 8;
+}
+
+bool isPowerOfTwo(size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+
+bool isPrime(size_t n) {
+  if (n < 2) {
+    return false;
+  }
+  for (size_t d = 2; d * d <= n; ++d) {
+    if (n % d == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(HashTableTest, Policy_Pow2Buckets_FindsEveryItem) {
+  struct htable_policy policy;
+  htable_policy_init(&policy);
+  policy.bucket_count = HTABLE_BUCKETS_POW2;
+  policy.growth_factor = 1.5;
+
+  hash_table *htable =
+    htable_create_ex(3, hashKeyValueNode, equalKeyValue, &policy);
+  EXPECT_EQ(htable_num_buckets(htable), 4);
+  htable_set_incremental(htable, true);
+
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_TRUE(htable_add(htable, new KeyValue(i), hh));
+    ASSERT_TRUE(isPowerOfTwo(htable_num_buckets(htable)));
+  }
+
+  for (int i = 0; i < 10000; ++i) {
+    KeyValue query(i);
+    ASSERT_TRUE(notNull(htable_find(htable, &query, hh)));
+  }
+
+  ASSERT_TRUE(htable_rehash(htable, 20000));
+  EXPECT_EQ(htable_num_buckets(htable), 32768);
+
+  htable_destroy(htable, destroyKeyValues);
+}
+
+TEST(HashTableTest, Policy_PrimeBuckets_FindsEveryItem) {
+  struct htable_policy policy;
+  htable_policy_init(&policy);
+  policy.bucket_count = HTABLE_BUCKETS_PRIME;
+  policy.growth_factor = 1.5;
+
+  hash_table *htable =
+    htable_create_ex(8, hashKeyValueNode, equalKeyValue, &policy);
+  EXPECT_EQ(htable_num_buckets(htable), 11);
+  htable_set_incremental(htable, true);
+
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_TRUE(htable_add(htable, new KeyValue(i), hh));
+    ASSERT_TRUE(isPrime(htable_num_buckets(htable)));
+  }
+
+  for (int i = 0; i < 10000; i += 2) {
+    KeyValue query(i);
+    delete htable_entry_safe(htable_remove(htable, &query.hh), KeyValue, hh);
+    ASSERT_TRUE(isPrime(htable_num_buckets(htable)));
+  }
+
+  EXPECT_EQ(htable_size(htable), 5000);
+  for (int i = 0; i < 10000; ++i) {
+    KeyValue query(i);
+    EXPECT_EQ(notNull(htable_find(htable, &query, hh)), i % 2 == 1);
+  }
+
+  htable_destroy(htable, destroyKeyValues);
+}
+
+TEST(HashTableTest, Policy_LoadFactor_BoundsItemsPerBucket) {
+  for (double loadFactor : {0.5, 1.5}) {
+    struct htable_policy policy;
+    htable_policy_init(&policy);
+    policy.load_factor = loadFactor;
+
+    hash_table *htable =
+      htable_create_ex(1, hashKeyValueNode, equalKeyValue, &policy);
+
+    for (int i = 0; i < 10000; ++i) {
+      ASSERT_TRUE(htable_add(htable, new KeyValue(i), hh));
+
+      double load = (double)htable_size(htable) / htable_num_buckets(htable);
+      ASSERT_LE(load, loadFactor + 1);
+      if (i > 100) {
+        ASSERT_GT(load, loadFactor / 2 - 0.01);
+      }
+    }
+
+    htable_destroy(htable, destroyKeyValues);
+  }
+}
+
+#ifndef YU_HTABLE_COMPACT
+
+TEST(HashTableTest, Policy_ZeroShrinkLoadFactor_NeverShrinks) {
+  struct htable_policy policy;
+  htable_policy_init(&policy);
+  policy.shrink_load_factor = 0;
+
+  hash_table *htable =
+    htable_create_ex(1, hashKeyValueNode, equalKeyValue, &policy);
+
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(htable_add(htable, new KeyValue(i), hh));
+  }
+  size_t numBuckets = htable_num_buckets(htable);
+
+  for (int i = 0; i < 1000; ++i) {
+    KeyValue query(i);
+    delete htable_entry_safe(htable_remove(htable, &query.hh), KeyValue, hh);
+  }
+
+  EXPECT_EQ(htable_num_buckets(htable), numBuckets);
+  htable_destroy(htable, destroyKeyValues);
+}
+
+TEST(HashTableTest, Policy_GrowthFactor_ShrinksAlongGrowthSteps) {
+  struct htable_policy policy;
+  htable_policy_init(&policy);
+  policy.growth_factor = 1.5;
+
+  hash_table *htable =
+    htable_create_ex(10, hashKeyValueNode, equalKeyValue, &policy);
+
+  std::vector<size_t> grownCounts = {10};
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_TRUE(htable_add(htable, new KeyValue(i), hh));
+    if (htable_num_buckets(htable) != grownCounts.back()) {
+      grownCounts.push_back(htable_num_buckets(htable));
+    }
+  }
+
+  for (int i = 0; i < 5000; ++i) {
+    KeyValue query(i);
+    delete htable_entry_safe(htable_remove(htable, &query.hh), KeyValue, hh);
+    ASSERT_NE(std::find(grownCounts.begin(), grownCounts.end(),
+                        htable_num_buckets(htable)),
+              grownCounts.end());
+  }
+
+  EXPECT_EQ(htable_num_buckets(htable), 10);
+  htable_destroy(htable, destroyKeyValues);
+}
+
+#endif
+
+TEST(HashTableTest, Policy_AutoTune_MovesLoadFactorTowardsTarget) {
+  struct htable_policy policy;
+  htable_policy_init(&policy);
+  policy.target_chain_length = 1.5;
+
+  /* Clustered hash makes long chains at any load factor */
+  hash_table *clustered =
+    htable_create_ex(1, hashKeyValueClustered, equalKeyValue, &policy);
+  /* Short chains of a good hash let the table get denser */
+  policy.target_chain_length = 3;
+  hash_table *uniform =
+    htable_create_ex(1, hashKeyValueNode, equalKeyValue, &policy);
+
+  for (int i = 0; i < 20000; ++i) {
+    ASSERT_TRUE(htable_add(clustered, new KeyValue(i), hh));
+    ASSERT_TRUE(htable_add(uniform, new KeyValue(i), hh));
+  }
+
+  struct htable_policy tuned;
+  htable_get_policy(clustered, &tuned);
+  EXPECT_LT(tuned.load_factor, 0.7);
+  EXPECT_LT(tuned.shrink_load_factor, policy.shrink_load_factor);
+
+  htable_get_policy(uniform, &tuned);
+  EXPECT_GT(tuned.load_factor, 1.5);
+  EXPECT_GT((double)htable_size(uniform) / htable_num_buckets(uniform), 1);
+
+  for (int i = 0; i < 20000; ++i) {
+    KeyValue query(i);
+    ASSERT_TRUE(notNull(htable_find(clustered, &query, hh)));
+    ASSERT_TRUE(notNull(htable_find(uniform, &query, hh)));
+  }
+
+  htable_destroy(clustered, destroyKeyValues);
+  htable_destroy(uniform, destroyKeyValues);
+}
+
+#ifdef YU_HTABLE_COMPACT
+TEST(HashTableTest, Compact_EntrySize_ReturnsTwoWords) {
+  EXPECT_EQ(sizeof(hash_entry), 2 * sizeof(void *));
+}
+#else
 class HashTableSortTest : public ::testing::TestWithParam<std::vector<int>> {};
 
 INSTANTIATE_TEST_SUITE_P(
@@ -295,6 +1163,122 @@ INSTANTIATE_TEST_SUITE_P(
 
                     ));
 
+static uint64_t keyOfKeyValue(const hash_entry *entry) {
+  /* Flip the sign bit, so negative keys go first */
+  return static_cast<uint64_t>(htable_entry(entry, KeyValue, hh)->key) ^
+         (1ULL << 63);
+}
+
+TEST_P(HashTableSortTest, SortArray_TestCases_ReturnsAscendingTable) {
+  HashTable ht;
+  std::vector<int> input = GetParam();
+  std::vector<int> iterationSequence;
+
+  for (int num : input) {
+    ht.insert(num);
+  }
+
+  ASSERT_TRUE(htable_sort_array(ht.container(), lessKeyValue, 4));
+
+  KeyValue *keyValue;
+  htable_for_each(ht.container(), keyValue, hh) {
+    iterationSequence.push_back(keyValue->key);
+  }
+
+  std::sort(input.begin(), input.end());
+  EXPECT_EQ(iterationSequence, input);
+}
+
+TEST_P(HashTableSortTest, SortByKey_TestCases_ReturnsAscendingTable) {
+  HashTable ht;
+  std::vector<int> input = GetParam();
+  std::vector<int> iterationSequence;
+
+  for (int num : input) {
+    ht.insert(num);
+  }
+
+  ASSERT_TRUE(htable_sort_by_key(ht.container(), keyOfKeyValue));
+
+  KeyValue *keyValue;
+  htable_for_each(ht.container(), keyValue, hh) {
+    iterationSequence.push_back(keyValue->key);
+  }
+
+  std::sort(input.begin(), input.end());
+  EXPECT_EQ(iterationSequence, input);
+}
+
+/* Compares only tens of keys, so there are many equal entries */
+bool lessKeyValueTens(const hash_entry *a, const hash_entry *b) {
+  return htable_entry(a, KeyValue, hh)->key / 10 <
+         htable_entry(b, KeyValue, hh)->key / 10;
+}
+
+static void expectStableOrder(hash_table *htable, size_t size) {
+  std::vector<KeyValue *> forward, backward;
+
+  KeyValue *keyValue;
+  htable_for_each(htable, keyValue, hh) {
+    forward.push_back(keyValue);
+  }
+  for (hash_entry *entry = htable_last(htable); entry;
+       entry = htable_prev(entry)) {
+    backward.push_back(htable_entry(entry, KeyValue, hh));
+  }
+  std::reverse(backward.begin(), backward.end());
+
+  ASSERT_EQ(forward.size(), size);
+  EXPECT_EQ(forward, backward);
+  for (size_t i = 1; i < forward.size(); ++i) {
+    int prevTens = forward[i - 1]->key / 10, tens = forward[i]->key / 10;
+    ASSERT_LE(prevTens, tens);
+    if (prevTens == tens) {
+      /* `val` is insertion index */
+      ASSERT_LT(forward[i - 1]->val, forward[i]->val);
+    }
+  }
+}
+
+TEST(HashTableSortArrayTest, SortArray_ManyEqualItems_IsStable) {
+  for (size_t numThreads : {1, 3, 8}) {
+    hash_table *htable = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+    unsigned seed = 12345;
+    for (int i = 0; i < 50000; ++i) {
+      seed = seed * 1103515245 + 12345;
+      int key = static_cast<int>((seed >> 8) % 100000);
+
+      KeyValue query(key);
+      if (!htable_find(htable, &query, hh)) {
+        ASSERT_TRUE(htable_add(htable, new KeyValue(key, i), hh));
+      }
+    }
+
+    size_t size = htable_size(htable);
+    ASSERT_TRUE(htable_sort_array(htable, lessKeyValueTens, numThreads));
+    expectStableOrder(htable, size);
+
+    htable_destroy(htable, destroyKeyValues);
+  }
+}
+
+TEST(HashTableSortArrayTest, SortByKey_ManyEqualItems_IsStable) {
+  hash_table *htable = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+  for (int i = 0; i < 20000; ++i) {
+    int key = (i * 7919) % 20000;
+    ASSERT_TRUE(htable_add(htable, new KeyValue(key, i), hh));
+  }
+
+  ASSERT_TRUE(htable_sort_by_key(htable, [](const hash_entry *entry) {
+    return static_cast<uint64_t>(htable_entry(entry, KeyValue, hh)->key / 10);
+  }));
+  expectStableOrder(htable, 20000);
+
+  htable_destroy(htable, destroyKeyValues);
+}
+
 TEST_P(HashTableSortTest, Sort_TestCases_ReturnsAscendingTable) {
   HashTable ht;
   std::vector<int> input = GetParam();
@@ -314,6 +1298,7 @@ TEST_P(HashTableSortTest, Sort_TestCases_ReturnsAscendingTable) {
   EXPECT_TRUE(
     std::is_sorted(iterationSequence.begin(), iterationSequence.end()));
 }
+#endif
 
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,194 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <vector>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+#include "datastructs/hash_table_snapshot.h"
+
+#include "utils.hpp"
+
+struct KeyValue {
+  KeyValue() {}
+
+  KeyValue(int key_, int val_ = 0) : key(key_), val(val_) {}
+
+  int key;
+  int val;
+  hash_entry hh;
+};
+
+bool equalKeyValue(const hash_entry *a, const hash_entry *b) {
+  KeyValue *firstKeyValue = htable_entry(a, KeyValue, hh);
+  KeyValue *secondKeyValue = htable_entry(b, KeyValue, hh);
+
+  return firstKeyValue->key == secondKeyValue->key;
+}
+
+size_t hashKeyValueNode(const hash_entry *a) {
+  KeyValue *keyValue = htable_entry(a, KeyValue, hh);
+  return yu_hash_i32(keyValue->key);
+}
+
+static const char *snapshotPath = "hashtablesnapshot_test.bin";
+
+class HashTableSnapshotTestFixture : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ht_ = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+    items_.reserve(1000);
+    for (int i = 0; i < 1000; ++i) {
+      items_.emplace_back(i, i * 10);
+      htable_add(ht_, &items_.back(), hh);
+    }
+  }
+
+  void TearDown() override {
+    htable_destroy(ht_, nullptr);
+    std::remove(snapshotPath);
+  }
+
+  htable_snapshot *saveAndOpen() {
+    bool isSaved = htable_snapshot_write(ht_, snapshotPath, KeyValue, hh);
+    EXPECT_TRUE(isSaved);
+
+    return htable_snapshot_open(snapshotPath, hashKeyValueNode, equalKeyValue);
+  }
+
+  hash_table *ht_;
+  std::vector<KeyValue> items_;
+};
+
+TEST_F(HashTableSnapshotTestFixture, Find_FindExistingItems_ReturnsItems) {
+  htable_snapshot *snapshot = saveAndOpen();
+  ASSERT_TRUE(notNull(snapshot));
+
+  EXPECT_EQ(htable_snapshot_size(snapshot), 1000);
+  for (int i = 0; i < 1000; ++i) {
+    KeyValue query(i);
+    KeyValue *found = htable_snapshot_find(snapshot, &query, hh);
+
+    ASSERT_TRUE(notNull(found));
+    EXPECT_EQ(found->key, i);
+    EXPECT_EQ(found->val, i * 10);
+  }
+
+  htable_snapshot_close(snapshot);
+}
+
+TEST_F(HashTableSnapshotTestFixture, Find_FindNonExistingItem_ReturnsNull) {
+  htable_snapshot *snapshot = saveAndOpen();
+  ASSERT_TRUE(notNull(snapshot));
+
+  KeyValue query(-1);
+  EXPECT_FALSE(notNull(htable_snapshot_find(snapshot, &query, hh)));
+
+  htable_snapshot_close(snapshot);
+}
+
+TEST_F(HashTableSnapshotTestFixture, At_EveryIndex_VisitsEveryItem) {
+  htable_snapshot *snapshot = saveAndOpen();
+  ASSERT_TRUE(notNull(snapshot));
+
+  std::vector<bool> visited(1000, false);
+  for (size_t i = 0; i < htable_snapshot_size(snapshot); ++i) {
+    KeyValue *keyValue =
+      htable_entry(htable_snapshot_at(snapshot, i), KeyValue, hh);
+
+    ASSERT_GE(keyValue->key, 0);
+    ASSERT_LT(keyValue->key, 1000);
+    EXPECT_FALSE(visited[keyValue->key]);
+    visited[keyValue->key] = true;
+  }
+
+  htable_snapshot_close(snapshot);
+}
+
+TEST_F(HashTableSnapshotTestFixture, Open_TruncatedFile_ReturnsNull) {
+  ASSERT_TRUE(htable_snapshot_write(ht_, snapshotPath, KeyValue, hh));
+
+  std::FILE *file = std::fopen(snapshotPath, "rb");
+  ASSERT_TRUE(notNull(file));
+  std::vector<char> image(100);
+  size_t imageSize = std::fread(image.data(), 1, image.size(), file);
+  std::fclose(file);
+
+  file = std::fopen(snapshotPath, "wb");
+  ASSERT_TRUE(notNull(file));
+  std::fwrite(image.data(), 1, imageSize, file);
+  std::fclose(file);
+
+  EXPECT_FALSE(notNull(
+    htable_snapshot_open(snapshotPath, hashKeyValueNode, equalKeyValue)));
+}
+
+/* Bucket offsets follow the 64 byte header */
+static void corruptOffset(size_t bucket, uint64_t offset) {
+  std::FILE *file = std::fopen(snapshotPath, "r+b");
+  ASSERT_TRUE(notNull(file));
+  std::fseek(file, static_cast<long>(64 + bucket * sizeof(uint64_t)),
+             SEEK_SET);
+  std::fwrite(&offset, sizeof(offset), 1, file);
+  std::fclose(file);
+}
+
+TEST_F(HashTableSnapshotTestFixture, Open_CorruptFirstOffset_ReturnsNull) {
+  ASSERT_TRUE(htable_snapshot_write(ht_, snapshotPath, KeyValue, hh));
+  corruptOffset(0, 1);
+
+  EXPECT_FALSE(notNull(
+    htable_snapshot_open(snapshotPath, hashKeyValueNode, equalKeyValue)));
+}
+
+TEST_F(HashTableSnapshotTestFixture, Find_CorruptOffsets_StaysInsideImage) {
+  ASSERT_TRUE(htable_snapshot_write(ht_, snapshotPath, KeyValue, hh));
+  corruptOffset(1, 1u << 20);
+  corruptOffset(3, 5);
+  corruptOffset(4, 2);
+
+  htable_snapshot *snapshot =
+    htable_snapshot_open(snapshotPath, hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(snapshot));
+
+  /* Missing keys scan their whole bucket */
+  for (int i = 0; i < 100000; ++i) {
+    KeyValue query(i);
+    KeyValue *found = htable_snapshot_find(snapshot, &query, hh);
+    if (found) {
+      EXPECT_EQ(found->key, i);
+      EXPECT_EQ(found->val, i * 10);
+    }
+  }
+
+  htable_snapshot_close(snapshot);
+}
+
+TEST(HashTableSnapshotTest, Open_EmptyTable_ReturnsEmptySnapshot) {
+  hash_table *ht = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+  ASSERT_TRUE(htable_snapshot_write(ht, snapshotPath, KeyValue, hh));
+  htable_destroy(ht, nullptr);
+
+  htable_snapshot *snapshot =
+    htable_snapshot_open(snapshotPath, hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(snapshot));
+
+  KeyValue query(0);
+  EXPECT_EQ(htable_snapshot_size(snapshot), 0);
+  EXPECT_FALSE(notNull(htable_snapshot_find(snapshot, &query, hh)));
+
+  htable_snapshot_close(snapshot);
+  std::remove(snapshotPath);
+}
+
+TEST(HashTableSnapshotTest, Open_MissingFile_ReturnsNull) {
+  EXPECT_FALSE(notNull(htable_snapshot_open("missing_snapshot.bin",
+                                            hashKeyValueNode, equalKeyValue)));
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <set>
+#include <vector>
+
+#include "datastructs/functions.h"
+#include "datastructs/hash_table.h"
+#include "datastructs/perfect_hash_table.h"
+
+#include "utils.hpp"
+
+struct KeyValue {
+  KeyValue() {}
+
+  KeyValue(int key_, int val_ = 0) : key(key_), val(val_) {}
+
+  int key;
+  int val;
+  hash_entry hh;
+};
+
+bool equalKeyValue(const hash_entry *a, const hash_entry *b) {
+  KeyValue *firstKeyValue = htable_entry(a, KeyValue, hh);
+  KeyValue *secondKeyValue = htable_entry(b, KeyValue, hh);
+
+  return firstKeyValue->key == secondKeyValue->key;
+}
+
+size_t hashKeyValueNode(const hash_entry *a) {
+  KeyValue *keyValue = htable_entry(a, KeyValue, hh);
+  return yu_hash_i32(keyValue->key);
+}
+
+size_t hashKeyValuePairs(const hash_entry *a) {
+  /* Every two consecutive keys share hash value */
+  return htable_entry(a, KeyValue, hh)->key / 2;
+}
+
+static const char *tablePath = "perfecthashtable_test.bin";
+
+class PerfectHashTableTestFixture : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ht_ = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+    items_.reserve(1000);
+    for (int i = 0; i < 1000; ++i) {
+      items_.emplace_back(i, i * 10);
+      htable_add(ht_, &items_.back(), hh);
+    }
+  }
+
+  void TearDown() override {
+    htable_destroy(ht_, nullptr);
+    std::remove(tablePath);
+  }
+
+  void expectEveryItem(perfect_htable *table) {
+    ASSERT_EQ(phtable_size(table), 1000);
+
+    for (int i = 0; i < 1000; ++i) {
+      KeyValue query(i);
+      KeyValue *found = phtable_find(table, &query, hh);
+
+      ASSERT_TRUE(notNull(found));
+      EXPECT_EQ(found->key, i);
+      EXPECT_EQ(found->val, i * 10);
+    }
+
+    for (int i = 1000; i < 2000; ++i) {
+      KeyValue query(i);
+      EXPECT_FALSE(notNull(phtable_find(table, &query, hh)));
+    }
+  }
+
+  hash_table *ht_;
+  std::vector<KeyValue> items_;
+};
+
+TEST_F(PerfectHashTableTestFixture, Build_FindExistingItems_ReturnsItems) {
+  perfect_htable *table = phtable_build(ht_, hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(table));
+
+  /* Built table refers to the entries, not to the Hash Table */
+  htable_destroy(ht_, nullptr);
+  ht_ = htable_create(1, hashKeyValueNode, equalKeyValue);
+
+  expectEveryItem(table);
+  phtable_destroy(table);
+}
+
+TEST_F(PerfectHashTableTestFixture, At_EveryPosition_ReturnsDistinctItems) {
+  perfect_htable *table = phtable_build(ht_, hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(table));
+
+  std::set<int> keys;
+  for (size_t i = 0; i < phtable_size(table); ++i) {
+    keys.insert(htable_entry(phtable_at(table, i), KeyValue, hh)->key);
+  }
+  EXPECT_EQ(keys.size(), 1000);
+
+  phtable_destroy(table);
+}
+
+TEST_F(PerfectHashTableTestFixture, SaveOpen_FindExistingItems_ReturnsItems) {
+  perfect_htable *built = phtable_build(ht_, hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(built));
+  ASSERT_TRUE(phtable_write(built, tablePath, KeyValue, hh));
+  phtable_destroy(built);
+
+  perfect_htable *table =
+    phtable_open(tablePath, hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(table));
+
+  expectEveryItem(table);
+  phtable_destroy(table);
+}
+
+TEST_F(PerfectHashTableTestFixture, Open_TruncatedFile_ReturnsNull) {
+  perfect_htable *built = phtable_build(ht_, hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(built));
+  ASSERT_TRUE(phtable_write(built, tablePath, KeyValue, hh));
+  phtable_destroy(built);
+
+  std::vector<char> image;
+  FILE *file = std::fopen(tablePath, "rb");
+  ASSERT_TRUE(notNull(file));
+  for (int c; (c = std::fgetc(file)) != EOF;) {
+    image.push_back(static_cast<char>(c));
+  }
+  std::fclose(file);
+
+  file = std::fopen(tablePath, "wb");
+  std::fwrite(image.data(), 1, image.size() - 1, file);
+  std::fclose(file);
+
+  EXPECT_FALSE(
+    notNull(phtable_open(tablePath, hashKeyValueNode, equalKeyValue)));
+  EXPECT_FALSE(
+    notNull(phtable_open("missing.bin", hashKeyValueNode, equalKeyValue)));
+}
+
+TEST(PerfectHashTableTest, BuildArray_ManyItems_UsesAboutThreeBitsPerKey) {
+  std::vector<KeyValue> items;
+  std::vector<hash_entry *> entries;
+
+  items.reserve(200000);
+  for (int i = 0; i < 200000; ++i) {
+    items.emplace_back(i * 7, i);
+    entries.push_back(&items.back().hh);
+  }
+
+  perfect_htable *table = phtable_build_array(
+    entries.data(), entries.size(), hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(table));
+
+  EXPECT_LT(phtable_index_size(table) * 8.0 / items.size(), 3.5);
+  for (int i = 0; i < 200000; ++i) {
+    KeyValue query(i * 7);
+    KeyValue *found = phtable_find(table, &query, hh);
+
+    ASSERT_TRUE(notNull(found));
+    ASSERT_EQ(found->val, i);
+  }
+
+  phtable_destroy(table);
+}
+
+TEST(PerfectHashTableTest, BuildArray_NoItems_FindsNothing) {
+  perfect_htable *table =
+    phtable_build_array(nullptr, 0, hashKeyValueNode, equalKeyValue);
+  ASSERT_TRUE(notNull(table));
+
+  KeyValue query(1);
+  EXPECT_EQ(phtable_size(table), 0);
+  EXPECT_FALSE(notNull(phtable_find(table, &query, hh)));
+
+  phtable_destroy(table);
+}
+
+TEST(PerfectHashTableTest, BuildArray_EqualHashValues_ReturnsNull) {
+  std::vector<KeyValue> items;
+  std::vector<hash_entry *> entries;
+
+  items.reserve(100);
+  for (int i = 0; i < 100; ++i) {
+    items.emplace_back(i);
+    entries.push_back(&items.back().hh);
+  }
+
+  EXPECT_FALSE(notNull(phtable_build_array(entries.data(), entries.size(),
+                                           hashKeyValuePairs, equalKeyValue)));
+}
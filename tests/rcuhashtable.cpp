@@ -0,0 +1,225 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "datastructs/functions.h"
+#include "datastructs/rcu_hash_table.h"
+
+#include "utils.hpp"
+
+struct KeyValue {
+  KeyValue() {}
+
+  KeyValue(int key_, int val_ = 0) : key(key_), val(val_) {}
+
+  int key;
+  int val;
+  hash_entry hh;
+};
+
+static std::atomic<int> numFreed(0);
+
+bool equalKeyValue(const hash_entry *a, const hash_entry *b) {
+  KeyValue *firstKeyValue = htable_entry(a, KeyValue, hh);
+  KeyValue *secondKeyValue = htable_entry(b, KeyValue, hh);
+
+  return firstKeyValue->key == secondKeyValue->key;
+}
+
+size_t hashKeyValueNode(const hash_entry *a) {
+  KeyValue *keyValue = htable_entry(a, KeyValue, hh);
+  return yu_hash_i32(keyValue->key);
+}
+
+void freeKeyValue(hash_entry *entry) {
+  numFreed++;
+  delete htable_entry(entry, KeyValue, hh);
+}
+
+class RcuHashTable {
+public:
+  RcuHashTable() {
+    ht_ = rcu_htable_create(1, hashKeyValueNode, equalKeyValue, freeKeyValue);
+  }
+
+  ~RcuHashTable() { rcu_htable_destroy(ht_); }
+
+  void insert(int key, int val = 0) {
+    KeyValue *keyValue = new KeyValue(key, val);
+
+    bool isInserted = rcu_htable_add(ht_, keyValue, hh);
+    ASSERT_TRUE(isInserted);
+  }
+
+  void replace(int key, int val = 0) {
+    KeyValue *keyValue = new KeyValue(key, val);
+
+    bool isReplaced = rcu_htable_replace(ht_, &keyValue->hh);
+    ASSERT_TRUE(isReplaced);
+  }
+
+  bool remove(int key) {
+    KeyValue query(key);
+
+    return rcu_htable_remove(ht_, &query.hh);
+  }
+
+  /* Must be called inside of read-side critical section */
+  KeyValue *find(int key) {
+    KeyValue query(key);
+
+    return rcu_htable_find(ht_, &query, hh);
+  }
+
+  size_t size() { return rcu_htable_size(ht_); }
+
+  rcu_hash_table *container() { return ht_; }
+
+private:
+  rcu_hash_table *ht_;
+};
+
+class RcuHashTableTestFixture : public ::testing::Test {
+protected:
+  void SetUp() override {
+    numFreed = 0;
+    reader_ = rcu_htable_reader_register(ht_.container());
+
+    for (int i = 0; i < 100; ++i) {
+      ht_.insert(i, i);
+    }
+  }
+
+  void TearDown() override { rcu_htable_reader_unregister(reader_); }
+
+  RcuHashTable ht_;
+  rcu_reader *reader_;
+};
+
+TEST_F(RcuHashTableTestFixture, Find_FindExistingItem_ReturnsItem) {
+  rcu_htable_read_lock(reader_);
+  KeyValue *found = ht_.find(42);
+
+  ASSERT_TRUE(notNull(found));
+  EXPECT_EQ(found->val, 42);
+  rcu_htable_read_unlock(reader_);
+}
+
+TEST_F(RcuHashTableTestFixture, Find_FindNonExistingItem_ReturnsNull) {
+  rcu_htable_read_lock(reader_);
+  KeyValue *found = ht_.find(-1);
+  rcu_htable_read_unlock(reader_);
+
+  ASSERT_FALSE(notNull(found));
+}
+
+TEST_F(RcuHashTableTestFixture, Remove_InsideCriticalSection_DefersFree) {
+  rcu_htable_read_lock(reader_);
+  KeyValue *found = ht_.find(7);
+  ASSERT_TRUE(notNull(found));
+
+  EXPECT_TRUE(ht_.remove(7));
+
+  /* Entry is still readable */
+  EXPECT_EQ(found->key, 7);
+  EXPECT_EQ(numFreed, 0);
+  rcu_htable_read_unlock(reader_);
+
+  rcu_htable_synchronize(ht_.container());
+
+  EXPECT_EQ(numFreed, 1);
+  EXPECT_EQ(ht_.size(), 99);
+}
+
+TEST_F(RcuHashTableTestFixture, Replace_ReplaceExistingItem_RetiresOldItem) {
+  ht_.replace(5, 500);
+  rcu_htable_synchronize(ht_.container());
+
+  rcu_htable_read_lock(reader_);
+  KeyValue *found = ht_.find(5);
+
+  ASSERT_TRUE(notNull(found));
+  EXPECT_EQ(found->val, 500);
+  rcu_htable_read_unlock(reader_);
+
+  EXPECT_EQ(numFreed, 1);
+  EXPECT_EQ(ht_.size(), 100);
+}
+
+TEST_F(RcuHashTableTestFixture, Rehash_Default_KeepsEveryItem) {
+  ASSERT_TRUE(rcu_htable_rehash(ht_.container(), 1000));
+
+  EXPECT_EQ(rcu_htable_num_buckets(ht_.container()), 1000);
+
+  rcu_htable_read_lock(reader_);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(notNull(ht_.find(i)));
+  }
+  rcu_htable_read_unlock(reader_);
+}
+
+TEST(RcuHashTableTest, Lookup_ConcurrentWriter_AlwaysFindsStableItems) {
+  RcuHashTable hashTable;
+
+  const int numStable = 1000;
+  const int numReaders = 3;
+
+  for (int i = 0; i < numStable; ++i) {
+    hashTable.insert(i, i);
+  }
+
+  std::atomic<bool> stop(false);
+  std::atomic<int> misses(0);
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < numReaders; ++t) {
+    readers.emplace_back([&]() {
+      rcu_reader *reader = rcu_htable_reader_register(hashTable.container());
+
+      while (!stop) {
+        for (int i = 0; i < numStable; i += 7) {
+          rcu_htable_read_lock(reader);
+
+          KeyValue *found = hashTable.find(i);
+          if (!found || found->key != i) {
+            misses++;
+          }
+          /* Churned entries could be removed, but not freed */
+          KeyValue *churned = hashTable.find(numStable + i);
+          if (churned && churned->key != numStable + i) {
+            misses++;
+          }
+
+          rcu_htable_read_unlock(reader);
+        }
+      }
+
+      rcu_htable_reader_unregister(reader);
+    });
+  }
+
+  /* Writer churns other keys, which grows the table multiple times */
+  for (int round = 0; round < 20; ++round) {
+    for (int i = numStable; i < numStable * 4; ++i) {
+      hashTable.insert(i, round);
+    }
+    for (int i = numStable; i < numStable * 4; ++i) {
+      hashTable.remove(i);
+    }
+  }
+
+  stop = true;
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(misses, 0);
+  EXPECT_EQ(hashTable.size(), numStable);
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,256 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "datastructs/functions.h"
+#include "datastructs/swiss_table.h"
+
+#include "utils.hpp"
+
+struct KeyValue {
+  KeyValue() {}
+
+  KeyValue(int key_, int val_ = 0) : key(key_), val(val_) {}
+
+  int key;
+  int val;
+  hash_entry hh;
+};
+
+bool equalKeyValue(const hash_entry *a, const hash_entry *b) {
+  KeyValue *firstKeyValue = htable_entry(a, KeyValue, hh);
+  KeyValue *secondKeyValue = htable_entry(b, KeyValue, hh);
+
+  return firstKeyValue->key == secondKeyValue->key;
+}
+
+size_t hashKeyValueNode(const hash_entry *a) {
+  KeyValue *keyValue = htable_entry(a, KeyValue, hh);
+  return yu_hash_i32(keyValue->key);
+}
+
+size_t badHashKeyValueNode(const hash_entry *a) {
+  KeyValue *keyValue = htable_entry(a, KeyValue, hh);
+  return keyValue->key % 3;
+}
+
+void destroyKeyValues(swiss_table *table) {
+  KeyValue *cur;
+
+  swtable_for_each(table, cur, hh) {
+    delete cur;
+  }
+}
+
+class SwissTable {
+public:
+  SwissTable(ht_hash_fun hash = hashKeyValueNode) {
+    table_ = swtable_create(1, hash, equalKeyValue);
+  }
+
+  ~SwissTable() { swtable_destroy(table_, destroyKeyValues); }
+
+  void insert(int key, int val = 0) {
+    KeyValue *found = find(key);
+    if (found) {
+      found->val = val;
+      return;
+    }
+
+    KeyValue *keyValue = new KeyValue(key, val);
+
+    bool isInserted = swtable_add(table_, keyValue, hh);
+    ASSERT_TRUE(isInserted);
+  }
+
+  void replace(int key, int val = 0) {
+    KeyValue *keyValue = new KeyValue(key, val);
+    hash_entry *replaced;
+
+    swtable_replace(table_, &keyValue->hh, &replaced);
+    if (replaced) {
+      delete htable_entry(replaced, KeyValue, hh);
+    }
+  }
+
+  KeyValue *find(int key) {
+    KeyValue query(key);
+
+    return swtable_find(table_, &query, hh);
+  }
+
+  void remove(int key) {
+    KeyValue query(key);
+
+    KeyValue *removeKeyValue = swtable_delete(table_, &query, hh);
+
+    delete removeKeyValue;
+  }
+
+  void erase(KeyValue *keyValue) {
+    swtable_erase(table_, &keyValue->hh);
+    delete keyValue;
+  }
+
+  bool rehash(size_t new_capacity) {
+    return swtable_rehash(table_, new_capacity);
+  }
+
+  size_t size() { return swtable_size(table_); }
+
+  size_t capacity() { return swtable_capacity(table_); }
+
+  swiss_table *container() { return table_; }
+
+private:
+  swiss_table *table_;
+};
+
+class SwissTableTestFixture : public ::testing::Test {
+protected:
+  void SetUp() override {
+    for (int i = 0; i < 100; ++i) {
+      table_.insert(i, i);
+    }
+  }
+
+  void TearDown() override {}
+
+  SwissTable table_;
+};
+
+TEST(SwissTableTest, Create_DefaultInitialization_ReturnsEmptyTable) {
+  SwissTable table;
+
+  size_t tableSize = table.size();
+  KeyValue *found = table.find(0);
+
+  EXPECT_EQ(tableSize, 0);
+  EXPECT_FALSE(notNull(found));
+}
+
+TEST(SwissTableTest, Size_InsertSameItemMultipleTimes_ReturnsOne) {
+  SwissTable table;
+
+  table.insert(0);
+  table.insert(0);
+
+  ASSERT_EQ(table.size(), 1);
+}
+
+TEST(SwissTableTest, Capacity_InsertManyItems_GrowsCapacity) {
+  SwissTable table;
+
+  size_t capacityBefore = table.capacity();
+  for (int i = 0; i < 1000; ++i) {
+    table.insert(i, i);
+  }
+  size_t capacityAfter = table.capacity();
+
+  EXPECT_GT(capacityAfter, capacityBefore);
+  EXPECT_EQ(table.size(), 1000);
+}
+
+TEST(SwissTableTest, Find_CollidingHashes_ReturnsEveryItem) {
+  SwissTable table(badHashKeyValueNode);
+
+  for (int i = 0; i < 200; ++i) {
+    table.insert(i, i);
+  }
+
+  for (int i = 0; i < 200; ++i) {
+    KeyValue *found = table.find(i);
+    ASSERT_TRUE(notNull(found));
+    EXPECT_EQ(found->val, i);
+  }
+}
+
+TEST(SwissTableTest, Insert_RemoveAndInsertRepeatedly_KeepsValidSize) {
+  SwissTable table;
+
+  /* Produces a lot of tombstones */
+  for (int round = 0; round < 50; ++round) {
+    for (int i = 0; i < 10; ++i) {
+      table.insert(round * 10 + i);
+    }
+    for (int i = 0; i < 10; ++i) {
+      table.remove(round * 10 + i);
+    }
+  }
+
+  EXPECT_EQ(table.size(), 0);
+  EXPECT_LE(table.capacity(), 32);
+}
+
+TEST_F(SwissTableTestFixture, Find_FindExistingItem_ReturnsItem) {
+  KeyValue *found = table_.find(42);
+
+  ASSERT_TRUE(notNull(found));
+  EXPECT_EQ(found->key, 42);
+  EXPECT_EQ(found->val, 42);
+}
+
+TEST_F(SwissTableTestFixture, Find_FindNonExistingItem_ReturnsNull) {
+  KeyValue *found = table_.find(-1);
+
+  ASSERT_FALSE(notNull(found));
+}
+
+TEST_F(SwissTableTestFixture, Find_RemoveExistingItem_ReturnsNull) {
+  table_.remove(0);
+
+  KeyValue *found = table_.find(0);
+
+  ASSERT_FALSE(notNull(found));
+  EXPECT_EQ(table_.size(), 99);
+}
+
+TEST_F(SwissTableTestFixture, Erase_EraseExistingItem_ReturnsNull) {
+  table_.erase(table_.find(7));
+
+  KeyValue *found = table_.find(7);
+
+  ASSERT_FALSE(notNull(found));
+  EXPECT_EQ(table_.size(), 99);
+}
+
+TEST_F(SwissTableTestFixture, Replace_ReplaceExistingItem_ReturnsNewValue) {
+  table_.replace(5, 500);
+
+  KeyValue *found = table_.find(5);
+
+  ASSERT_TRUE(notNull(found));
+  EXPECT_EQ(found->val, 500);
+  EXPECT_EQ(table_.size(), 100);
+}
+
+TEST_F(SwissTableTestFixture, Rehash_Default_KeepsEveryItem) {
+  ASSERT_TRUE(table_.rehash(4096));
+
+  EXPECT_EQ(table_.capacity(), 4096);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(notNull(table_.find(i)));
+  }
+}
+
+TEST_F(SwissTableTestFixture, ForEach_Default_VisitsEveryItemOnce) {
+  KeyValue *keyValue;
+  std::vector<int> keys;
+
+  swtable_for_each(table_.container(), keyValue, hh) {
+    keys.push_back(keyValue->key);
+  }
+
+  std::sort(keys.begin(), keys.end());
+
+  ASSERT_EQ(keys.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(keys[i], i);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
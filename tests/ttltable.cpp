@@ -0,0 +1,319 @@
+#include "gtest/gtest.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "datastructs/functions.h"
+#include "datastructs/memory.h"
+#include "datastructs/ttl_table.h"
+
+#include "utils.hpp"
+
+struct KeyValue {
+  KeyValue() {}
+
+  KeyValue(int key_, int val_ = 0) : key(key_), val(val_) {}
+
+  int key;
+  int val;
+  ttl_entry te;
+};
+
+bool equalKeyValue(const hash_entry *a, const hash_entry *b) {
+  KeyValue *firstKeyValue = ttltable_hash_item(a, KeyValue, te);
+  KeyValue *secondKeyValue = ttltable_hash_item(b, KeyValue, te);
+
+  return firstKeyValue->key == secondKeyValue->key;
+}
+
+size_t hashKeyValueNode(const hash_entry *a) {
+  KeyValue *keyValue = ttltable_hash_item(a, KeyValue, te);
+  return yu_hash_i32(keyValue->key);
+}
+
+void expireKeyValue(ttl_entry *entry, void *arg) {
+  std::vector<int> *expired = static_cast<std::vector<int> *>(arg);
+  KeyValue *keyValue = ttltable_item(entry, KeyValue, te);
+
+  expired->push_back(keyValue->key);
+  delete keyValue;
+}
+
+class TTLTable {
+public:
+  TTLTable(uint64_t now = 0) {
+    table_ = ttltable_create(now, hashKeyValueNode, equalKeyValue,
+                             expireKeyValue, &expired_);
+  }
+
+  ~TTLTable() { ttltable_destroy(table_); }
+
+  void add(int key, uint64_t deadline) {
+    KeyValue *keyValue = new KeyValue(key);
+
+    bool isAdded = ttltable_add(table_, keyValue, te, deadline);
+    ASSERT_TRUE(isAdded);
+  }
+
+  KeyValue *find(int key, uint64_t now) {
+    KeyValue query(key);
+
+    return ttltable_find(table_, &query, te, now);
+  }
+
+  void remove(int key) {
+    KeyValue query(key);
+
+    KeyValue *removed =
+      ttltable_item_safe(ttltable_remove(table_, &query.te), KeyValue, te);
+    delete removed;
+  }
+
+  size_t expire(uint64_t now, size_t budget = SIZE_MAX) {
+    return ttltable_expire(table_, now, budget);
+  }
+
+  size_t size() { return ttltable_size(table_); }
+
+  ttl_table *get() { return table_; }
+
+  std::vector<int> &expired() { return expired_; }
+
+private:
+  std::vector<int> expired_;
+  ttl_table *table_;
+};
+
+TEST(TTLTableTest, Find_ExpiredEntry_IsDroppedLazily) {
+  TTLTable table;
+
+  table.add(1, 10);
+  table.add(2, TTL_NO_DEADLINE);
+
+  EXPECT_TRUE(notNull(table.find(1, 9)));
+  EXPECT_FALSE(notNull(table.find(1, 10)));
+  EXPECT_EQ(table.expired(), std::vector<int>({1}));
+  EXPECT_EQ(table.size(), 1);
+
+  /* Dropped entry is not expired again by the wheel */
+  EXPECT_EQ(table.expire(1000000), 0);
+  EXPECT_TRUE(notNull(table.find(2, 1000000)));
+}
+
+TEST(TTLTableTest, Expire_DueEntries_InDeadlineOrder) {
+  TTLTable table;
+
+  table.add(1, 300);
+  table.add(2, 5);
+  table.add(3, 64);
+  table.add(4, 70000);
+  table.add(5, 63);
+
+  EXPECT_EQ(table.expire(4), 0);
+  EXPECT_EQ(table.expire(100), 3);
+  EXPECT_EQ(table.expired(), std::vector<int>({2, 5, 3}));
+
+  EXPECT_EQ(table.expire(69999), 1);
+  EXPECT_EQ(table.expire(70000), 1);
+  EXPECT_EQ(table.expired(), std::vector<int>({2, 5, 3, 1, 4}));
+  EXPECT_EQ(table.size(), 0);
+}
+
+TEST(TTLTableTest, Expire_Budget_ContinuesOnNextCall) {
+  TTLTable table;
+
+  for (int i = 0; i < 10; ++i) {
+    table.add(i, 3);
+  }
+
+  EXPECT_EQ(table.expire(5, 4), 4);
+  EXPECT_EQ(table.size(), 6);
+  EXPECT_EQ(table.expire(5, 4), 4);
+  EXPECT_EQ(table.expire(6, 4), 2);
+  EXPECT_EQ(table.size(), 0);
+  EXPECT_EQ(table.expired().size(), 10);
+}
+
+TEST(TTLTableTest, Expire_Budget_BoundsCascade) {
+  TTLTable table;
+
+  /* Deadline is past the first level, entries are cascaded at tick 960 */
+  for (int i = 0; i < 1000; ++i) {
+    table.add(i, 1000);
+  }
+
+  EXPECT_EQ(table.expire(999, 8), 0);
+  EXPECT_EQ(table.size(), 1000);
+
+  /* Every entry is cascaded once and expired once, 8 of them per call */
+  size_t calls = 1;
+  while (table.size() > 0) {
+    ASSERT_LE(table.expire(1000, 8), 8);
+    calls++;
+  }
+  EXPECT_EQ(calls, 2 * 1000 / 8);
+}
+
+/* Remembers in which expire calls large blocks were allocated and freed.
+ * Bucket arrays are the only large blocks of the table */
+struct BlockCalls {
+  static const size_t largeSize = 4096;
+
+  size_t call = 0;
+  std::map<void *, size_t> sizes;
+  std::set<size_t> allocations;
+  std::set<size_t> frees;
+};
+
+void *allocateBlock(size_t size, void *userData) {
+  BlockCalls *calls = static_cast<BlockCalls *>(userData);
+  void *block = yu_default_allocate(size, nullptr);
+
+  if (block && size >= BlockCalls::largeSize) {
+    calls->sizes[block] = size;
+    calls->allocations.insert(calls->call);
+  }
+  return block;
+}
+
+void deallocateBlock(void *block, void *userData) {
+  BlockCalls *calls = static_cast<BlockCalls *>(userData);
+
+  if (calls->sizes.erase(block)) {
+    calls->frees.insert(calls->call);
+  }
+  yu_default_deallocate(block, nullptr);
+}
+
+TEST(TTLTableTest, Expire_ShrinkingTable_MigratesBucketsAcrossCalls) {
+  BlockCalls calls;
+  yu_allocator allocator = {allocateBlock, yu_default_reallocate,
+                            deallocateBlock, &calls};
+  yu_set_allocator(&allocator);
+
+  {
+    TTLTable table;
+    for (int i = 0; i < 20000; ++i) {
+      table.add(i, 10);
+    }
+
+    /* Budget of 8 entries per call. A whole-table rehash would allocate the
+     * smaller bucket array and free the old one in the same call, migrating
+     * every entry there. Incremental one frees it calls later */
+    calls.allocations.clear();
+    calls.frees.clear();
+    while (table.size() > 0) {
+      calls.call++;
+      ASSERT_LE(table.expire(10, 8), 8);
+    }
+    calls.call++;
+
+    EXPECT_GT(calls.allocations.size(), 1);
+    for (size_t call : calls.allocations) {
+      EXPECT_EQ(calls.frees.count(call), 0) << call;
+    }
+  }
+
+  yu_allocator defaultAllocator = {yu_default_allocate, yu_default_reallocate,
+                                   yu_default_deallocate, nullptr};
+  yu_set_allocator(&defaultAllocator);
+}
+
+TEST(TTLTableTest, Expire_FarDeadline_IsCascaded) {
+  TTLTable table(5);
+  uint64_t far = 5 + ((uint64_t)1 << 30) + 12345;
+
+  table.add(1, far);
+  table.add(2, TTL_NO_DEADLINE);
+
+  EXPECT_EQ(table.expire(far - 1), 0);
+  EXPECT_TRUE(notNull(table.find(1, far - 1)));
+  EXPECT_EQ(table.expire(far), 1);
+  EXPECT_EQ(table.expired(), std::vector<int>({1}));
+}
+
+TEST(TTLTableTest, SetDeadline_MovesEntry) {
+  TTLTable table;
+
+  table.add(1, 10);
+  table.add(2, 20);
+
+  ttltable_set_deadline(table.get(), &table.find(1, 0)->te, 5000);
+  ttltable_set_deadline(table.get(), &table.find(2, 0)->te, 15);
+
+  EXPECT_EQ(table.expire(4999), 1);
+  EXPECT_EQ(table.expired(), std::vector<int>({2}));
+
+  ttltable_set_deadline(table.get(), &table.find(1, 4999)->te,
+                        TTL_NO_DEADLINE);
+  EXPECT_EQ(table.expire(100000), 0);
+  EXPECT_EQ(table.size(), 1);
+}
+
+TEST(TTLTableTest, Remove_Entry_IsNotExpired) {
+  TTLTable table;
+
+  table.add(1, 10);
+  table.add(2, 10);
+  table.remove(1);
+  table.remove(3);
+
+  EXPECT_EQ(table.expire(10), 1);
+  EXPECT_EQ(table.expired(), std::vector<int>({2}));
+}
+
+TEST(TTLTableTest, Destroy_PassesEntriesToExpire) {
+  std::vector<int> expired;
+
+  {
+    ttl_table *table = ttltable_create(0, hashKeyValueNode, equalKeyValue,
+                                       expireKeyValue, &expired);
+
+    for (int i = 0; i < 3; ++i) {
+      KeyValue *keyValue = new KeyValue(i);
+      ASSERT_TRUE(ttltable_add(table, keyValue, te, 100));
+    }
+    ttltable_destroy(table);
+  }
+
+  EXPECT_EQ(expired.size(), 3);
+}
+
+TEST(TTLTableTest, RandomOperations_MatchReference) {
+  TTLTable table;
+  std::map<int, uint64_t> reference;
+  unsigned seed = 7;
+  uint64_t now = 0;
+
+  for (int i = 0; i < 20000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    int key = static_cast<int>((seed >> 8) % 500);
+    unsigned op = (seed >> 20) % 4;
+
+    if (op == 0) {
+      now += (seed >> 4) % 300;
+      table.expire(now);
+      for (auto it = reference.begin(); it != reference.end();) {
+        it = it->second <= now ? reference.erase(it) : std::next(it);
+      }
+      ASSERT_EQ(table.size(), reference.size());
+    } else if (op == 1) {
+      auto it = reference.find(key);
+      KeyValue *found = table.find(key, now);
+
+      ASSERT_EQ(found != NULL, it != reference.end() && it->second > now);
+      if (it != reference.end() && it->second <= now) {
+        reference.erase(it);
+      }
+    } else if (reference.find(key) == reference.end()) {
+      uint64_t deadline = now + ((seed >> 2) % 2 ? (seed >> 3) % 100
+                                                 : (seed >> 3) % 300000);
+      table.add(key, deadline);
+      reference[key] = deadline;
+    } else {
+      table.remove(key);
+      reference.erase(key);
+    }
+  }
+}